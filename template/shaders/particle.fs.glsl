@@ -0,0 +1,24 @@
+#version 330
+
+// From vertex shader
+in vec2 texcoord;
+in vec4 tint;
+flat in int texture_index;
+
+// Application data
+uniform sampler2D smoke_large;
+uniform sampler2D smoke_small;
+uniform sampler2D ghost;
+
+// Output color
+layout(location = 0) out vec4 color;
+
+void main()
+{
+	// Samplers can't be picked by a per particle value, so all of them are read
+	vec4 texels[3] = vec4[3](
+		texture(smoke_large, texcoord),
+		texture(smoke_small, texcoord),
+		texture(ghost, texcoord));
+	color = tint * texels[texture_index];
+}
@@ -0,0 +1,36 @@
+#version 330 
+
+// Corner of the quad every particle shares
+layout (location = 0) in vec3 in_position;
+layout (location = 1) in vec2 in_texcoord;
+
+// Per particle, laid out as ParticleInstance
+layout (location = 2) in vec4 in_placement; // position, scale
+layout (location = 3) in vec3 in_look; // radians, alpha, texture
+layout (location = 4) in vec3 in_colour;
+
+// Passed to fragment shader
+out vec2 texcoord;
+out vec4 tint;
+flat out int texture_index;
+
+// Application data
+uniform mat3 projection;
+uniform vec2 camera_shift;
+uniform vec2 texture_sizes[3];
+
+void main()
+{
+	texture_index = int(in_look.z);
+
+	// Scaled, rotated and then moved into place, as a sprite's transform does
+	vec2 corner = in_position.xy * texture_sizes[texture_index] * in_placement.zw;
+	float c = cos(in_look.x);
+	float s = sin(in_look.x);
+	corner = vec2(c * corner.x - s * corner.y, s * corner.x + c * corner.y);
+
+	texcoord = in_texcoord;
+	tint = vec4(in_colour, in_look.y);
+	vec3 pos = projection * vec3(corner + in_placement.xy + camera_shift, 1.0);
+	gl_Position = vec4(pos.xy, in_position.z, 1.0);
+}
@@ -0,0 +1,10 @@
+#version 330
+
+// Never runs, the update pass turns rasterizing off. Effects are linked with one
+
+layout(location = 0) out vec4 color;
+
+void main()
+{
+	color = vec4(0.0);
+}
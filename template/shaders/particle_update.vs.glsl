@@ -0,0 +1,44 @@
+#version 330 
+
+// A particle as GpuParticle lays it out
+layout (location = 0) in vec4 in_placement; // position, scale as drawn
+layout (location = 1) in vec3 in_look; // radians, alpha as drawn, texture
+layout (location = 2) in vec3 in_colour;
+layout (location = 3) in vec4 in_motion; // velocity, age, life
+layout (location = 4) in vec4 in_shape; // scale, size_mod, start alpha
+
+// Captured into the other buffer in the same layout
+out vec4 out_placement;
+out vec3 out_look;
+out vec3 out_colour;
+out vec4 out_motion;
+out vec4 out_shape;
+
+// Application data
+uniform float elapsed_ms;
+
+const float SIZE_MOD_MS = 200.0; // one pulse of a particle's size, as in particle_system.cpp
+const float PI = 3.14159265;
+
+void main()
+{
+	float age = in_motion.z + elapsed_ms;
+	float life = in_motion.w;
+	vec2 position = in_placement.xy + in_motion.xy * (elapsed_ms / 1000.0);
+
+	// Same fade and pulse as ParticleSystem::capture, a particle past its life shrinks
+	// to nothing until its slot is spawned into again
+	float pulse = sin(mod(age, SIZE_MOD_MS) / SIZE_MOD_MS * PI) * in_shape.z;
+	bool alive = age < life;
+	vec2 scale = alive ? in_shape.xy + vec2(pulse) : vec2(0.0);
+	float alpha = alive ? in_shape.w * (1.0 - age / life) : 0.0;
+
+	out_placement = vec4(position, scale);
+	out_look = vec3(in_look.x, alpha, in_look.z);
+	out_colour = in_colour;
+	out_motion = vec4(in_motion.xy, age, life);
+	out_shape = in_shape;
+
+	// Rasterizing is off during the pass
+	gl_Position = vec4(0.0, 0.0, 0.0, 1.0);
+}
@@ -1,27 +1,14 @@
 #include "door.hpp"
+#include "world_context.hpp"
 
 Texture Door::s_door_closed_texture;
 Texture Door::s_door_open_texture;
+SharedInit Door::s_shared_init;
 
 bool Door::init(int id, vec2 position)
 {
-    if (!s_door_closed_texture.is_valid())
-	{
-        if (!s_door_closed_texture.load_from_file(textures_path("door_closed.png")))
-		{
-			std::fprintf(stderr, "Failed to load door closed texture!");
-			return false;
-		}
-	}
-
-	if (!s_door_open_texture.is_valid())
-	{
-		if (!s_door_open_texture.load_from_file(textures_path("door_open.png")))
-		{
-			std::fprintf(stderr, "Failed to load door open texture!");
-			return false;
-		}
-	}
+    if (!s_shared_init.run(load_textures))
+        return false;
 
     rc.texture = &s_door_open_texture;
 
@@ -41,6 +28,21 @@ bool Door::init(int id, vec2 position)
     return true;
 }
 
+bool Door::load_textures()
+{
+    if (!s_door_closed_texture.load_from_file(textures_path("door_closed.png")))
+    {
+        std::fprintf(stderr, "Failed to load door closed texture!");
+        return false;
+    }
+    if (!s_door_open_texture.load_from_file(textures_path("door_open.png")))
+    {
+        std::fprintf(stderr, "Failed to load door open texture!");
+        return false;
+    }
+    return true;
+}
+
 void Door::set_destination(std::string dest)
 {
     action = dest;
@@ -80,15 +82,15 @@ void Door::calculate_hitbox()
 
 std::string Door::perform_action()
 {
-    SoundSystem* sound_system = SoundSystem::get_system();
+    Audio* audio = get_world_context().audio;
 
     if (!m_locked && action.length() > 0) {
         // go to destination
-        sound_system->play_sound_effect(Sound_Effects::open_door);
+        audio->play_sound_effect(Sound_Effects::open_door);
         return action;
     }
     if (m_locked) {
-        sound_system->play_sound_effect(Sound_Effects::door_locked);
+        audio->play_sound_effect(Sound_Effects::door_locked);
         return "locked";
     }
     // otherwise, no destination specified
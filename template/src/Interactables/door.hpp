@@ -6,6 +6,10 @@ class Door: public Interactable
 {
     static Texture s_door_closed_texture;
 	static Texture s_door_open_texture;
+	static SharedInit s_shared_init;
+
+	// Loads the textures every door shares, once for all worlds
+	static bool load_textures();
 
     public:
         // Creates all the associated render resources and default transform
@@ -1,7 +1,9 @@
 #include "interactable.hpp"
+#include "world_context.hpp"
 
 bool Interactable::init(int id, vec2 position)
 {
+	WorldContext& world = get_world_context();
 	m_id = id;
 	
 	position = add(position, { 0.f, brick_size / 2.f + 6.f });
@@ -9,8 +11,8 @@ bool Interactable::init(int id, vec2 position)
     mc.position = position;
     mc.physics.scale = { brick_size / rc.texture->width, brick_size / rc.texture->height };
 
-	s_render_components[id] = &rc;
-	s_motion_components[id] = &mc;
+	world.render_components.insert(id, &rc);
+	world.motion_components.insert(id, &mc);
 
     return true;
 }
@@ -3,7 +3,6 @@
 #include "common.hpp"
 #include "hitbox.hpp"
 #include "components.hpp"
-#include "sound_system.hpp"
 
 #include <vector>
 #include <cmath>
@@ -1,4 +1,5 @@
 #include "flight_energy_bar.hpp"
+#include "world_context.hpp"
 
 namespace
 {
@@ -10,51 +11,15 @@ Texture FlightEnergyBar::fuel_4;
 Texture FlightEnergyBar::fuel_3;
 Texture FlightEnergyBar::fuel_2;
 Texture FlightEnergyBar::fuel_empty;
+SharedInit FlightEnergyBar::shared_init;
 
 bool FlightEnergyBar::init(int id)
 {
+	WorldContext& world = get_world_context();
 	m_id = id;
 
-    if (!fuel_full.is_valid())
-    {
-        if (!fuel_full.load_from_file(textures_path("fuel_5.png")))
-        {
-            fprintf(stderr, "Failed to load full flight timer!");
-            return false;
-        }
-    }
-    if (!fuel_4.is_valid())
-    {
-        if (!fuel_4.load_from_file(textures_path("fuel_4.png")))
-        {
-            fprintf(stderr, "Failed to load green flight timer");
-            return false;
-        }
-    }
-    if (!fuel_3.is_valid())
-    {
-        if (!fuel_3.load_from_file(textures_path("fuel_3.png")))
-        {
-            fprintf(stderr, "Failed to load yellow flight timer!");
-            return false;
-        }
-    }
-    if (!fuel_2.is_valid())
-    {
-        if (!fuel_2.load_from_file(textures_path("fuel_2.png")))
-        {
-            fprintf(stderr, "Failed to load orange flight timer");
-            return false;
-        }
-    }
-    if (!fuel_empty.is_valid())
-    {
-        if (!fuel_empty.load_from_file(textures_path("fuel_1.png")))
-        {
-            fprintf(stderr, "Failed to load empty flight timer");
-            return false;
-        }
-    }
+    if (!shared_init.run(load_textures))
+        return false;
 
     mc.position = { 0.f, 0.f };
     mc.velocity = { 0.f, 0.f };
@@ -69,12 +34,42 @@ bool FlightEnergyBar::init(int id)
         return false;
     }
 
-	s_render_components[id] = &rc;
-	s_motion_components[id] = &mc;
+	world.render_components.insert(id, &rc);
+	world.motion_components.insert(id, &mc);
 
     return true;
 }
 
+bool FlightEnergyBar::load_textures()
+{
+    if (!fuel_full.load_from_file(textures_path("fuel_5.png")))
+    {
+        fprintf(stderr, "Failed to load full flight timer!");
+        return false;
+    }
+    if (!fuel_4.load_from_file(textures_path("fuel_4.png")))
+    {
+        fprintf(stderr, "Failed to load green flight timer");
+        return false;
+    }
+    if (!fuel_3.load_from_file(textures_path("fuel_3.png")))
+    {
+        fprintf(stderr, "Failed to load yellow flight timer!");
+        return false;
+    }
+    if (!fuel_2.load_from_file(textures_path("fuel_2.png")))
+    {
+        fprintf(stderr, "Failed to load orange flight timer");
+        return false;
+    }
+    if (!fuel_empty.load_from_file(textures_path("fuel_1.png")))
+    {
+        fprintf(stderr, "Failed to load empty flight timer");
+        return false;
+    }
+    return true;
+}
+
 void FlightEnergyBar::update(float ms, vec2 goal, float percent)
 {
     if (percent > .8) {
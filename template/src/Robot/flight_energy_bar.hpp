@@ -10,6 +10,10 @@ class FlightEnergyBar : public Entity
     static Texture fuel_3;
     static Texture fuel_2;
     static Texture fuel_empty;
+    static SharedInit shared_init;
+
+    // Loads the textures every energy bar shares, once for all worlds
+    static bool load_textures();
 
 	RenderComponent rc;
 	MotionComponent mc;
@@ -1,5 +1,6 @@
 // Header
 #include "robot.hpp"
+#include "world_context.hpp"
 
 #include <cmath>
 
@@ -15,27 +16,15 @@ namespace {
 
 Texture Robot::robot_body_texture;
 Texture Robot::robot_body_flying_texture;
+SharedInit Robot::shared_init;
 
 bool Robot::init(int id, bool use_parts)
 {
+	WorldContext& world = get_world_context();
 	m_id = id;
 
-	if (!robot_body_texture.is_valid())
-	{
-		if (!robot_body_texture.load_from_file(textures_path("body_ball.png")))
-		{
-			fprintf(stderr, "Failed to load body texture!");
-			return false;
-		}
-	}
-	if (!robot_body_flying_texture.is_valid())
-	{
-		if (!robot_body_flying_texture.load_from_file(textures_path("body_ball_flying.png")))
-		{
-			fprintf(stderr, "Failed to load body flying texture!");
-			return false;
-		}
-	}
+	if (!shared_init.run(load_textures))
+		return false;
 
 	rc.texture = &robot_body_texture;
 
@@ -47,8 +36,8 @@ bool Robot::init(int id, bool use_parts)
     mc.acceleration = { 0.f , GRAVITY_ACCELERATION };
     mc.radians = 0.f;
 
-	s_render_components[id] = &rc;
-	s_motion_components[id] = &mc;
+	world.render_components.insert(id, &rc);
+	world.motion_components.insert(id, &mc);
 
 	mc.physics.scale = { brick_size / rc.texture->width, brick_size / rc.texture->height };
 
@@ -57,7 +46,9 @@ bool Robot::init(int id, bool use_parts)
 		return true;
 	}
 
-	bool valid = m_shoulders.init(id + 1) && m_head.init(id + 2) && m_energy_bar.init(id + 3) && m_smoke_system.init(id + 4) && m_hat.init(id + 5);
+	// Parts are created after the body so they draw on top of it, the hat last
+	bool valid = m_shoulders.init(world.entities.create()) && m_head.init(world.entities.create()) &&
+		m_energy_bar.init(world.entities.create()) && m_hat.init(world.entities.create());
 	m_head.set_scaling(mc.physics.scale);
 	m_shoulders.set_scaling(mc.physics.scale);
     m_energy_bar.set_scaling(mc.physics.scale);
@@ -74,6 +65,21 @@ bool Robot::init(int id, bool use_parts)
 	return valid;
 }
 
+bool Robot::load_textures()
+{
+	if (!robot_body_texture.load_from_file(textures_path("body_ball.png")))
+	{
+		fprintf(stderr, "Failed to load body texture!");
+		return false;
+	}
+	if (!robot_body_flying_texture.load_from_file(textures_path("body_ball_flying.png")))
+	{
+		fprintf(stderr, "Failed to load body flying texture!");
+		return false;
+	}
+	return true;
+}
+
 vec2 Robot::update_velocity(float ms) {
 
     float step = (ms / 1000);
@@ -132,10 +138,10 @@ void Robot::update(float ms)
         m_shoulders.set_direction(mc.velocity.x > 0.f);
     }
 
-	m_smoke_system.update(ms, mc.position, mc.velocity);
+	m_smoke_emitter.update(ms, mc.position, mc.velocity, get_world_context().particles);
 
 	if (m_should_stop_smoke && mc.velocity.y >= 0) {
-		m_smoke_system.stop_smoke();
+		m_smoke_emitter.stop();
 	}
 
 	m_energy_bar.set_status(MAX_FLIGHT_DURATION != m_available_flight_time);
@@ -248,13 +254,13 @@ void Robot::start_flying()
     }
     m_is_flying = true;
     set_acceleration({mc.acceleration.x, FLIGHT_ACCELERATION});
-	m_smoke_system.start_smoke();
+	m_smoke_emitter.start();
 	m_should_stop_smoke = false;
 	rc.texture = &robot_body_flying_texture;
 	mc.physics.scale.x *= 53.f / 45.f;
 	mc.radians = 0.f;
     // start the rocket sound effect
-    SoundSystem::get_system()->play_sound_effect(Sound_Effects::rocket, -1);
+    get_world_context().audio->play_sound_effect(Sound_Effects::rocket, -1);
     // If we want made robot fall faster, reset vertical acceleration here.
 }
 
@@ -267,7 +273,7 @@ void Robot::stop_flying()
 	rc.texture = &robot_body_texture;
 	mc.physics.scale = { brick_size / rc.texture->width, brick_size / rc.texture->height };
     // stop the rocket sound effect
-    SoundSystem::get_system()->stop_sound_effect(Sound_Effects::rocket, 1500);
+    get_world_context().audio->stop_sound_effect(Sound_Effects::rocket, 1500);
 	// If we want the robot to fall a bit faster, set vertical acceleration here. Positive number, make it a const
 }
 
@@ -314,9 +320,32 @@ void Robot::set_head_direction(bool b) {
     m_hat.set_direction(b);
 }
 
+void Robot::save_state(RobotState& state) const
+{
+    state.position = mc.position;
+    state.velocity = mc.velocity;
+    state.radians = mc.radians;
+    state.head_position = m_head.get_position();
+    state.head_velocity = m_head.get_velocity();
+    state.available_flight_time = m_available_flight_time;
+    state.grounded = m_grounded ? 1 : 0;
+}
+
+void Robot::load_state(const RobotState& state)
+{
+    set_position(state.position);
+    set_shoulder_position(state.position);
+    set_head_position(state.head_position);
+    set_head_velocity(state.head_velocity);
+    mc.velocity = state.velocity;
+    mc.radians = state.radians;
+    m_available_flight_time = state.available_flight_time;
+    m_grounded = state.grounded != 0;
+}
+
 void Robot::destroy()
 {
-	m_smoke_system.destroy();
+	m_smoke_emitter.stop();
 }
 
 
@@ -3,16 +3,20 @@
 #include <brick.hpp>
 #include "common.hpp"
 #include "hitbox.hpp"
-#include "smoke_system.hpp"
+#include "particle_emitters.hpp"
 #include "robot_head.hpp"
 #include "robot_shoulders.hpp"
 #include "flight_energy_bar.hpp"
-#include "sound_system.hpp"
+#include "snapshot.hpp"
 
 class Robot : public Entity
 {
 	static Texture robot_body_texture;
 	static Texture robot_body_flying_texture;
+	static SharedInit shared_init;
+
+	// Loads the textures every robot body shares, once for all worlds
+	static bool load_textures();
 
 	RenderComponent rc;
 	MotionComponent mc;
@@ -93,12 +97,18 @@ public:
 
     void set_head_direction(bool b);
 
+	// Copies the part of the robot that changes during play into state
+	void save_state(RobotState& state) const;
+
+	// Puts the robot back into a previously saved state
+	void load_state(const RobotState& state);
+
 	void destroy();
 
 private:
 	RobotHead m_head;
 	RobotShoulders m_shoulders;
-	SmokeSystem m_smoke_system;
+	RocketSmokeEmitter m_smoke_emitter;
 	FlightEnergyBar m_energy_bar;
     RobotHat m_hat;
     Hitbox m_hitbox;
@@ -1,19 +1,16 @@
 #include "robot_head.hpp"
+#include "world_context.hpp"
 
 Texture RobotHat::robot_hat_texture;
+SharedInit RobotHat::shared_init;
 
 bool RobotHat::init(int id)
 {
+    WorldContext& world = get_world_context();
     m_id = id;
 
-    if (!robot_hat_texture.is_valid())
-    {
-        if (!robot_hat_texture.load_from_file(textures_path("hat.png")))
-        {
-            fprintf(stderr, "Failed to load hat texture!");
-            return false;
-        }
-    }
+    if (!shared_init.run(load_textures))
+        return false;
 
     rc.texture = &robot_hat_texture;
 
@@ -27,9 +24,19 @@ bool RobotHat::init(int id)
 
     mc.physics.scale = { 1.0f, 1.0f };
 
-    s_render_components[id] = &rc;
-    s_motion_components[id] = &mc;
+    world.render_components.insert(id, &rc);
+    world.motion_components.insert(id, &mc);
+
+    return true;
+}
 
+bool RobotHat::load_textures()
+{
+    if (!robot_hat_texture.load_from_file(textures_path("hat.png")))
+    {
+        fprintf(stderr, "Failed to load hat texture!");
+        return false;
+    }
     return true;
 }
 
@@ -5,6 +5,10 @@
 class RobotHat : public Entity
 {
     static Texture robot_hat_texture;
+    static SharedInit shared_init;
+
+    // Loads the textures every robot hat shares, once for all worlds
+    static bool load_textures();
     bool m_face_right = true;
 
     RenderComponent rc;
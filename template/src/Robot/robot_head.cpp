@@ -1,19 +1,16 @@
 #include "robot_head.hpp"
+#include "world_context.hpp"
 
 Texture RobotHead::robot_head_texture;
+SharedInit RobotHead::shared_init;
 
 bool RobotHead::init(int id)
 {
+	WorldContext& world = get_world_context();
 	m_id = id;
 
-    if (!robot_head_texture.is_valid())
-    {
-        if (!robot_head_texture.load_from_file(textures_path("head.png")))
-        {
-            fprintf(stderr, "Failed to load head texture!");
-            return false;
-        }
-    }
+    if (!shared_init.run(load_textures))
+        return false;
 
     rc.texture = &robot_head_texture;
 
@@ -27,14 +24,24 @@ bool RobotHead::init(int id)
 
 	mc.physics.scale = { 1.0f, 1.0f };
 
-	s_render_components[id] = &rc;
-	s_motion_components[id] = &mc;
+	world.render_components.insert(id, &rc);
+	world.motion_components.insert(id, &mc);
 
 	calculate_hitbox();
 
     return true;
 }
 
+bool RobotHead::load_textures()
+{
+    if (!robot_head_texture.load_from_file(textures_path("head.png")))
+    {
+        fprintf(stderr, "Failed to load head texture!");
+        return false;
+    }
+    return true;
+}
+
 void RobotHead::update(float ms, vec2 goal)
 {
 	if (m_face_right)
@@ -89,7 +96,7 @@ vec2 RobotHead::get_next_position(vec2 goal) {
     return add(get_position(), dist);
 }
 
-vec2 RobotHead::get_velocity() {
+vec2 RobotHead::get_velocity() const {
     return mc.velocity;
 }
 
@@ -9,6 +9,10 @@
 class RobotHead : public Entity
 {
     static Texture robot_head_texture;
+    static SharedInit shared_init;
+
+    // Loads the textures every robot head shares, once for all worlds
+    static bool load_textures();
     bool m_face_right = true;
 
 	RenderComponent rc;
@@ -41,7 +45,7 @@ public:
 
     vec2 get_next_position(vec2 goal);
 
-    vec2 get_velocity();
+    vec2 get_velocity() const;
 
     void set_velocity(vec2 vec2);
 
@@ -1,19 +1,16 @@
 #include "robot_shoulders.hpp"
+#include "world_context.hpp"
 
 Texture RobotShoulders::robot_shoulder_texture;
+SharedInit RobotShoulders::shared_init;
 
 bool RobotShoulders::init(int id)
 {
+	WorldContext& world = get_world_context();
 	m_id = id;
 
-    if (!robot_shoulder_texture.is_valid())
-    {
-        if (!robot_shoulder_texture.load_from_file(textures_path("body_shoulder.png")))
-        {
-            fprintf(stderr, "Failed to load shoulder texture!");
-            return false;
-        }
-    }
+	if (!shared_init.run(load_textures))
+		return false;
 
 	rc.texture = &robot_shoulder_texture;
 
@@ -27,9 +24,19 @@ bool RobotShoulders::init(int id)
 
 	mc.physics.scale = { 1.0f, 1.0f };
 
-	s_render_components[id] = &rc;
-	s_motion_components[id] = &mc;
+	world.render_components.insert(id, &rc);
+	world.motion_components.insert(id, &mc);
+
+    return true;
+}
 
+bool RobotShoulders::load_textures()
+{
+    if (!robot_shoulder_texture.load_from_file(textures_path("body_shoulder.png")))
+    {
+        fprintf(stderr, "Failed to load shoulder texture!");
+        return false;
+    }
     return true;
 }
 
@@ -5,6 +5,10 @@
 class RobotShoulders : public Entity
 {
     static Texture robot_shoulder_texture;
+    static SharedInit shared_init;
+
+    // Loads the textures every pair of robot shoulders shares, once for all worlds
+    static bool load_textures();
     bool m_face_right = true;
 
 	RenderComponent rc;
@@ -1,4 +1,5 @@
 #include "menu.hpp"
+#include "world_context.hpp"
 #include "sound_system.hpp"
 
 bool Menu::init(GLFWwindow* window, vec2 screen)
@@ -15,13 +16,14 @@ bool Menu::init(GLFWwindow* window, vec2 screen)
 	m_screen_scale = static_cast<float>(fb_width) / screen.x;
 
 	// Initialize the screen texture
-	m_screen_tex.create_from_screen(m_window);
+	m_screen_tex.create_from_screen(fb_width, fb_height);
 
 	return true;
 }
 
 bool Menu::setup(std::vector<std::tuple<std::string, Status, vec2>> buttons)
 {
+	WorldContext& world = get_world_context();
 	float size = 0.f;
 	for (auto& s : buttons)
 	{
@@ -35,7 +37,7 @@ bool Menu::setup(std::vector<std::tuple<std::string, Status, vec2>> buttons)
 
 	float start = 400.f - size / 2.f;
 
-	int first = next_id;
+	world.entities.begin_batch();
 
 	for (auto& s : buttons)
 	{
@@ -44,12 +46,12 @@ bool Menu::setup(std::vector<std::tuple<std::string, Status, vec2>> buttons)
 		b->set_status(std::get<1>(s));
 		vec2 size = std::get<2>(s);
 		b->set_size(size);
-		b->init(next_id++, { 600.f, start + size.y / 2 });
+		b->init(world.entities.create(), { 600.f, start + size.y / 2 });
 		m_entities.push_back(b);
 		start += size.y + brick_size;
 	}
 
-	m_rs.process(first, next_id);
+	m_rs.process(world.entities.end_batch());
 
 	return true;
 }
@@ -61,6 +63,7 @@ void Menu::destroy()
 
 	for (auto& e : m_entities)
 	{
+		release_ui_entity(e->get_id());
 		delete e;
 	}
 
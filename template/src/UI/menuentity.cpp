@@ -1,7 +1,9 @@
 #include "menuentity.hpp"
+#include "world_context.hpp"
 
 bool MenuEntity::init(int id, vec2 position)
 {
+	WorldContext& world = get_world_context();
 	m_id = id;
 
 	if (!m_rc.init_sprite())
@@ -14,12 +16,17 @@ bool MenuEntity::init(int id, vec2 position)
 
 	m_mc.physics.scale = { width / m_rc.texture->width, height / m_rc.texture->height };
 
-	s_ui_render_components[id] = &m_rc;
-	s_ui_motion_components[id] = &m_mc;
+	world.ui_render_components.insert(id, &m_rc);
+	world.ui_motion_components.insert(id, &m_mc);
 
 	return true;
 }
 
+int MenuEntity::get_id() const
+{
+	return m_id;
+}
+
 void MenuEntity::set_size(vec2 size)
 {
 	width = size.x;
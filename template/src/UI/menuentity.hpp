@@ -12,6 +12,9 @@ public:
 	// Set the size
 	void set_size(vec2 size);
 
+	// ID given at init
+	int get_id() const;
+
 protected:
 	// ID for ECS
 	int m_id;
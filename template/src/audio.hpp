@@ -0,0 +1,29 @@
+#pragma once
+
+#include "common.hpp"
+
+// What the simulation plays its music and sound effects through. The game plays them
+// on the SoundSystem, programs without an audio device leave the level's NullAudio
+class Audio
+{
+public:
+	virtual ~Audio() {}
+
+	// changes the current background music
+	virtual void play_bgm(Music bgm) = 0;
+
+	// plays a sound effect, a loops of -1 plays it until it is stopped
+	virtual void play_sound_effect(Sound_Effects sound_effect, int loops = 0, int fade_in_ms = 0, int channel = -1) = 0;
+
+	// stops the sound effect from playing on all channels
+	virtual void stop_sound_effect(Sound_Effects sound_effect, int fade_out_ms) = 0;
+};
+
+// Plays nothing
+class NullAudio : public Audio
+{
+public:
+	void play_bgm(Music /*bgm*/) override {}
+	void play_sound_effect(Sound_Effects /*sound_effect*/, int /*loops*/ = 0, int /*fade_in_ms*/ = 0, int /*channel*/ = -1) override {}
+	void stop_sound_effect(Sound_Effects /*sound_effect*/, int /*fade_out_ms*/) override {}
+};
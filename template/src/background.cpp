@@ -1,19 +1,16 @@
 #include "background.hpp"
+#include "world_context.hpp"
 
 Texture Background::s_background_texture;
+SharedInit Background::s_shared_init;
 
 bool Background::init(int id, float scale, float alpha)
 {
+	WorldContext& world = get_world_context();
 	m_id = id;
 
-	if (!s_background_texture.is_valid())
-	{
-		if (!s_background_texture.load_from_file(textures_path("bg_city.png")))
-		{
-			fprintf(stderr, "Failed to load background texture!");
-			return false;
-		}
-	}
+	if (!s_shared_init.run(load_textures))
+		return false;
 
 	rc_first.texture = &s_background_texture;
 	rc_second.texture = &s_background_texture;
@@ -31,14 +28,17 @@ bool Background::init(int id, float scale, float alpha)
 	mc_third.position = { 0.f, 0.f };
 	mc_third.physics.scale = { scale , scale };
 
-	s_render_components[id] = &rc_first;
-	s_motion_components[id] = &mc_first;
+	world.render_components.insert(id, &rc_first);
+	world.motion_components.insert(id, &mc_first);
 
-	s_render_components[id + 1] = &rc_second;
-	s_motion_components[id + 1] = &mc_second;
+	// The two other copies are drawn as entities of their own
+	int second_id = world.entities.create();
+	world.render_components.insert(second_id, &rc_second);
+	world.motion_components.insert(second_id, &mc_second);
 
-	s_render_components[id + 2] = &rc_third;
-	s_motion_components[id + 2] = &mc_third;
+	int third_id = world.entities.create();
+	world.render_components.insert(third_id, &rc_third);
+	world.motion_components.insert(third_id, &mc_third);
 
 	// rc_first.alpha = alpha;
 	// rc_second.alpha = alpha;
@@ -54,6 +54,16 @@ bool Background::init(int id, float scale, float alpha)
 	return true;
 }
 
+bool Background::load_textures()
+{
+	if (!s_background_texture.load_from_file(textures_path("bg_city.png")))
+	{
+		fprintf(stderr, "Failed to load background texture!");
+		return false;
+	}
+	return true;
+}
+
 void Background::set_position(vec2 position)
 {
 	float add_y = 150 - 600 * (1 - mc_first.physics.scale.x);
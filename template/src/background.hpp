@@ -7,6 +7,10 @@
 class Background : public Entity
 {
 	static Texture s_background_texture;
+	static SharedInit s_shared_init;
+
+	// Loads the textures every background shares, once for all worlds
+	static bool load_textures();
 
 	RenderComponent rc_first;
 	RenderComponent rc_second;
@@ -0,0 +1,29 @@
+// internal
+#include "common.hpp"
+#include "benchmark.hpp"
+
+// stlib
+#include <cstdlib>
+
+// Runs one of the offline benchmarks on the core alone, without a window, audio
+// device or GL context.
+//
+//   eitd_bench <name>
+//
+// Prints the results to stdout and fails if there is no benchmark called name or it
+// found something wrong.
+
+// Entry point
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s <name>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	// Levels are loaded for their simulation, textures are only read for their size
+	use_null_renderer();
+
+	return run_benchmark(argv[1]) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
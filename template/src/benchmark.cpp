@@ -0,0 +1,1573 @@
+#include "benchmark.hpp"
+#include "common.hpp"
+#include "level_graph.hpp"
+#include "flow_field.hpp"
+#include "path_service.hpp"
+#include "graph_editor.hpp"
+#include "crowd_system.hpp"
+#include "ghost.hpp"
+#include "ghost_lod.hpp"
+#include "job_system.hpp"
+#include "hitbox.hpp"
+#include "occupancy_grid.hpp"
+#include "particle_system.hpp"
+#include "random.hpp"
+#include "world_context.hpp"
+#include "json.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+using Clock = std::chrono::high_resolution_clock;
+
+namespace
+{
+	const char* SHIPPED_LEVELS[] = { "level_1", "level_2", "level_3", "level_4", "level_5", "level_6", "level_select", "maker_level" };
+	const int PATH_QUERIES = 2000;
+	const float PATH_QUERY_RANGE = 800.f; // ghosts only plan towards a robot this close
+	const unsigned GRAPH_THREAD_COUNTS[] = { 1, 2, 4, 8 };
+	const int GRAPH_REPEATS = 5; // best of, to keep scheduling noise out
+	const int RAY_QUERIES = 20000;
+	const char* FLOW_LEVELS[] = { "level_2", "level_6", "level_select" };
+	const int FLOW_GHOST_COUNTS[] = { 1, 10, 100, 1000 };
+	const int FLOW_TICKS = 600;
+	const int ASTAR_TICKS = 30; // every ghost searches every tick, so fewer of them
+	const int ROBOT_TICKS_PER_CELL = 20;
+	const int SWITCH_GHOST_COUNTS[] = { 10, 100, 1000 };
+	const int SWITCH_REPEATS = 20;
+	const int HPA_SIZES[] = { 100, 250, 500 };
+	const int HPA_QUERIES = 500;
+	const int HPA_ROOM_SIZE = 12;
+	const char* EDIT_LEVELS[] = { "level_2", "level_6", "level_select", "maker_level" };
+	const int EDIT_COUNT = 200;
+	const int EDIT_CHECK_EVERY = 20; // edits between comparisons with a generated graph
+	const char* CROWD_LEVEL = "level_crowd";
+	const int CROWD_TICKS = 1200;
+	const int LOD_TICKS = 1200;
+	const unsigned JOB_WORKER_COUNTS[] = { 1, 2, 4, 8 };
+	const int JOB_TICKS = 300;
+	const size_t PARTICLE_COUNT = 50000;
+	const float PARTICLE_LIFE_MS = 500.f; // as the rocket's smoke
+	const int PARTICLE_TICKS = 300;
+
+	double seconds_since(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	// Reads the bricks of a shipped level into layout
+	bool load_layout(const std::string& level, NavLayout& layout)
+	{
+		std::string filename = level_path;
+		filename.append(level);
+		filename.append(".json");
+
+		std::ifstream file(filename);
+		if (!file.is_open())
+		{
+			fprintf(stderr, "Failed to open %s\n", filename.c_str());
+			return false;
+		}
+
+		json j = json::parse(file);
+		layout.reset(j["size"]["width"], j["size"]["height"]);
+
+		for (json brick : j["bricks"])
+		{
+			vec2 pos = { brick["pos"]["x"], brick["pos"]["y"] };
+			vec3 colour = { brick["colour"]["r"], brick["colour"]["g"], brick["colour"]["b"] };
+			layout.add_brick(pos, colour);
+		}
+
+		return true;
+	}
+
+	// Pixel positions of every cell a ghost could be in with the headlight on channel
+	std::vector<vec2> free_positions(const NavLayout& layout, uint8_t channel)
+	{
+		std::vector<vec2> positions;
+		for (int y = 0; y < layout.height; y++)
+		{
+			for (int x = 0; x < layout.width; x++)
+			{
+				if (!(layout.blocked(x, y) & channel))
+				{
+					positions.push_back(to_pixel_position({ (float)x, (float)y }));
+				}
+			}
+		}
+		return positions;
+	}
+
+	// Random start and goal pairs in range of each other, the same on every run
+	std::vector<std::pair<vec2, vec2>> path_queries(const std::vector<vec2>& positions, uint64_t seed)
+	{
+		RandomStream rng;
+		rng.seed(seed);
+
+		std::vector<std::pair<vec2, vec2>> queries;
+		while (queries.size() < PATH_QUERIES)
+		{
+			vec2 start = positions[rng.next() % positions.size()];
+			vec2 goal = positions[rng.next() % positions.size()];
+			if (len(sub(start, goal)) < PATH_QUERY_RANGE)
+			{
+				queries.push_back(std::make_pair(start, goal));
+			}
+		}
+		return queries;
+	}
+
+	// The straight line test graphs were generated with before OccupancyGrid, kept to
+	// compare against. Walks the line in float steps and samples the corners of the
+	// box at each step, so it can miss cells the box only clips
+	uint8_t blocked(const NavLayout& layout, int row, int column)
+	{
+		if (row < 0 || row >= layout.height || column < 0 || column >= layout.width)
+		{
+			return NAV_ALL_CHANNELS;
+		}
+		return layout.blocked(column, row);
+	}
+
+	uint8_t legacy_clear_channels(const NavLayout& layout, vec2 a, vec2 b, uint8_t channels)
+	{
+		// Channels some cell along the way is blocked in, the walk is shared by all of them
+		uint8_t blocked_in = 0;
+
+		vec2 start = to_grid_position(a);
+		vec2 finish = to_grid_position(b);
+		vec2 disp = sub(finish, start);
+	
+		if (abs(disp.x) > abs(disp.y))
+		{
+			float xdist = 0.f;
+			float max = abs(disp.x);
+			float sign = disp.x / max;
+
+			while (xdist < abs(disp.x))
+			{
+				float xfirst = floor(xdist) + TOLERANCE;
+				float xlast = floor(xdist + 1.f + TOLERANCE) - TOLERANCE;
+
+				float yfirst = add(start, mul(disp, xfirst / max)).y;
+				float ylast = add(start, mul(disp, xlast / max)).y;
+
+				blocked_in |= blocked(layout, (int)floor(yfirst + 1.f - TOLERANCE), (int)floor(start.x + sign * xfirst)) |
+					blocked(layout, (int)floor(yfirst       + TOLERANCE), (int)floor(start.x + sign * xfirst)) |
+					blocked(layout, (int)floor(ylast  + 1.f - TOLERANCE), (int)floor(start.x + sign * xlast)) |
+					blocked(layout, (int)floor(ylast        + TOLERANCE), (int)floor(start.x + sign * xlast));
+				if ((channels & ~blocked_in) == 0)
+				{
+					return 0;
+				}
+
+				float remaining = max - xdist;
+				if (remaining - floor(remaining) > TOLERANCE)
+					xdist += remaining - floor(remaining);
+				else
+					xdist++;
+			}
+
+			return channels & ~blocked_in;
+		}
+		else
+		{
+			float ydist = 0.f;
+			float max = abs(disp.y);
+			float sign = disp.y / max;
+
+			while (ydist < abs(disp.y))
+			{
+				float yfirst = floor(ydist) + TOLERANCE;
+				float ylast = floor(ydist + 1.f + TOLERANCE) - TOLERANCE;
+
+				float xfirst = add(start, mul(disp, yfirst / max)).x;
+				float xlast = add(start, mul(disp, ylast / max)).x;
+
+				blocked_in |= blocked(layout, (int)floor(start.y + sign * yfirst), (int)floor(xfirst + 1.f - TOLERANCE)) |
+					blocked(layout, (int)floor(start.y + sign * yfirst), (int)floor(xfirst       + TOLERANCE)) |
+					blocked(layout, (int)floor(start.y + sign * ylast),  (int)floor(xlast  + 1.f - TOLERANCE)) |
+					blocked(layout, (int)floor(start.y + sign * ylast),  (int)floor(xlast        + TOLERANCE));
+				if ((channels & ~blocked_in) == 0)
+				{
+					return 0;
+				}
+
+				float remaining = max - ydist;
+				if (remaining - floor(remaining) > TOLERANCE)
+					ydist += remaining - floor(remaining);
+				else
+					ydist++;
+			}
+
+			return channels & ~blocked_in;
+		}
+
+		return 0;
+	}
+
+	// num / den with den > 0, compared exactly
+	struct Fraction { int64_t num; int64_t den; };
+
+	bool less(Fraction a, Fraction b)
+	{
+		return a.num * b.den < b.num * a.den;
+	}
+
+	// Narrows the open interval of t, from low to high, to where p0 + t * d is in the
+	// open interval (lo, hi). False if that leaves nothing
+	bool clip_axis(int64_t p0, int64_t d, int64_t lo, int64_t hi, Fraction& low, Fraction& high)
+	{
+		if (d == 0)
+		{
+			return lo < p0 && p0 < hi;
+		}
+
+		Fraction enter = { lo - p0, d };
+		Fraction leave = { hi - p0, d };
+		if (d < 0)
+		{
+			enter = { p0 - hi, -d };
+			leave = { p0 - lo, -d };
+		}
+
+		if (less(low, enter))
+			low = enter;
+		if (less(leave, high))
+			high = leave;
+		return less(low, high);
+	}
+
+	// Reference for OccupancyGrid::clear_channels: clips the line against the cell
+	// grown by the box, with exact fractions, for every cell near the line
+	uint8_t brute_force_clear_channels(const NavLayout& layout, vec2 a, vec2 b, uint8_t channels)
+	{
+		const int64_t S = OccupancyGrid::SUBDIVISIONS;
+		int64_t x0 = (int64_t)llround(a.x * S / brick_size);
+		int64_t y0 = (int64_t)llround(a.y * S / brick_size);
+		int64_t dx = (int64_t)llround(b.x * S / brick_size) - x0;
+		int64_t dy = (int64_t)llround(b.y * S / brick_size) - y0;
+
+		int first_x = (int)floor(std::min(a.x, b.x) / brick_size) - 2;
+		int last_x = (int)ceil(std::max(a.x, b.x) / brick_size) + 2;
+		int first_y = (int)floor(std::min(a.y, b.y) / brick_size) - 2;
+		int last_y = (int)ceil(std::max(a.y, b.y) / brick_size) + 2;
+
+		uint8_t clear = channels;
+		for (int y = first_y; y <= last_y; y++)
+		{
+			for (int x = first_x; x <= last_x; x++)
+			{
+				uint8_t hit = blocked(layout, y, x) & clear;
+				if (!hit)
+					continue;
+
+				// t in [0, 1], written as open (-1, 2) and clipped to [0, 1] below
+				Fraction low = { -1, 1 };
+				Fraction high = { 2, 1 };
+				if (clip_axis(x0, dx, (x - 1) * S, (x + 1) * S, low, high) &&
+					clip_axis(y0, dy, (y - 1) * S, (y + 1) * S, low, high) &&
+					less(low, { 1, 1 }) && less({ 0, 1 }, high))
+				{
+					clear &= ~hit;
+				}
+			}
+		}
+		return clear;
+	}
+
+	// Random slides between free cells, half of them from and to arbitrary pixels
+	// rather than cell corners, and a quarter along a row or column
+	std::vector<std::pair<vec2, vec2>> ray_queries(const std::vector<vec2>& positions, uint64_t seed)
+	{
+		RandomStream rng;
+		rng.seed(seed);
+
+		std::vector<std::pair<vec2, vec2>> queries;
+		for (int i = 0; i < RAY_QUERIES; i++)
+		{
+			vec2 from = positions[rng.next() % positions.size()];
+			vec2 to = positions[rng.next() % positions.size()];
+			if (i % 2)
+			{
+				from = add(from, { (float)(rng.next() % 64) - 32.f, (float)(rng.next() % 64) - 32.f });
+				to = add(to, { (float)(rng.next() % 64) - 32.f, (float)(rng.next() % 64) - 32.f });
+			}
+			if (i % 8 == 0)
+				to.y = from.y;
+			else if (i % 8 == 4)
+				to.x = from.x;
+			queries.push_back(std::make_pair(from, to));
+		}
+		return queries;
+	}
+
+	// A* queries per second on the white channel of every shipped level
+	bool bench_paths()
+	{
+		printf("%-14s %6s %7s %12s %8s\n", "level", "nodes", "edges", "paths/s", "found");
+
+		for (size_t i = 0; i < sizeof(SHIPPED_LEVELS) / sizeof(SHIPPED_LEVELS[0]); i++)
+		{
+			NavLayout layout;
+			if (!load_layout(SHIPPED_LEVELS[i], layout))
+			{
+				return false;
+			}
+
+			LevelGraph graph;
+			graph.generate(layout, get_job_system());
+
+			std::vector<vec2> positions = free_positions(layout, NAV_WHITE);
+			if (positions.empty())
+			{
+				continue;
+			}
+			std::vector<std::pair<vec2, vec2>> queries = path_queries(positions, i + 1);
+
+			int found = 0;
+			Clock::time_point start = Clock::now();
+			for (auto& query : queries)
+			{
+				if (!graph.get_path(query.first, query.second, NAV_WHITE).empty())
+				{
+					found++;
+				}
+			}
+			double elapsed = seconds_since(start);
+
+			printf("%-14s %6zu %7zu %12.0f %4d/%d\n", SHIPPED_LEVELS[i], graph.get_node_count(),
+				graph.get_edge_count(), queries.size() / elapsed, found, (int)queries.size());
+		}
+
+		return true;
+	}
+
+	// Straight line tests per second, old float walk against the occupancy grid, and
+	// the grid checked against the brute force reference
+	bool bench_raycast()
+	{
+		printf("%-14s %12s %12s %8s %11s %10s\n", "level", "legacy/s", "grid/s", "speedup", "mismatches", "vs legacy");
+
+		bool ok = true;
+		for (size_t i = 0; i < sizeof(SHIPPED_LEVELS) / sizeof(SHIPPED_LEVELS[0]); i++)
+		{
+			NavLayout layout;
+			if (!load_layout(SHIPPED_LEVELS[i], layout))
+			{
+				return false;
+			}
+
+			OccupancyGrid grid;
+			grid.build(layout);
+
+			std::vector<vec2> positions = free_positions(layout, NAV_WHITE);
+			if (positions.empty())
+			{
+				continue;
+			}
+			std::vector<std::pair<vec2, vec2>> queries = ray_queries(positions, i + 1);
+			std::vector<uint8_t> legacy(queries.size());
+			std::vector<uint8_t> exact(queries.size());
+
+			Clock::time_point start = Clock::now();
+			for (size_t q = 0; q < queries.size(); q++)
+			{
+				legacy[q] = legacy_clear_channels(layout, queries[q].first, queries[q].second, NAV_ALL_CHANNELS);
+			}
+			double legacy_time = seconds_since(start);
+
+			start = Clock::now();
+			for (size_t q = 0; q < queries.size(); q++)
+			{
+				exact[q] = grid.clear_channels(queries[q].first, queries[q].second, NAV_ALL_CHANNELS);
+			}
+			double grid_time = seconds_since(start);
+
+			int mismatches = 0;
+			int disagreements = 0;
+			for (size_t q = 0; q < queries.size(); q++)
+			{
+				if (exact[q] != brute_force_clear_channels(layout, queries[q].first, queries[q].second, NAV_ALL_CHANNELS))
+					mismatches++;
+				if (exact[q] != legacy[q])
+					disagreements++;
+			}
+
+			printf("%-14s %12.0f %12.0f %7.2fx %11d %10d\n", SHIPPED_LEVELS[i], queries.size() / legacy_time,
+				queries.size() / grid_time, legacy_time / grid_time, mismatches, disagreements);
+			ok = ok && mismatches == 0;
+		}
+
+		return ok;
+	}
+
+	// Robot positions for ticks updates, walking between neighbouring free cells one
+	// cell every ROBOT_TICKS_PER_CELL ticks
+	std::vector<vec2> robot_walk(const NavLayout& layout, vec2 start, int ticks, uint64_t seed)
+	{
+		const vec2 steps[] = { { 1.f, 0.f }, { -1.f, 0.f }, { 0.f, 1.f }, { 0.f, -1.f } };
+
+		RandomStream rng;
+		rng.seed(seed);
+
+		std::vector<vec2> walk;
+		vec2 cell = to_grid_position(start);
+		vec2 next = cell;
+		for (int t = 0; t < ticks; t++)
+		{
+			int step = t % ROBOT_TICKS_PER_CELL;
+			if (step == 0)
+			{
+				cell = next;
+				for (int tries = 0; tries < 8; tries++)
+				{
+					vec2 candidate = add(cell, steps[rng.next() % 4]);
+					int x = (int)candidate.x;
+					int y = (int)candidate.y;
+					if (x >= 0 && x < layout.width && y >= 0 && y < layout.height && !(layout.blocked(x, y) & NAV_WHITE))
+					{
+						next = candidate;
+						break;
+					}
+				}
+			}
+			float f = (float)step / ROBOT_TICKS_PER_CELL;
+			walk.push_back(to_pixel_position(add(mul(cell, 1.f - f), mul(next, f))));
+		}
+		return walk;
+	}
+
+	// Planning time per update for a crowd of ghosts chasing a moving robot, every
+	// ghost searching with A* against all of them reading one flow field
+	bool bench_flow()
+	{
+		printf("%-14s %7s %14s %14s %9s %8s\n", "level", "ghosts", "A* ms/tick", "field ms/tick", "rebuilds", "avoided");
+
+		for (size_t i = 0; i < sizeof(FLOW_LEVELS) / sizeof(FLOW_LEVELS[0]); i++)
+		{
+			NavLayout layout;
+			if (!load_layout(FLOW_LEVELS[i], layout))
+			{
+				return false;
+			}
+
+			LevelGraph graph;
+			graph.generate(layout, get_job_system());
+
+			std::vector<vec2> positions = free_positions(layout, NAV_WHITE);
+			if (positions.empty())
+			{
+				continue;
+			}
+
+			for (int ghost_count : FLOW_GHOST_COUNTS)
+			{
+				RandomStream rng;
+				rng.seed(i + 1);
+				std::vector<vec2> ghosts;
+				for (int g = 0; g < ghost_count; g++)
+				{
+					ghosts.push_back(positions[rng.next() % positions.size()]);
+				}
+				std::vector<vec2> walk = robot_walk(layout, positions[rng.next() % positions.size()], FLOW_TICKS, i + 1);
+
+				// What Ghost::update did before: a search per ghost per update
+				Clock::time_point start = Clock::now();
+				for (int t = 0; t < ASTAR_TICKS; t++)
+				{
+					for (vec2 ghost : ghosts)
+					{
+						if (len(sub(walk[t], ghost)) < PATH_QUERY_RANGE)
+						{
+							graph.get_path(ghost, walk[t], NAV_WHITE);
+						}
+					}
+				}
+				double astar_time = seconds_since(start) / ASTAR_TICKS;
+
+				// Ghosts stand still, so each one enters the field once and reads a step
+				// off it every update, as in Ghost::update a ghost with no way onto the
+				// field only looks again once it is rebuilt
+				FlowField field;
+				field.set_graph(&graph);
+				std::vector<int> targets(ghosts.size(), LevelGraph::UNREACHABLE);
+				std::vector<int> lost_at(ghosts.size(), -1);
+
+				start = Clock::now();
+				for (int t = 0; t < FLOW_TICKS; t++)
+				{
+					field.set_goal(walk[t], NAV_WHITE);
+					for (size_t g = 0; g < ghosts.size(); g++)
+					{
+						if (targets[g] == LevelGraph::UNREACHABLE)
+						{
+							if (lost_at[g] != field.get_rebuild_count())
+							{
+								targets[g] = field.enter(ghosts[g], NAV_WHITE);
+								lost_at[g] = field.get_rebuild_count();
+							}
+						}
+						else if (targets[g] != LevelGraph::TO_GOAL)
+						{
+							field.next(targets[g], NAV_WHITE);
+						}
+						else if (!field.can_see_goal(ghosts[g], NAV_WHITE))
+						{
+							targets[g] = LevelGraph::UNREACHABLE;
+						}
+					}
+				}
+				double field_time = seconds_since(start) / FLOW_TICKS;
+
+				printf("%-14s %7d %14.3f %14.3f %9d %8d\n", FLOW_LEVELS[i], ghost_count,
+					astar_time * 1000.0, field_time * 1000.0, field.get_rebuild_count(), field.get_rebuilds_avoided());
+			}
+		}
+
+		return true;
+	}
+
+	// Cost of a headlight colour change to the updates around it: every ghost finding
+	// its way onto the new channel's field itself, against handing that to PathService.
+	// Answers are taken PathService::ANSWER_TICKS updates later, the game idles between
+	// updates meanwhile, and due is how long the update they are taken on is held up
+	bool bench_switch()
+	{
+		printf("%-14s %7s %12s %12s %14s %10s\n", "level", "ghosts", "inline ms", "submit ms", "answered ms", "due ms");
+
+		const std::chrono::microseconds answer_time_allowed(
+			(long long)(PathService::ANSWER_TICKS * SIMULATION_STEP_MS * 1000.f));
+
+		for (size_t i = 0; i < sizeof(FLOW_LEVELS) / sizeof(FLOW_LEVELS[0]); i++)
+		{
+			NavLayout layout;
+			if (!load_layout(FLOW_LEVELS[i], layout))
+			{
+				return false;
+			}
+
+			LevelGraph graph;
+			graph.generate(layout, get_job_system());
+
+			std::vector<vec2> positions = free_positions(layout, NAV_WHITE);
+			if (positions.empty())
+			{
+				continue;
+			}
+
+			FlowField field;
+			field.set_graph(&graph);
+			PathService service;
+			service.start(&graph);
+
+			for (int ghost_count : SWITCH_GHOST_COUNTS)
+			{
+				RandomStream rng;
+				rng.seed(i + 1);
+				std::vector<vec2> ghosts;
+				for (int g = 0; g < ghost_count; g++)
+				{
+					ghosts.push_back(positions[rng.next() % positions.size()]);
+				}
+				field.set_goal(positions[rng.next() % positions.size()], NAV_WHITE);
+
+				double inline_time = 0.0;
+				double submit_time = 0.0;
+				double answer_time = 0.0;
+				double due_time = 0.0;
+				for (int r = 0; r < SWITCH_REPEATS; r++)
+				{
+					Clock::time_point start = Clock::now();
+					for (vec2 ghost : ghosts)
+					{
+						field.enter(ghost, NAV_WHITE);
+					}
+					inline_time += seconds_since(start);
+
+					start = Clock::now();
+					for (int g = 0; g < ghost_count; g++)
+					{
+						PathService::Request request = { g, 0, PathService::ANSWER_TICKS, ghosts[g], field.get_goal(),
+							NAV_WHITE, field.get_field(NAV_WHITE) };
+						service.submit(request);
+					}
+					service.flush();
+					submit_time += seconds_since(start);
+
+					// Until the update the answers are due on, as the game would between updates
+					std::this_thread::sleep_until(start + answer_time_allowed);
+					Clock::time_point due_start = Clock::now();
+					service.wait(PathService::ANSWER_TICKS);
+					due_time += seconds_since(due_start);
+
+					int answered = 0;
+					PathService::Result result;
+					while (service.collect(result))
+					{
+						answered++;
+					}
+					if (answered != ghost_count)
+					{
+						return false;
+					}
+
+					// Without the updates in between, as fast as the worker answers
+					start = Clock::now();
+					for (int g = 0; g < ghost_count; g++)
+					{
+						PathService::Request request = { g, 0, 0, ghosts[g], field.get_goal(), NAV_WHITE,
+							field.get_field(NAV_WHITE) };
+						service.submit(request);
+					}
+					service.wait();
+					while (service.collect(result)) {}
+					answer_time += seconds_since(start);
+				}
+
+				printf("%-14s %7d %12.3f %12.3f %14.3f %10.3f\n", FLOW_LEVELS[i], ghost_count,
+					inline_time * 1000.0 / SWITCH_REPEATS, submit_time * 1000.0 / SWITCH_REPEATS,
+					answer_time * 1000.0 / SWITCH_REPEATS, due_time * 1000.0 / SWITCH_REPEATS);
+			}
+		}
+
+		return true;
+	}
+
+	// A size x size level that is the same on every run: a white border, rooms of
+	// HPA_ROOM_SIZE cells with one or two doorways in each wall, a quarter of them
+	// shut by a coloured brick, and scattered white and coloured pillars
+	void procedural_layout(int size, uint64_t seed, NavLayout& layout)
+	{
+		RandomStream rng;
+		rng.seed(seed);
+
+		const vec3 colours[] = { { 1.f, 1.f, 1.f }, { 1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, { 0.f, 0.f, 1.f } };
+		std::vector<int> grid(size * size, -1); // colour index of the brick in each cell
+
+		for (int i = 0; i < size; i++)
+		{
+			grid[i] = grid[(size - 1) * size + i] = 0;
+			grid[i * size] = grid[i * size + size - 1] = 0;
+		}
+
+		for (int line = HPA_ROOM_SIZE; line < size - 1; line += HPA_ROOM_SIZE)
+		{
+			for (int i = 1; i < size - 1; i++)
+			{
+				grid[line * size + i] = 0;
+				grid[i * size + line] = 0;
+			}
+
+			// Doorways in each wall between two crossings, along the row then the column
+			for (int from = 1; from < size - 1; from += HPA_ROOM_SIZE)
+			{
+				int length = std::min(HPA_ROOM_SIZE - 1, size - 1 - from);
+				int doors = 1 + (int)(rng.next() % 2);
+				for (int d = 0; d < doors && length > 2; d++)
+				{
+					int at = from + (int)(rng.next() % (length - 1));
+					int colour = rng.next() % 4 == 0 ? 1 + (int)(rng.next() % 3) : -1;
+					grid[line * size + at] = grid[line * size + at + 1] = colour;
+				}
+				doors = 1 + (int)(rng.next() % 2);
+				for (int d = 0; d < doors && length > 2; d++)
+				{
+					int at = from + (int)(rng.next() % (length - 1));
+					int colour = rng.next() % 4 == 0 ? 1 + (int)(rng.next() % 3) : -1;
+					grid[at * size + line] = grid[(at + 1) * size + line] = colour;
+				}
+			}
+		}
+
+		for (int cell = 0; cell < size * size; cell++)
+		{
+			if (grid[cell] < 0 && rng.next() % 100 < 3)
+			{
+				grid[cell] = rng.next() % 3 == 0 ? 1 + (int)(rng.next() % 3) : 0;
+			}
+		}
+
+		layout.reset(size, size);
+		for (int cell = 0; cell < size * size; cell++)
+		{
+			if (grid[cell] >= 0)
+			{
+				layout.add_brick({ (float)(cell % size), (float)(cell / size) }, colours[grid[cell]]);
+			}
+		}
+	}
+
+	// Connected areas of free cells in channel, a ghost can get between two cells
+	// exactly when they have the same label
+	std::vector<int> free_areas(const NavLayout& layout, uint8_t channel)
+	{
+		std::vector<int> area(layout.width * layout.height, -1);
+		std::vector<int> stack;
+		int areas = 0;
+		for (int cell = 0; cell < (int)area.size(); cell++)
+		{
+			if (area[cell] >= 0 || (layout.cells[cell] & channel))
+				continue;
+
+			area[cell] = areas;
+			stack.assign(1, cell);
+			while (!stack.empty())
+			{
+				int at = stack.back();
+				stack.pop_back();
+				int x = at % layout.width;
+				int y = at / layout.width;
+				int neighbours[4][2] = { { x - 1, y }, { x + 1, y }, { x, y - 1 }, { x, y + 1 } };
+				for (auto& n : neighbours)
+				{
+					if (n[0] < 0 || n[0] >= layout.width || n[1] < 0 || n[1] >= layout.height)
+						continue;
+					int to = n[1] * layout.width + n[0];
+					if (area[to] < 0 && !(layout.cells[to] & channel))
+					{
+						area[to] = areas;
+						stack.push_back(to);
+					}
+				}
+			}
+			areas++;
+		}
+		return area;
+	}
+
+	// Graph build time, flow field time and paths across the whole level on
+	// procedural levels, small ones get a node per critical point and large ones
+	// a ClusterGraph. Found counts the paths A* returned, reachable the ones that exist,
+	// and the two must agree
+	bool bench_hpa()
+	{
+		printf("%-6s %10s %7s %7s %9s %10s %8s %9s\n", "size", "build", "nodes", "edges", "flow", "paths/s", "found", "reachable");
+
+		bool ok = true;
+
+		for (int size : HPA_SIZES)
+		{
+			NavLayout layout;
+			procedural_layout(size, (uint64_t)size, layout);
+
+			LevelGraph graph;
+			Clock::time_point start = Clock::now();
+			graph.generate(layout, get_job_system());
+			double build = seconds_since(start);
+
+			std::vector<vec2> positions = free_positions(layout, NAV_WHITE);
+			std::vector<int> area = free_areas(layout, NAV_WHITE);
+			RandomStream rng;
+			rng.seed(size);
+
+			std::vector<std::pair<vec2, vec2>> queries;
+			int reachable = 0;
+			for (int i = 0; i < HPA_QUERIES; i++)
+			{
+				vec2 from = positions[rng.next() % positions.size()];
+				vec2 to = positions[rng.next() % positions.size()];
+				vec2 a = to_grid_position(from);
+				vec2 b = to_grid_position(to);
+				if (area[(int)a.y * size + (int)a.x] == area[(int)b.y * size + (int)b.x])
+				{
+					reachable++;
+				}
+				queries.push_back(std::make_pair(from, to));
+			}
+
+			std::vector<float> distance;
+			std::vector<int> next;
+			start = Clock::now();
+			graph.flow_to(queries[0].second, NAV_WHITE, distance, next);
+			double flow = seconds_since(start);
+
+			int found = 0;
+			start = Clock::now();
+			for (auto& query : queries)
+			{
+				if (!graph.get_path(query.first, query.second, NAV_WHITE).empty())
+				{
+					found++;
+				}
+			}
+			double elapsed = seconds_since(start);
+
+			printf("%-6d %7.1f ms %7zu %7zu %6.2f ms %10.0f %8d %9d\n", size, build * 1000.0, graph.get_node_count(),
+				graph.get_edge_count(), flow * 1000.0, queries.size() / elapsed, found, reachable);
+			ok &= found == reachable;
+		}
+
+		return ok;
+	}
+
+	// The layout with the bricks of grid, a brick of the right colour in every blocked cell
+	void layout_of(const OccupancyGrid& grid, NavLayout& layout)
+	{
+		layout.reset(grid.get_width(), grid.get_height());
+		for (int y = 0; y < grid.get_height(); y++)
+		{
+			for (int x = 0; x < grid.get_width(); x++)
+			{
+				uint8_t blocked = grid.blocked(x, y);
+				if (blocked)
+				{
+					vec3 colour = blocked == NAV_ALL_CHANNELS ? vec3{ 1.f, 1.f, 1.f } :
+						vec3{ blocked & NAV_RED ? 1.f : 0.f, blocked & NAV_GREEN ? 1.f : 0.f, blocked & NAV_BLUE ? 1.f : 0.f };
+					layout.add_brick({ (float)x, (float)y }, colour);
+				}
+			}
+		}
+	}
+
+	// Whether two graphs have the same nodes and find paths of the same length
+	bool same_graph(const LevelGraph& a, const LevelGraph& b, const std::vector<std::pair<vec2, vec2>>& queries)
+	{
+		if (a.get_node_count() != b.get_node_count() || a.get_edge_count() != b.get_edge_count())
+		{
+			return false;
+		}
+		for (int i = 0; i < (int)a.get_node_count(); i++)
+		{
+			if (a.get_node(i).x != b.get_node(i).x || a.get_node(i).y != b.get_node(i).y)
+				return false;
+		}
+		for (auto& query : queries)
+		{
+			std::vector<vec2> path_a = a.get_path(query.first, query.second, NAV_WHITE);
+			std::vector<vec2> path_b = b.get_path(query.first, query.second, NAV_WHITE);
+			float length_a = 0.f;
+			float length_b = 0.f;
+			for (size_t i = 1; i < path_a.size(); i++)
+				length_a += len(sub(path_a[i], path_a[i - 1]));
+			for (size_t i = 1; i < path_b.size(); i++)
+				length_b += len(sub(path_b[i], path_b[i - 1]));
+			if (path_a.empty() != path_b.empty() || fabs(length_a - length_b) > 0.01f)
+				return false;
+		}
+		return true;
+	}
+
+	// Random bricks placed and taken away with a GraphEditor, against generating the
+	// graph again, and every few edits both graphs compared
+	bool bench_edit()
+	{
+		printf("%-14s %10s %10s %8s %8s\n", "level", "edit", "generate", "tested", "same");
+
+		const uint8_t kinds[] = { NAV_ALL_CHANNELS, NAV_RED, NAV_GREEN, NAV_BLUE };
+		bool ok = true;
+		for (const char* level : EDIT_LEVELS)
+		{
+			NavLayout layout;
+			if (!load_layout(level, layout))
+			{
+				return false;
+			}
+
+			LevelGraph edited;
+			GraphEditor editor;
+			editor.begin(&edited, layout);
+
+			RandomStream rng;
+			rng.seed(7);
+			std::vector<std::pair<vec2, vec2>> queries = path_queries(free_positions(layout, NAV_WHITE), 3);
+			queries.resize(200);
+
+			double edit_time = 0.0;
+			double generate_time = 0.0;
+			long tested = 0;
+			int checks = 0;
+			int same = 0;
+			for (int e = 1; e <= EDIT_COUNT; e++)
+			{
+				int x = 1 + (int)(rng.next() % (layout.width - 2));
+				int y = 1 + (int)(rng.next() % (layout.height - 2));
+				uint8_t blocked = edited.get_grid().blocked(x, y) ? 0 : kinds[rng.next() % 4];
+
+				Clock::time_point start = Clock::now();
+				editor.set_cell(x, y, blocked);
+				edit_time += seconds_since(start);
+				tested += editor.get_pairs_tested();
+
+				if (e % EDIT_CHECK_EVERY == 0)
+				{
+					NavLayout current;
+					layout_of(edited.get_grid(), current);
+					LevelGraph generated;
+					start = Clock::now();
+					generated.generate(current, get_job_system());
+					generate_time += seconds_since(start);
+
+					checks++;
+					if (same_graph(edited, generated, queries))
+						same++;
+				}
+			}
+
+			printf("%-14s %7.3f ms %7.3f ms %8ld %5d/%d\n", level, edit_time * 1000.0 / EDIT_COUNT,
+				generate_time * 1000.0 / checks, tested / EDIT_COUNT, same, checks);
+			ok &= same == checks;
+		}
+
+		return ok;
+	}
+
+	// Reads the ghosts and the robot's spawn of a shipped level
+	bool load_spawns(const std::string& level, std::vector<vec2>& ghosts, vec2& robot)
+	{
+		std::string filename = level_path;
+		filename.append(level);
+		filename.append(".json");
+
+		std::ifstream file(filename);
+		if (!file.is_open())
+		{
+			fprintf(stderr, "Failed to open %s\n", filename.c_str());
+			return false;
+		}
+
+		json j = json::parse(file);
+		for (json ghost : j["ghosts"])
+		{
+			ghosts.push_back(to_pixel_position({ ghost["pos"]["x"], ghost["pos"]["y"] }));
+		}
+		robot = to_pixel_position({ j["spawn"]["pos"]["x"], j["spawn"]["pos"]["y"] });
+		return true;
+	}
+
+	// Puts a ghost at every spawn as Level::load_level does, white so they all chase,
+	// following field and finding their own way onto it. world must be bound
+	bool spawn_ghosts(WorldContext& world, const std::vector<vec2>& spawns, const FlowField& field,
+		std::vector<std::unique_ptr<Ghost>>& ghosts)
+	{
+		vec3 white = { 1.f, 1.f, 1.f };
+		for (vec2 spawn : spawns)
+		{
+			std::unique_ptr<Ghost> ghost(new Ghost());
+			if (!ghost->init(world.entities.create(), white, white))
+			{
+				return false;
+			}
+			ghost->set_position(spawn);
+			ghost->set_flow_field(&field);
+			ghost->set_nav_channel(NAV_WHITE);
+			ghosts.push_back(std::move(ghost));
+		}
+		return true;
+	}
+
+	// Pushes the moving ghosts apart and hands them their pushes, as Level::update does
+	// after updating them
+	void separate_ghosts(const std::vector<std::unique_ptr<Ghost>>& ghosts, CrowdSystem& crowd,
+		std::vector<vec2>& positions, std::vector<uint8_t>& moving, std::vector<vec2>& pushes)
+	{
+		for (size_t g = 0; g < ghosts.size(); g++)
+		{
+			positions[g] = ghosts[g]->get_position();
+			moving[g] = ghosts[g]->is_moving();
+		}
+		crowd.build(positions);
+		crowd.separate(positions, moving, pushes);
+		for (size_t g = 0; g < ghosts.size(); g++)
+		{
+			if (moving[g])
+			{
+				ghosts[g]->push(pushes[g]);
+			}
+		}
+	}
+
+	std::vector<vec2> get_positions(const std::vector<std::unique_ptr<Ghost>>& ghosts)
+	{
+		std::vector<vec2> positions;
+		for (const std::unique_ptr<Ghost>& ghost : ghosts)
+		{
+			positions.push_back(ghost->get_position());
+		}
+		return positions;
+	}
+
+	// Update cost of the stress level's ghosts chasing the robot, left to pile up and
+	// pushed apart. Every ghost updates every tick. The robot is tested against the
+	// ghosts hashed near it, and against all of them as before
+	bool bench_crowd()
+	{
+		NavLayout layout;
+		std::vector<vec2> spawns;
+		vec2 robot;
+		if (!load_layout(CROWD_LEVEL, layout) || !load_spawns(CROWD_LEVEL, spawns, robot))
+		{
+			return false;
+		}
+
+		LevelGraph graph;
+		graph.generate(layout, get_job_system());
+		std::vector<vec2> walk = robot_walk(layout, robot, CROWD_TICKS, 1);
+		size_t count = spawns.size();
+
+		printf("%-10s %7s %10s %10s %12s %12s %9s\n", "crowd", "ghosts", "ms/tick", "crowd ms", "near tests",
+			"all tests ms", "overlaps");
+
+		for (int separating = 0; separating < 2; separating++)
+		{
+			WorldContext world;
+			WorldContextScope world_scope(&world);
+			FlowField field;
+			field.set_graph(&graph);
+			CrowdSystem crowd;
+			std::vector<std::unique_ptr<Ghost>> ghosts;
+			if (!spawn_ghosts(world, spawns, field, ghosts))
+			{
+				return false;
+			}
+
+			std::vector<vec2> positions(count);
+			std::vector<uint8_t> moving(count);
+			std::vector<vec2> pushes;
+			std::vector<int> nearby;
+
+			double crowd_time = 0.0;
+			double all_time = 0.0;
+			long near_tests = 0;
+			Clock::time_point start = Clock::now();
+			for (int t = 0; t < CROWD_TICKS; t++)
+			{
+				field.set_goal(walk[t], NAV_WHITE);
+				for (const std::unique_ptr<Ghost>& ghost : ghosts)
+				{
+					ghost->set_goal(walk[t]);
+					ghost->update(SIMULATION_STEP_MS);
+				}
+
+				Clock::time_point crowd_start = Clock::now();
+				if (separating)
+				{
+					separate_ghosts(ghosts, crowd, positions, moving, pushes);
+				}
+				else
+				{
+					crowd.build(get_positions(ghosts));
+				}
+				crowd_time += seconds_since(crowd_start);
+
+				world.motion_system.step(SIMULATION_STEP_MS);
+
+				Hitbox robot_hitbox({ Circle(walk[t], (int)brick_size / 2) }, {});
+				crowd.query(walk[t], GHOST_REACH, nearby);
+				for (int g : nearby)
+				{
+					ghosts[g]->get_hitbox().collides_with(robot_hitbox);
+				}
+				near_tests += nearby.size();
+
+				// Taken out of the update time, it is only there to compare against
+				Clock::time_point all_start = Clock::now();
+				for (const std::unique_ptr<Ghost>& ghost : ghosts)
+				{
+					ghost->get_hitbox().collides_with(robot_hitbox);
+				}
+				all_time += seconds_since(all_start);
+			}
+			double tick_time = (seconds_since(start) - all_time) / CROWD_TICKS;
+
+			// Ghosts less than half a brick apart at the end
+			int overlaps = 0;
+			positions = get_positions(ghosts);
+			crowd.build(positions);
+			for (size_t g = 0; g < count; g++)
+			{
+				crowd.query(positions[g], brick_size / 2.f, nearby);
+				for (int other : nearby)
+				{
+					overlaps += other > (int)g;
+				}
+			}
+
+			printf("%-10s %7zu %10.3f %10.3f %12.1f %12.3f %9d\n", separating ? "separated" : "piled", count,
+				tick_time * 1000.0, crowd_time * 1000.0 / CROWD_TICKS, (double)near_tests / CROWD_TICKS,
+				all_time * 1000.0 / CROWD_TICKS, overlaps);
+		}
+
+		return true;
+	}
+
+	// The stress level's ghosts with every one updating every tick, against updating
+	// them by GhostLod's tiers. Both are pushed apart as in Level::update, and the
+	// tiered run is compared with the other for where the ghosts end up
+	bool bench_lod()
+	{
+		NavLayout layout;
+		std::vector<vec2> spawns;
+		vec2 robot;
+		if (!load_layout(CROWD_LEVEL, layout) || !load_spawns(CROWD_LEVEL, spawns, robot))
+		{
+			return false;
+		}
+
+		LevelGraph graph;
+		graph.generate(layout, get_job_system());
+
+		// The robot walks from the middle of the crowd, so there are ghosts in every tier
+		std::vector<vec2> walk = robot_walk(layout, spawns[spawns.size() / 2], LOD_TICKS, 2);
+		size_t count = spawns.size();
+
+		printf("%-8s %7s %10s %10s %8s %8s %8s %10s\n", "ai", "ghosts", "ms/tick", "updates", "near", "mid",
+			"parked", "offset px");
+
+		std::vector<vec2> every_tick;
+		for (int tiered = 0; tiered < 2; tiered++)
+		{
+			WorldContext world;
+			WorldContextScope world_scope(&world);
+			FlowField field;
+			field.set_graph(&graph);
+			CrowdSystem crowd;
+			GhostLod lod;
+			std::vector<std::unique_ptr<Ghost>> ghosts;
+			if (!spawn_ghosts(world, spawns, field, ghosts))
+			{
+				return false;
+			}
+
+			std::vector<vec2> positions(count);
+			std::vector<uint8_t> chasing(count, 1);
+			std::vector<uint8_t> moving(count);
+			std::vector<vec2> pushes;
+
+			double update_time = 0.0;
+			long updates = 0;
+			long tiers[GhostLod::TIER_COUNT] = {};
+			for (int t = 0; t < LOD_TICKS; t++)
+			{
+				field.set_goal(walk[t], NAV_WHITE);
+
+				Clock::time_point start = Clock::now();
+				if (tiered)
+				{
+					for (size_t g = 0; g < count; g++)
+					{
+						moving[g] = ghosts[g]->is_moving();
+					}
+					lod.schedule(crowd, walk[t], chasing, moving, t);
+				}
+				for (size_t g = 0; g < count; g++)
+				{
+					if (tiered && !lod.is_due(g))
+					{
+						continue;
+					}
+					ghosts[g]->set_goal(walk[t]);
+					ghosts[g]->update(tiered ? lod.get_span(g, SIMULATION_STEP_MS) : SIMULATION_STEP_MS);
+					updates++;
+				}
+				update_time += seconds_since(start);
+
+				if (tiered)
+				{
+					for (size_t g = 0; g < count; g++)
+					{
+						tiers[lod.get_tier(g)]++;
+					}
+				}
+
+				separate_ghosts(ghosts, crowd, positions, moving, pushes);
+				world.motion_system.step(SIMULATION_STEP_MS);
+			}
+
+			double offset = 0.0;
+			positions = get_positions(ghosts);
+			if (tiered)
+			{
+				for (size_t g = 0; g < count; g++)
+				{
+					offset += len(sub(positions[g], every_tick[g]));
+				}
+				offset /= count;
+			}
+			else
+			{
+				every_tick = positions;
+			}
+
+			printf("%-8s %7zu %10.3f %10.1f %8.1f %8.1f %8.1f %10.1f\n", tiered ? "tiered" : "every", count,
+				update_time * 1000.0 / LOD_TICKS, (double)updates / LOD_TICKS, (double)tiers[GhostLod::NEAR] / LOD_TICKS,
+				(double)tiers[GhostLod::MID] / LOD_TICKS, (double)tiers[GhostLod::PARKED] / LOD_TICKS, offset);
+		}
+
+		return true;
+	}
+
+	// Ticks of the stress level's crowd as jobs with 1 to 8 workers. The ghosts update,
+	// then they are pushed apart, each stage split up with parallel_for and started by
+	// the one before finishing, then the motion system moves them. Where the ghosts end
+	// up must not depend on the number of workers
+	bool bench_jobs()
+	{
+		NavLayout layout;
+		std::vector<vec2> spawns;
+		vec2 robot;
+		if (!load_layout(CROWD_LEVEL, layout) || !load_spawns(CROWD_LEVEL, spawns, robot))
+		{
+			return false;
+		}
+
+		LevelGraph graph;
+		graph.generate(layout, get_job_system());
+		std::vector<vec2> walk = robot_walk(layout, robot, JOB_TICKS, 3);
+		size_t count = spawns.size();
+
+		printf("%-8s %7s %10s %8s %18s\n", "workers", "ghosts", "ms/tick", "speedup", "state");
+
+		double serial = 0.0;
+		uint64_t expected = 0;
+		bool ok = true;
+		for (unsigned workers : JOB_WORKER_COUNTS)
+		{
+			JobSystem jobs(workers);
+			WorldContext world;
+			WorldContextScope world_scope(&world);
+			FlowField field;
+			field.set_graph(&graph);
+			CrowdSystem crowd;
+			std::vector<std::unique_ptr<Ghost>> ghosts;
+			if (!spawn_ghosts(world, spawns, field, ghosts))
+			{
+				return false;
+			}
+
+			std::vector<vec2> positions(count);
+			std::vector<uint8_t> moving(count);
+			std::vector<vec2> pushes(count);
+
+			Clock::time_point start = Clock::now();
+			for (int t = 0; t < JOB_TICKS; t++)
+			{
+				field.set_goal(walk[t], NAV_WHITE);
+
+				JobSystem::Handle follow = jobs.submit([&]()
+				{
+					jobs.parallel_for(count, GHOST_UPDATE_GRAIN, [&](size_t begin, size_t end)
+					{
+						for (size_t g = begin; g < end; g++)
+						{
+							ghosts[g]->set_goal(walk[t]);
+							ghosts[g]->update(SIMULATION_STEP_MS);
+						}
+					});
+				});
+				JobSystem::Handle separate = jobs.submit([&]()
+				{
+					for (size_t g = 0; g < count; g++)
+					{
+						positions[g] = ghosts[g]->get_position();
+						moving[g] = ghosts[g]->is_moving();
+					}
+					crowd.build(positions);
+					jobs.parallel_for(count, GHOST_UPDATE_GRAIN, [&](size_t begin, size_t end)
+					{
+						crowd.separate(positions, moving, pushes, begin, end);
+					});
+				}, { follow });
+				jobs.wait(separate);
+
+				for (size_t g = 0; g < count; g++)
+				{
+					if (moving[g])
+					{
+						ghosts[g]->push(pushes[g]);
+					}
+				}
+				world.motion_system.step(SIMULATION_STEP_MS);
+			}
+			double tick_time = seconds_since(start) / JOB_TICKS;
+
+			positions = get_positions(ghosts);
+			uint64_t state = hash_bytes(positions.data(), positions.size() * sizeof(vec2));
+			if (workers == 1)
+			{
+				serial = tick_time;
+				expected = state;
+			}
+			ok &= state == expected;
+			printf("%-8u %7zu %10.3f %7.2fx %016llx%s\n", workers, count, tick_time * 1000.0, serial / tick_time,
+				(unsigned long long)state, state == expected ? "" : " differs");
+		}
+
+		printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+		return ok;
+	}
+
+	// A puff of smoke as SmokeSystem kept them, one object per puff with its own fade
+	struct PooledSmoke
+	{
+		vec2 position;
+		vec2 velocity;
+		vec2 scale;
+		float radians;
+		float alpha;
+		float size_mod_count;
+		ParticleTexture texture;
+	};
+
+	ParticleSpawn random_particle(RandomStream& rng)
+	{
+		float scale = rng.uniform(1.5f, 3.f);
+		ParticleSpawn spawn;
+		spawn.position = { rng.uniform(0.f, 2000.f), rng.uniform(0.f, 1000.f) };
+		spawn.velocity = { rng.uniform(-100.f, 100.f), rng.uniform(-100.f, 100.f) };
+		spawn.scale = { scale, scale };
+		spawn.radians = rng.uniform(0.f, 6.28f);
+		spawn.alpha = 1.f;
+		spawn.life_ms = PARTICLE_LIFE_MS;
+		spawn.size_mod = 0.7f;
+		spawn.colour = { 1.f, 1.f, 1.f };
+		spawn.texture = rng.next() % 2 == 0 ? ParticleTexture::smoke_large : ParticleTexture::smoke_small;
+		return spawn;
+	}
+
+	// PARTICLE_COUNT particles of smoke living and dying, kept topped up by as many new
+	// ones a tick as fade out. The objects SmokeSystem kept in an active and an inactive
+	// list, erasing from the middle of both, with every puff drawn whether it was
+	// active or parked out of sight, against ParticleSystem's pool that swaps the dead
+	// ones out and only captures the live ones
+	bool bench_particles()
+	{
+		const size_t per_tick = (size_t)(PARTICLE_COUNT * SIMULATION_STEP_MS / PARTICLE_LIFE_MS);
+		const int warmup = (int)(PARTICLE_LIFE_MS / SIMULATION_STEP_MS) + 1;
+
+		printf("%-8s %9s %10s %10s %10s %10s\n", "pool", "particles", "update ms", "capture ms", "live", "drawn");
+
+		std::vector<ParticleInstance> instances;
+		instances.reserve(PARTICLE_COUNT);
+		size_t live[2];
+		for (int soa = 0; soa < 2; soa++)
+		{
+			RandomStream rng;
+			rng.seed(1);
+
+			ParticleSystem particles;
+			std::vector<PooledSmoke*> pool;
+			std::vector<PooledSmoke*> active;
+			std::vector<PooledSmoke*> inactive;
+			if (soa)
+			{
+				particles.reserve(PARTICLE_COUNT);
+			}
+			else
+			{
+				for (size_t i = 0; i < PARTICLE_COUNT; i++)
+				{
+					pool.push_back(new PooledSmoke());
+					pool.back()->position = { -1000.f, -1000.f };
+					inactive.push_back(pool.back());
+				}
+			}
+
+			double update_time = 0.0;
+			double capture_time = 0.0;
+			for (int t = 0; t < warmup + PARTICLE_TICKS; t++)
+			{
+				Clock::time_point start = Clock::now();
+				for (size_t i = 0; i < per_tick; i++)
+				{
+					ParticleSpawn spawn = random_particle(rng);
+					if (soa)
+					{
+						particles.emit(spawn);
+					}
+					else if (!inactive.empty())
+					{
+						PooledSmoke* smoke = inactive.front();
+						smoke->position = spawn.position;
+						smoke->velocity = spawn.velocity;
+						smoke->scale = spawn.scale;
+						smoke->radians = spawn.radians;
+						smoke->alpha = 1.f;
+						smoke->size_mod_count = 0.f;
+						smoke->texture = spawn.texture;
+						active.push_back(smoke);
+						inactive.erase(inactive.begin());
+					}
+				}
+
+				if (soa)
+				{
+					particles.update(SIMULATION_STEP_MS);
+				}
+				else
+				{
+					for (int i = (int)active.size() - 1; i >= 0; i--)
+					{
+						PooledSmoke* smoke = active[i];
+						smoke->alpha -= SIMULATION_STEP_MS / PARTICLE_LIFE_MS;
+						if (smoke->alpha <= 0.f)
+						{
+							smoke->position = { -1000.f, -1000.f };
+							inactive.push_back(smoke);
+							active.erase(active.begin() + i);
+							continue;
+						}
+						smoke->position = add(smoke->position, mul(smoke->velocity, SIMULATION_STEP_MS / 1000.f));
+						smoke->size_mod_count = std::fmod(smoke->size_mod_count + SIMULATION_STEP_MS, 200.f);
+					}
+				}
+				double updated = seconds_since(start);
+
+				start = Clock::now();
+				if (soa)
+				{
+					particles.capture(instances);
+				}
+				else
+				{
+					instances.resize(pool.size());
+					for (size_t i = 0; i < pool.size(); i++)
+					{
+						const PooledSmoke* smoke = pool[i];
+						float pulse = std::sin(smoke->size_mod_count / 200.f * 3.14159265f) * 0.7f;
+						instances[i].position = smoke->position;
+						instances[i].scale = { smoke->scale.x + pulse, smoke->scale.y + pulse };
+						instances[i].radians = smoke->radians;
+						instances[i].alpha = std::max(smoke->alpha, 0.f);
+						instances[i].texture = (float)smoke->texture;
+						instances[i].colour = { 1.f, 1.f, 1.f };
+					}
+				}
+				double captured = seconds_since(start);
+
+				if (t >= warmup)
+				{
+					update_time += updated;
+					capture_time += captured;
+				}
+			}
+
+			live[soa] = soa ? particles.size() : active.size();
+			printf("%-8s %9zu %10.3f %10.3f %10zu %10zu\n", soa ? "soa" : "objects", PARTICLE_COUNT,
+				update_time * 1000.0 / PARTICLE_TICKS, capture_time * 1000.0 / PARTICLE_TICKS, live[soa],
+				instances.size());
+
+			for (PooledSmoke* smoke : pool)
+			{
+				delete smoke;
+			}
+		}
+
+		return live[0] == live[1];
+	}
+
+	// Time to generate the graph of every shipped level with 1 to 8 threads
+	bool bench_graph()
+	{
+		printf("%-14s", "level");
+		for (unsigned threads : GRAPH_THREAD_COUNTS)
+		{
+			printf(" %8u thr %7s", threads, "speedup");
+		}
+		printf("\n");
+
+		std::vector<JobSystem*> systems;
+		for (unsigned threads : GRAPH_THREAD_COUNTS)
+		{
+			systems.push_back(new JobSystem(threads));
+		}
+
+		bool ok = true;
+		for (const char* level : SHIPPED_LEVELS)
+		{
+			NavLayout layout;
+			if (!load_layout(level, layout))
+			{
+				ok = false;
+				break;
+			}
+
+			LevelGraph graph;
+
+			printf("%-14s", level);
+			double serial = 0.0;
+			for (JobSystem* jobs : systems)
+			{
+				double best = 1e9;
+				for (int r = 0; r < GRAPH_REPEATS; r++)
+				{
+					Clock::time_point start = Clock::now();
+					graph.generate(layout, *jobs);
+					best = std::min(best, seconds_since(start));
+				}
+				if (jobs->size() == 1)
+				{
+					serial = best;
+				}
+				printf(" %9.2f ms %6.2fx", best * 1000.0, serial / best);
+			}
+			printf("\n");
+		}
+
+		for (JobSystem* jobs : systems)
+		{
+			delete jobs;
+		}
+
+		printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+		return ok;
+	}
+}
+
+bool run_benchmark(const std::string& name)
+{
+	if (name == "paths")
+	{
+		return bench_paths();
+	}
+	if (name == "graph")
+	{
+		return bench_graph();
+	}
+	if (name == "raycast")
+	{
+		return bench_raycast();
+	}
+	if (name == "flow")
+	{
+		return bench_flow();
+	}
+	if (name == "switch")
+	{
+		return bench_switch();
+	}
+	if (name == "hpa")
+	{
+		return bench_hpa();
+	}
+	if (name == "edit")
+	{
+		return bench_edit();
+	}
+	if (name == "crowd")
+	{
+		return bench_crowd();
+	}
+	if (name == "lod")
+	{
+		return bench_lod();
+	}
+	if (name == "jobs")
+	{
+		return bench_jobs();
+	}
+	if (name == "particles")
+	{
+		return bench_particles();
+	}
+
+	fprintf(stderr, "Unknown benchmark %s, available: paths, graph, raycast, flow, switch, hpa, edit, crowd, lod, jobs, particles\n", name.c_str());
+	return false;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <string>
+
+// Offline measurements that run on the core without opening a window, picked on
+// the command line with eitd_bench <name>. Prints the results to stdout, returns
+// false if there is no benchmark called name or it found something wrong.
+bool run_benchmark(const std::string& name);
@@ -1,5 +1,6 @@
 // Header
 #include "brick.hpp"
+#include "world_context.hpp"
 
 #include <cmath>
 
@@ -9,40 +10,15 @@ RenderComponent Brick::rrc;
 RenderComponent Brick::grc;
 RenderComponent Brick::brc;
 RenderComponent Brick::irc;
+SharedInit Brick::shared_init;
 
 bool Brick::init(int id, vec3 colour)
 {
+	WorldContext& world = get_world_context();
 	m_id = id;
 
-	if (!brick_texture.is_valid())
-	{
-		if (!brick_texture.load_from_file(textures_path("tile_brick.png")))
-		{
-			fprintf(stderr, "Failed to load brick texture!");
-			return false;
-		}
-
-		rc.texture = &brick_texture;
-        rrc.texture = &brick_texture;
-        grc.texture = &brick_texture;
-        brc.texture = &brick_texture;
-        irc.texture = &brick_texture;
-
-		if (!rc.init_sprite())
-			return false;
-
-        if (!rrc.init_sprite())
-            return false;
-
-        if (!grc.init_sprite())
-            return false;
-
-        if (!brc.init_sprite())
-            return false;
-
-        if (!irc.init_sprite())
-            return false;
-	}
+	if (!shared_init.run(init_sprites))
+		return false;
 
 	mc.position = { 0.f, 0.f };
 	mc.velocity = { 0.f, 0.f };
@@ -52,42 +28,48 @@ bool Brick::init(int id, vec3 colour)
 	mc.physics.scale = { brick_size / rc.texture->width, brick_size / rc.texture->height };
 
     m_colour = colour;
-    m_is_collidable = (m_colour.x == 1.f && m_colour.y == 1.f && m_colour.z == 1.f)
-            || (m_colour.x == 0.f && m_colour.y == 0.f && m_colour.z == 0.f);
 
     if (colour.x == 1.f && colour.y == 0.f && colour.z == 0.f) {
-        rrc.can_be_hidden = 1;
-        rrc.colour = m_colour;
-        s_render_components[id] = &rrc;
+        world.render_components.insert(id, &rrc);
     } else if (colour.x == 0.f && colour.y == 1.f && colour.z == 0.f) {
-        grc.can_be_hidden = 1;
-        grc.colour = m_colour;
-        s_render_components[id] = &grc;
+        world.render_components.insert(id, &grc);
     } else if (colour.x == 0.f && colour.y == 0.f && colour.z == 1.f) {
-        brc.can_be_hidden = 1;
-        brc.colour = m_colour;
-        s_render_components[id] = &brc;
+        world.render_components.insert(id, &brc);
     } else if (colour.x == 0.f && colour.y == 0.f && colour.z == 0.f) {
-        irc.is_invisible = 1;
-        irc.colour = m_colour;
-        s_render_components[id] = &irc;
+        world.render_components.insert(id, &irc);
     } else {
-        s_render_components[id] = &rc;
+        world.render_components.insert(id, &rc);
     }
-	s_motion_components[id] = &mc;
+	world.motion_components.insert(id, &mc);
 
 	return true;
 }
 
-void Brick::update(vec3 hl_colour)
+bool Brick::init_sprites()
 {
-    if ((m_colour.x == 1.f && m_colour.y == 1.f && m_colour.z == 1.f)
-    || (m_colour.x == 0.f && m_colour.y == 0.f && m_colour.z == 0.f)) {
-        m_is_collidable = true;
-        return;
-    }
+	if (!brick_texture.load_from_file(textures_path("tile_brick.png")))
+	{
+		fprintf(stderr, "Failed to load brick texture!");
+		return false;
+	}
 
-    m_is_collidable = m_colour.x == hl_colour.x && m_colour.y == hl_colour.y && m_colour.z == hl_colour.z;
+	rc.texture = &brick_texture;
+    rrc.texture = &brick_texture;
+    grc.texture = &brick_texture;
+    brc.texture = &brick_texture;
+    irc.texture = &brick_texture;
+
+    // The sprites are shared, so the colour of the bricks that use them is set here once
+    rrc.can_be_hidden = 1;
+    rrc.colour = { 1.f, 0.f, 0.f };
+    grc.can_be_hidden = 1;
+    grc.colour = { 0.f, 1.f, 0.f };
+    brc.can_be_hidden = 1;
+    brc.colour = { 0.f, 0.f, 1.f };
+    irc.is_invisible = 1;
+    irc.colour = { 0.f, 0.f, 0.f };
+
+	return rc.init_sprite() && rrc.init_sprite() && grc.init_sprite() && brc.init_sprite() && irc.init_sprite();
 }
 
 vec2 Brick::get_position()const
@@ -119,8 +101,14 @@ Hitbox Brick::get_hitbox() const
     return m_hitbox;
 }
 
-bool Brick::get_is_collidable() {
-    return m_is_collidable;
+bool Brick::get_is_collidable(vec3 hl_colour) const {
+    // read when the robot touches the brick, so a colour change doesn't visit every brick
+    if ((m_colour.x == 1.f && m_colour.y == 1.f && m_colour.z == 1.f)
+    || (m_colour.x == 0.f && m_colour.y == 0.f && m_colour.z == 0.f)) {
+        return true;
+    }
+
+    return m_colour.x == hl_colour.x && m_colour.y == hl_colour.y && m_colour.z == hl_colour.z;
 }
 
 vec3 Brick::get_colour() {
@@ -6,12 +6,14 @@
 
 class Brick : public Entity
 {
+	// Every brick of a colour draws with the same sprite, set up by the first brick
 	static Texture brick_texture;
 	static RenderComponent rc;
     static RenderComponent rrc;
     static RenderComponent grc;
     static RenderComponent brc;
     static RenderComponent irc;
+    static SharedInit shared_init;
 
 	MotionComponent mc;
 
@@ -19,10 +21,6 @@ public:
 	// Creates all the associated render resources and default transform
 	bool init(int id, vec3 colour);
 
-	// Update brick
-	// ms represents the number of milliseconds elapsed from the previous update() call
-	void update(vec3 hl_colour);
-
 	// Returns the current brick position
 	vec2 get_position()const;
 
@@ -32,14 +30,17 @@ public:
 	// Returns the bricks hitbox for collision detection
 	Hitbox get_hitbox() const;
 
-    bool get_is_collidable();
+    // Whether the robot collides with the brick under a headlight of hl_colour
+    bool get_is_collidable(vec3 hl_colour) const;
 
     vec3 get_colour();
 
 private:
     Hitbox m_hitbox;
     vec3 m_colour;
-    bool m_is_collidable;
 
     void calculate_hitbox();
+
+    // Loads the texture and sets up the sprite of each colour
+    static bool init_sprites();
 };
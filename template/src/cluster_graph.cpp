@@ -0,0 +1,331 @@
+#include "cluster_graph.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <math.h>
+
+namespace
+{
+	const int C = ClusterGraph::CLUSTER_SIZE;
+	const int CHANNEL_COUNT = 4;
+
+	// Open runs along a border at least this long get an entrance at each end
+	// rather than one in the middle
+	const int ENTRANCE_SPLIT = 6;
+
+	const float DIAGONAL_COST = 1.41421356f;
+
+	const std::greater<std::pair<float, int>> HEAP_ORDER;
+
+	bool links_in_order(const ClusterGraph::Link& a, const ClusterGraph::Link& b)
+	{
+		return a.first < b.first || (a.first == b.first && a.second < b.second);
+	}
+}
+
+const int ClusterGraph::CLUSTER_SIZE;
+
+void ClusterGraph::build(const OccupancyGrid& grid, JobSystem& jobs)
+{
+	m_width = grid.get_width();
+	m_height = grid.get_height();
+	m_cell_channels.assign(m_width * m_height, 0);
+	m_cell_links.clear();
+
+	find_entrances(grid);
+
+	// Clusters only read the entrances, so they can be joined in any order
+	const int columns = (m_width + C - 1) / C;
+	const int cluster_count = columns * ((m_height + C - 1) / C);
+	std::vector<std::vector<Polyline>> found(jobs.size());
+	std::atomic<int> next_cluster(0);
+
+	// One task per worker taking clusters in turn, found[t] holds what task t joined
+	std::vector<JobSystem::Handle> tasks;
+	for (size_t task = 0; task < found.size(); task++)
+	{
+		tasks.push_back(jobs.submit([&, task]() {
+			for (int c = next_cluster++; c < cluster_count; c = next_cluster++)
+			{
+				connect_cluster(grid, c % columns, c / columns, found[task]);
+			}
+		}));
+	}
+	for (const JobSystem::Handle& task : tasks)
+	{
+		jobs.wait(task);
+	}
+
+	// The corners left on the paths become nodes too
+	for (auto& polylines : found)
+	{
+		for (const Polyline& polyline : polylines)
+		{
+			for (size_t i = 0; i < polyline.cells.size(); i++)
+			{
+				m_cell_channels[polyline.cells[i]] |= polyline.channels;
+				if (i > 0)
+				{
+					m_cell_links.push_back({ polyline.cells[i - 1], polyline.cells[i], polyline.channels });
+				}
+			}
+		}
+	}
+
+	// Nodes are numbered in cell order, so the graph doesn't depend on the thread count
+	std::vector<int> node_of(m_cell_channels.size(), -1);
+	m_nodes.clear();
+	m_node_channels.clear();
+	for (int cell = 0; cell < (int)m_cell_channels.size(); cell++)
+	{
+		if (m_cell_channels[cell])
+		{
+			node_of[cell] = (int)m_nodes.size();
+			m_nodes.push_back({ (float)(cell % m_width), (float)(cell / m_width) });
+			m_node_channels.push_back(m_cell_channels[cell]);
+		}
+	}
+
+	// Paths of different channels share links, those are merged
+	m_links.clear();
+	for (const Link& link : m_cell_links)
+	{
+		int a = node_of[link.first];
+		int b = node_of[link.second];
+		if (a != b)
+		{
+			m_links.push_back({ std::min(a, b), std::max(a, b), link.channels });
+		}
+	}
+	std::sort(m_links.begin(), m_links.end(), links_in_order);
+
+	size_t kept = 0;
+	for (size_t i = 0; i < m_links.size(); i++)
+	{
+		if (kept > 0 && m_links[kept - 1].first == m_links[i].first && m_links[kept - 1].second == m_links[i].second)
+		{
+			m_links[kept - 1].channels |= m_links[i].channels;
+		}
+		else
+		{
+			m_links[kept++] = m_links[i];
+		}
+	}
+	m_links.resize(kept);
+
+	m_cell_channels.clear();
+	m_cell_links.clear();
+}
+
+const std::vector<vec2>& ClusterGraph::get_nodes() const
+{
+	return m_nodes;
+}
+
+const std::vector<uint8_t>& ClusterGraph::get_node_channels() const
+{
+	return m_node_channels;
+}
+
+const std::vector<ClusterGraph::Link>& ClusterGraph::get_links() const
+{
+	return m_links;
+}
+
+void ClusterGraph::find_entrances(const OccupancyGrid& grid)
+{
+	for (int channel = 0; channel < CHANNEL_COUNT; channel++)
+	{
+		const uint8_t bit = 1 << channel;
+
+		// Cells a and b face each other across a border, step moves along it
+		auto scan_border = [&](int ax, int ay, int bx, int by, int step_x, int step_y, int length) {
+			int run_start = -1;
+			for (int i = 0; i <= length; i++)
+			{
+				bool open = i < length &&
+					!(grid.blocked(ax + i * step_x, ay + i * step_y) & bit) &&
+					!(grid.blocked(bx + i * step_x, by + i * step_y) & bit);
+
+				if (open && run_start < 0)
+				{
+					run_start = i;
+				}
+				else if (!open && run_start >= 0)
+				{
+					int run_end = i - 1;
+					int ends[2] = { run_start, run_end };
+					int count = 2;
+					if (run_end - run_start + 1 < ENTRANCE_SPLIT)
+					{
+						ends[0] = (run_start + run_end) / 2;
+						count = 1;
+					}
+
+					for (int e = 0; e < count; e++)
+					{
+						int a = (ay + ends[e] * step_y) * m_width + ax + ends[e] * step_x;
+						int b = (by + ends[e] * step_y) * m_width + bx + ends[e] * step_x;
+						m_cell_channels[a] |= bit;
+						m_cell_channels[b] |= bit;
+						m_cell_links.push_back({ a, b, bit });
+					}
+					run_start = -1;
+				}
+			}
+		};
+
+		for (int x = C; x < m_width; x += C)
+		{
+			for (int y = 0; y < m_height; y += C)
+			{
+				scan_border(x - 1, y, x, y, 0, 1, std::min(C, m_height - y));
+			}
+		}
+		for (int y = C; y < m_height; y += C)
+		{
+			for (int x = 0; x < m_width; x += C)
+			{
+				scan_border(x, y - 1, x, y, 1, 0, std::min(C, m_width - x));
+			}
+		}
+	}
+}
+
+void ClusterGraph::connect_cluster(const OccupancyGrid& grid, int cx, int cy, std::vector<Polyline>& out) const
+{
+	const int x0 = cx * C;
+	const int y0 = cy * C;
+	const int w = std::min(C, m_width - x0);
+	const int h = std::min(C, m_height - y0);
+
+	auto global = [&](int local) { return (y0 + local / w) * m_width + x0 + local % w; };
+	auto pixel = [&](int local) { return to_pixel_position({ (float)(x0 + local % w), (float)(y0 + local / w) }); };
+
+	std::vector<float> distance(w * h);
+	std::vector<int> parent(w * h);
+	std::vector<std::pair<float, int>> heap;
+	std::vector<int> sources;
+	std::vector<int> path;
+
+	// Channels whose bricks are the same all over the cluster share their paths
+	uint8_t done = 0;
+	for (int channel = 0; channel < CHANNEL_COUNT; channel++)
+	{
+		const uint8_t bit = 1 << channel;
+		if (done & bit)
+			continue;
+
+		uint8_t group = bit;
+		for (int other = channel + 1; other < CHANNEL_COUNT; other++)
+		{
+			const uint8_t other_bit = 1 << other;
+			bool same = true;
+			for (int local = 0; local < w * h && same; local++)
+			{
+				uint8_t cell = grid.blocked(x0 + local % w, y0 + local / w);
+				same = !(cell & bit) == !(cell & other_bit);
+			}
+			if (same)
+				group |= other_bit;
+		}
+		done |= group;
+
+		auto open = [&](int x, int y) {
+			return x >= 0 && x < w && y >= 0 && y < h && !(grid.blocked(x0 + x, y0 + y) & bit);
+		};
+
+		sources.clear();
+		for (int local = 0; local < w * h; local++)
+		{
+			if (m_cell_channels[global(local)] & group)
+				sources.push_back(local);
+		}
+
+		for (size_t s = 0; s + 1 < sources.size(); s++)
+		{
+			// Dijkstra over the open cells of the cluster, 8 way without cutting corners
+			std::fill(distance.begin(), distance.end(), INFINITY);
+			distance[sources[s]] = 0.f;
+			parent[sources[s]] = -1;
+			heap.assign(1, std::make_pair(0.f, sources[s]));
+
+			while (!heap.empty())
+			{
+				std::pop_heap(heap.begin(), heap.end(), HEAP_ORDER);
+				float d = heap.back().first;
+				int local = heap.back().second;
+				heap.pop_back();
+				if (d > distance[local])
+					continue;
+
+				int x = local % w;
+				int y = local / w;
+				for (int dy = -1; dy <= 1; dy++)
+				{
+					for (int dx = -1; dx <= 1; dx++)
+					{
+						if ((dx == 0 && dy == 0) || !open(x + dx, y + dy))
+							continue;
+						if (dx != 0 && dy != 0 && (!open(x + dx, y) || !open(x, y + dy)))
+							continue;
+
+						int to = (y + dy) * w + x + dx;
+						float cost = d + (dx != 0 && dy != 0 ? DIAGONAL_COST : 1.f);
+						if (cost < distance[to])
+						{
+							distance[to] = cost;
+							parent[to] = local;
+							heap.push_back(std::make_pair(cost, to));
+							std::push_heap(heap.begin(), heap.end(), HEAP_ORDER);
+						}
+					}
+				}
+			}
+
+			for (size_t t = s + 1; t < sources.size(); t++)
+			{
+				if (distance[sources[t]] == INFINITY)
+					continue;
+
+				// Keep only the cells where the path turns, straight runs between them
+				// are already clear
+				path.clear();
+				for (int local = sources[t]; local != -1; local = parent[local])
+				{
+					if (path.size() >= 2)
+					{
+						int a = path[path.size() - 2];
+						int b = path.back();
+						if (a % w - b % w == b % w - local % w && a / w - b / w == b / w - local / w)
+						{
+							path.back() = local;
+							continue;
+						}
+					}
+					path.push_back(local);
+				}
+
+				// Then pull the string: skip corners the slide can cut straight across
+				Polyline polyline;
+				polyline.channels = group;
+				polyline.cells.push_back(global(path[0]));
+				size_t anchor = 0;
+				for (size_t k = 2; k < path.size(); k++)
+				{
+					if (!grid.clear_channels(pixel(path[anchor]), pixel(path[k]), bit))
+					{
+						polyline.cells.push_back(global(path[k - 1]));
+						anchor = k - 1;
+					}
+				}
+				if (path.size() > 1)
+				{
+					polyline.cells.push_back(global(path.back()));
+				}
+				out.push_back(polyline);
+			}
+		}
+	}
+}
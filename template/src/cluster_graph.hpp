@@ -0,0 +1,64 @@
+#pragma once
+
+#include "common.hpp"
+#include "occupancy_grid.hpp"
+#include "job_system.hpp"
+#include <vector>
+
+// Hierarchical navigation graph for large levels, in the manner of HPA*. The grid
+// is cut into CLUSTER_SIZE x CLUSTER_SIZE clusters. Every run of open cells along
+// a cluster border gets one or two entrances, a pair of nodes facing each other
+// across the border. Inside each cluster the entrances are joined by their
+// shortest cell paths, which are pulled straight and kept as links between the
+// corners that remain, so every link is a straight slide and the result can be
+// searched like the critical point graph of a small level.
+//
+// Building only ever searches inside one cluster at a time, so it grows with the
+// area of the level instead of with the square of the number of bricks.
+class ClusterGraph
+{
+public:
+	static const int CLUSTER_SIZE = 16;
+
+	struct Link
+	{
+		int first;
+		int second;
+		uint8_t channels;
+	};
+
+	// Builds the graph of grid, clusters are shared out between the workers of jobs
+	void build(const OccupancyGrid& grid, JobSystem& jobs);
+
+	// Grid positions of the nodes and the channels each can be used in
+	const std::vector<vec2>& get_nodes() const;
+	const std::vector<uint8_t>& get_node_channels() const;
+
+	// Straight links between nodes, first < second, each pair appears once
+	const std::vector<Link>& get_links() const;
+
+private:
+	// A path through a cluster, pulled straight, as cell indices
+	struct Polyline
+	{
+		std::vector<int> cells;
+		uint8_t channels;
+	};
+
+	// Adds entrances along every border between clusters
+	void find_entrances(const OccupancyGrid& grid);
+
+	// Joins the entrances of cluster cx, cy in every channel
+	void connect_cluster(const OccupancyGrid& grid, int cx, int cy, std::vector<Polyline>& out) const;
+
+	int m_width = 0;
+	int m_height = 0;
+
+	// Channels each cell is a node in, and links by cell index while building
+	std::vector<uint8_t> m_cell_channels;
+	std::vector<Link> m_cell_links;
+
+	std::vector<vec2> m_nodes;
+	std::vector<uint8_t> m_node_channels;
+	std::vector<Link> m_links;
+};
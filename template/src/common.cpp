@@ -1,14 +1,46 @@
 #include "common.hpp"
 
+// The GL entry points live with the rest of the core so programs that never open a
+// window still link, they're only looked up by gl3w_init()
+#define GL3W_IMPLEMENTATION
+#include <gl3w.h>
+
 #define STB_IMAGE_IMPLEMENTATION
 #include "../ext/stb_image/stb_image.h"
 
 // stlib
 #include <vector>
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <cmath>
 
+namespace
+{
+	bool s_has_renderer = true;
+	bool s_gpu_particles = false;
+}
+
+void use_null_renderer()
+{
+	s_has_renderer = false;
+}
+
+bool has_renderer()
+{
+	return s_has_renderer;
+}
+
+void use_gpu_particles()
+{
+	s_gpu_particles = true;
+}
+
+bool has_gpu_particles()
+{
+	return s_gpu_particles && s_has_renderer;
+}
+
 void gl_flush_errors()
 {
 	while (glGetError() != GL_NO_ERROR);
@@ -109,6 +141,17 @@ vec2 normalize(vec2 v)
 	return { v.x / m, v.y / m };
 }
 
+uint64_t hash_bytes(const void* data, size_t size, uint64_t hash)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001B3ull;
+	}
+	return hash;
+}
+
 float get_closest_point(float last_pos, float tile_pos, float circle_width, float tile_width)
 {
 	float side = 1.f;
@@ -128,7 +171,7 @@ bool within_range(float val, float low, float high)
 	return (val - high)*(val - low) <= 0;
 }
 
-Texture::Texture() 
+Texture::Texture() : id(0), depth_render_buffer_id(0), width(0), height(0)
 {
 
 }
@@ -143,6 +186,10 @@ bool Texture::load_from_file(const char* path)
 {
 	if (path == nullptr) 
 		return false;
+
+	// The simulation still scales sprites by the size of their texture
+	if (!has_renderer())
+		return stbi_info(path, &width, &height, NULL) == 1;
 	
 	stbi_uc* data = stbi_load(path, &width, &height, NULL, 4);
 	depth_render_buffer_id = 0;
@@ -161,13 +208,76 @@ bool Texture::load_from_file(const char* path)
 	return valid;
 }
 
+namespace
+{
+	const int TEXTURE_LOAD_ROWS = 256; // rows uploaded per step, 4 MB of a 4096 px wide texture
+}
+
+TextureLoad::TextureLoad(Texture* texture, const std::string& path) : texture(texture), path(path)
+{
+}
+
+TextureLoad::~TextureLoad()
+{
+	if (pixels != nullptr)
+		stbi_image_free(pixels);
+}
+
+bool TextureLoad::step()
+{
+	if (pixels == nullptr)
+	{
+		pixels = stbi_load(path.c_str(), &texture->width, &texture->height, NULL, 4);
+		texture->id = 0;
+		texture->depth_render_buffer_id = 0;
+		if (pixels == nullptr)
+		{
+			fprintf(stderr, "Failed to load texture %s\n", path.c_str());
+			return true;
+		}
+
+		// Storage for the whole texture now, the rows follow
+		gl_flush_errors();
+		glGenTextures(1, &texture->id);
+		glBindTexture(GL_TEXTURE_2D, texture->id);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texture->width, texture->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		return false;
+	}
+
+	int rows = std::min(TEXTURE_LOAD_ROWS, texture->height - rows_uploaded);
+	glBindTexture(GL_TEXTURE_2D, texture->id);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, rows_uploaded, texture->width, rows, GL_RGBA, GL_UNSIGNED_BYTE,
+		pixels + (size_t)rows_uploaded * texture->width * 4);
+	rows_uploaded += rows;
+	if (rows_uploaded < texture->height)
+		return false;
+
+	stbi_image_free(pixels);
+	pixels = nullptr;
+	if (gl_has_errors())
+	{
+		glDeleteTextures(1, &texture->id);
+		texture->id = 0;
+	}
+	return true;
+}
+
+bool SharedInit::run(const std::function<bool()>& init)
+{
+	std::call_once(m_once, [this, &init]() { m_ok = init(); });
+	return m_ok;
+}
+
 // http://www.opengl-tutorial.org/intermediate-tutorials/tutorial-14-render-to-texture/
-bool Texture::create_from_screen(GLFWwindow const * const window) {
+bool Texture::create_from_screen(int width, int height) {
 	gl_flush_errors();
 	glGenTextures(1, &id);
 	glBindTexture(GL_TEXTURE_2D, id);
 
-	glfwGetFramebufferSize(const_cast<GLFWwindow *>(window), &width, &height);
+	this->width = width;
+	this->height = height;
 
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -194,7 +304,8 @@ bool Texture::create_from_screen(GLFWwindow const * const window) {
 
 bool Texture::is_valid()const
 {
-	return id != 0;
+	// Without a renderer the size is all there is to load
+	return id != 0 || (!has_renderer() && width > 0);
 }
 
 namespace
@@ -222,6 +333,14 @@ namespace
 
 bool Effect::load_from_file(const char* vs_path, const char* fs_path) 
 {
+	return load_from_file(vs_path, fs_path, {});
+}
+
+bool Effect::load_from_file(const char* vs_path, const char* fs_path, const std::vector<const char*>& varyings)
+{
+	if (!has_renderer())
+		return true;
+
 	gl_flush_errors();
 
 	// Opening files
@@ -265,6 +384,8 @@ bool Effect::load_from_file(const char* vs_path, const char* fs_path)
 	program = glCreateProgram();
 	glAttachShader(program, vertex);
 	glAttachShader(program, fragment);
+	if (!varyings.empty())
+		glTransformFeedbackVaryings(program, (GLsizei)varyings.size(), varyings.data(), GL_INTERLEAVED_ATTRIBS);
 	glLinkProgram(program);
 	{
 		GLint is_linked = 0;
@@ -294,6 +415,9 @@ bool Effect::load_from_file(const char* vs_path, const char* fs_path)
 
 void Effect::release()
 {
+	if (!has_renderer())
+		return;
+
 	glDeleteProgram(program);
 	glDeleteShader(vertex);
 	glDeleteShader(fragment);
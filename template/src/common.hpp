@@ -2,8 +2,13 @@
 
 // stlib
 #include <fstream> // stdout, stderr..
+#include <functional>
 #include <map>
+#include <mutex>
+#include <string>
 #include <utility>
+#include <vector>
+#include <stdint.h>
 
 // glfw
 #define NOMINMAX
@@ -65,8 +70,27 @@ vec2 to_pixel_position(vec2 pos);
 static const float brick_size = 64.f;
 static const float TOLERANCE = 0.005f;
 
+// Every update advances the simulation by exactly this much
+static const float SIMULATION_STEP_MS = 17.f;
+
+// Ghosts only chase a robot this close
+static const float GHOST_CHASE_RANGE = 800.f;
+
+// Pixels a ghost moves in a second
+static const float GHOST_SPEED = 100.f;
+
+// Ghosts this close to the robot are tested against it, robot body and ghost box
+// with room for a step
+static const float GHOST_REACH = 2.f * brick_size;
+
+// Ghosts per job, fewer aren't worth handing to another thread
+static const size_t GHOST_UPDATE_GRAIN = 64;
+
 extern double scroll_sensitivity;
 
+// 64 bit FNV-1a hash of size bytes, pass the previous result as hash to continue it
+uint64_t hash_bytes(const void* data, size_t size, uint64_t hash = 0xCBF29CE484222325ull);
+
 float get_closest_point(float last_pos, float tile_pos, float circle_width, float tile_width);
 bool within_range(float val, float low, float high);
 
@@ -75,6 +99,19 @@ bool within_range(float val, float low, float high);
 void gl_flush_errors();
 bool gl_has_errors();
 
+// Turns GL off for programs that simulate without a window, like the headless driver.
+// Call it before loading anything: textures then only read the size of their image,
+// and sprites, shaders and lights don't make GL objects
+void use_null_renderer();
+// False once use_null_renderer() has been called
+bool has_renderer();
+
+// Has particles simulated on the GPU with transform feedback instead of on the CPU,
+// call it before a level is loaded
+void use_gpu_particles();
+// True once use_gpu_particles() has been called and there is a renderer to do it
+bool has_gpu_particles();
+
 // Single Vertex Buffer element for non-textured meshes (coloured.vs.glsl & salmon.vs.glsl)
 struct Vertex
 {
@@ -103,7 +140,39 @@ struct Texture
 	// Loads texture from file specified by path
 	bool load_from_file(const char* path);
 	bool is_valid()const; // True if texture is valid
-	bool create_from_screen(GLFWwindow const * const window); // Screen texture
+	bool create_from_screen(int width, int height); // Screen texture, the size of the framebuffer
+};
+
+// Loads a texture from file over several calls, so a large one can be spread over
+// frames. The first call decodes the file, each one after uploads a strip of rows
+struct TextureLoad
+{
+	TextureLoad(Texture* texture, const std::string& path);
+	~TextureLoad();
+
+	// Does the next part of the load, returns true once there is nothing left. The
+	// texture is only complete then, and invalid if the file couldn't be read
+	bool step();
+
+	Texture* texture;
+	std::string path;
+	unsigned char* pixels = nullptr;
+	int rows_uploaded = 0;
+};
+
+// One time setup of what every instance of an entity shares in every world, such as
+// its texture. Levels can load on several threads at once, the first to get here
+// runs it and the others wait for it to finish
+class SharedInit
+{
+public:
+	// Runs init unless it has run already, returns whether it succeeded. A failed
+	// init is not run again
+	bool run(const std::function<bool()>& init);
+
+private:
+	std::once_flag m_once;
+	bool m_ok = false;
 };
 
 // A Mesh is a collection of a VertexBuffer and an IndexBuffer. A VAO
@@ -123,6 +192,9 @@ struct Effect {
 	GLuint program;
 
 	bool load_from_file(const char* vs_path, const char* fs_path); // load shaders from files and link into program
+	// Same, with the vertex shader outputs named in varyings captured by transform feedback,
+	// interleaved into one buffer in the order given
+	bool load_from_file(const char* vs_path, const char* fs_path, const std::vector<const char*>& varyings);
 	void release(); // release shaders and program
 };
 
@@ -1,14 +1,85 @@
 #include "components.hpp"
+#include "world_context.hpp"
 
-int next_id = 0;
+int EntityPool::create()
+{
+	int id;
+	if (!m_free.empty())
+	{
+		id = m_free.back();
+		m_free.pop_back();
+	}
+	else
+	{
+		id = (int)m_generations.size();
+		m_generations.push_back(0);
+		m_alive.push_back(0);
+	}
+
+	m_alive[id] = 1;
+	m_live_count++;
+
+	if (m_batching)
+	{
+		m_batch.push_back(id);
+	}
+
+	return id;
+}
+
+void EntityPool::release(int id)
+{
+	if (!is_alive(id))
+	{
+		return;
+	}
+
+	m_alive[id] = 0;
+	m_generations[id]++;
+	m_live_count--;
+	m_free.push_back(id);
+}
+
+bool EntityPool::is_alive(int id) const
+{
+	return id >= 0 && id < (int)m_alive.size() && m_alive[id];
+}
+
+bool EntityPool::is_alive(EntityHandle handle) const
+{
+	return is_alive(handle.id) && m_generations[handle.id] == handle.generation;
+}
+
+EntityHandle EntityPool::get_handle(int id) const
+{
+	return { id, m_generations[id] };
+}
+
+size_t EntityPool::live_count() const
+{
+	return m_live_count;
+}
 
-std::map<int, MotionComponent*> s_motion_components;
-std::map<int, MotionComponent*> s_ui_motion_components;
-std::map<int, RenderComponent*> s_render_components;
-std::map<int, RenderComponent*> s_ui_render_components;
+void EntityPool::begin_batch()
+{
+	m_batch.clear();
+	m_batching = true;
+}
+
+std::vector<int> EntityPool::end_batch()
+{
+	m_batching = false;
+	std::vector<int> batch;
+	batch.swap(m_batch);
+	return batch;
+}
 
 bool RenderComponent::init_sprite()
 {
+	alpha = 1.f;
+	if (!has_renderer())
+		return true;
+
 	// The position corresponds to the center of the texture.
 	float wr = texture->width * 0.5f;
 	float hr = texture->height * 0.5f;
@@ -48,8 +119,6 @@ bool RenderComponent::init_sprite()
 	if (!effect.load_from_file(shader_path("textured.vs.glsl"), shader_path("textured.fs.glsl")))
 		return false;
 
-	alpha = 1.f;
-
 	return true;
 }
 
@@ -165,14 +234,46 @@ void RenderComponent::draw_sprite_alpha(const mat3& projection, float alpha, vec
     }
 }
 
+void release_entity(int id)
+{
+	WorldContext& world = get_world_context();
+	world.motion_system.remove(id);
+	world.motion_components.remove(id);
+	world.render_components.remove(id);
+	world.entities.release(id);
+}
+
+void release_ui_entity(int id)
+{
+	WorldContext& world = get_world_context();
+	world.ui_motion_components.remove(id);
+	world.ui_render_components.remove(id);
+	world.entities.release(id);
+}
+
 void clear_level_components()
 {
-	s_motion_components.clear();
-	s_render_components.clear();
+	WorldContext& world = get_world_context();
+
+	// every level entity owns a motion or render component, so this finds all of them
+	for (int id : world.motion_components.ids())
+		world.entities.release(id);
+	for (int id : world.render_components.ids())
+		world.entities.release(id);
+
+	world.motion_system.clear();
+	world.motion_components.clear();
+	world.render_components.clear();
 }
 
 void clear_ui_components()
 {
-	s_ui_motion_components.clear();
-	s_ui_render_components.clear();
+	WorldContext& world = get_world_context();
+	for (int id : world.ui_motion_components.ids())
+		world.entities.release(id);
+	for (int id : world.ui_render_components.ids())
+		world.entities.release(id);
+
+	world.ui_motion_components.clear();
+	world.ui_render_components.clear();
 }
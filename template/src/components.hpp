@@ -2,9 +2,126 @@
 
 #include "common.hpp"
 #include <vector>
-#include <map>
+#include <stdint.h>
 
-extern int next_id;	
+// Reference to an entity that can tell when the entity is gone. Ids are recycled,
+// so an old id may end up naming a different entity, the generation catches that.
+struct EntityHandle
+{
+	int id;
+	uint32_t generation;
+};
+
+// Hands out entity ids, reusing released ones first so the component tables stay
+// sized to the live entities rather than to everything ever spawned.
+class EntityPool
+{
+public:
+	// Returns an unused id
+	int create();
+
+	// Gives id back to the pool, handles to it become stale
+	void release(int id);
+
+	bool is_alive(int id) const;
+	bool is_alive(EntityHandle handle) const;
+
+	// Handle to a live id
+	EntityHandle get_handle(int id) const;
+
+	// Number of ids currently handed out
+	size_t live_count() const;
+
+	// Records the ids created until end_batch, which returns them in creation order
+	void begin_batch();
+	std::vector<int> end_batch();
+
+private:
+	std::vector<uint32_t> m_generations;
+	std::vector<uint8_t> m_alive;
+	std::vector<int> m_free;
+	std::vector<int> m_batch;
+	bool m_batching = false;
+	size_t m_live_count = 0;
+};
+
+// Sparse set of component pointers keyed by entity id.
+// The components are kept in a dense array that can be walked linearly, and a
+// sparse id -> dense index table gives O(1) lookup, insert and (swap) remove.
+// Components are owned by their entities (and shared between entities of the
+// same kind), so the store only holds pointers to them.
+template <typename T>
+class ComponentStore
+{
+public:
+	// Adds or replaces the component of entity id
+	void insert(int id, T* component)
+	{
+		if (id >= (int)m_sparse.size())
+		{
+			m_sparse.resize(id + 1, -1);
+		}
+		int index = m_sparse[id];
+		if (index >= 0)
+		{
+			m_dense[index] = component;
+			return;
+		}
+		m_sparse[id] = (int)m_dense.size();
+		m_dense.push_back(component);
+		m_dense_ids.push_back(id);
+	}
+
+	// Removes the component of entity id, if it has one
+	void remove(int id)
+	{
+		if (!contains(id))
+		{
+			return;
+		}
+		int index = m_sparse[id];
+		int last = (int)m_dense.size() - 1;
+		m_dense[index] = m_dense[last];
+		m_dense_ids[index] = m_dense_ids[last];
+		m_sparse[m_dense_ids[index]] = index;
+		m_dense.pop_back();
+		m_dense_ids.pop_back();
+		m_sparse[id] = -1;
+	}
+
+	bool contains(int id) const
+	{
+		return id >= 0 && id < (int)m_sparse.size() && m_sparse[id] >= 0;
+	}
+
+	// Returns the component of entity id, or nullptr if it has none
+	T* get(int id) const
+	{
+		return contains(id) ? m_dense[m_sparse[id]] : nullptr;
+	}
+
+	// Removes every component, keeping the allocated tables
+	void clear()
+	{
+		for (int id : m_dense_ids)
+		{
+			m_sparse[id] = -1;
+		}
+		m_dense.clear();
+		m_dense_ids.clear();
+	}
+
+	size_t size() const { return m_dense.size(); }
+
+	// Dense iteration, ids()[i] owns components()[i]
+	const std::vector<T*>& components() const { return m_dense; }
+	const std::vector<int>& ids() const { return m_dense_ids; }
+
+private:
+	std::vector<int> m_sparse;
+	std::vector<T*> m_dense;
+	std::vector<int> m_dense_ids;
+};
 
 struct MotionComponent
 {
@@ -14,8 +131,6 @@ struct MotionComponent
 	float radians;
 	Physics physics;
 };
-extern std::map<int, MotionComponent*> s_motion_components;
-extern std::map<int, MotionComponent*> s_ui_motion_components;
 
 struct RenderComponent
 {
@@ -34,8 +149,12 @@ struct RenderComponent
 
     void draw_ui_sprite_alpha(const mat3 &projection, float alpha);
 };
-extern std::map<int, RenderComponent*> s_render_components;
-extern std::map<int, RenderComponent*> s_ui_render_components;
 
+// Removes the level components of an entity and gives its id back to the pool of
+// the calling thread's world context
+extern void release_entity(int id);
+extern void release_ui_entity(int id);
+
+// Remove every component and give the ids of their entities back to the pool
 extern void clear_level_components();
 extern void clear_ui_components();
\ No newline at end of file
@@ -0,0 +1,161 @@
+#include "crowd_system.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	const int BUCKET_COUNT = 4096; // a power of two, cells are folded into it
+	const float CELL_SIZE = brick_size;
+	const float SEPARATION_RADIUS = brick_size; // ghosts are a brick wide, touching is fine
+	const float SEPARATION_SPEED = 60.f; // pixels per second when two ghosts are on top of each other
+
+	int cell_of(float coordinate)
+	{
+		return (int)std::floor(coordinate / CELL_SIZE);
+	}
+}
+
+int CrowdSystem::bucket_of(int x, int y) const
+{
+	return (int)(((uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u) & (BUCKET_COUNT - 1));
+}
+
+void CrowdSystem::build(const std::vector<vec2>& positions)
+{
+	size_t count = positions.size();
+	m_positions = positions;
+	m_cell_x.resize(count);
+	m_cell_y.resize(count);
+	m_buckets.resize(count);
+	m_members.resize(count);
+	m_offsets.assign(BUCKET_COUNT + 1, 0);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		m_cell_x[i] = cell_of(positions[i].x);
+		m_cell_y[i] = cell_of(positions[i].y);
+		m_buckets[i] = bucket_of(m_cell_x[i], m_cell_y[i]);
+		m_offsets[m_buckets[i]]++;
+	}
+
+	// Offsets are the end of each bucket, filling backwards leaves them at the start
+	// with the members in index order
+	for (int b = 1; b <= BUCKET_COUNT; b++)
+	{
+		m_offsets[b] += m_offsets[b - 1];
+	}
+	for (size_t i = count; i-- > 0;)
+	{
+		m_members[--m_offsets[m_buckets[i]]] = (int)i;
+	}
+}
+
+void CrowdSystem::separate(const std::vector<vec2>& positions, const std::vector<uint8_t>& moving,
+	std::vector<vec2>& pushes) const
+{
+	pushes.resize(positions.size());
+	separate(positions, moving, pushes, 0, positions.size());
+}
+
+void CrowdSystem::separate(const std::vector<vec2>& positions, const std::vector<uint8_t>& moving,
+	std::vector<vec2>& pushes, size_t begin, size_t end) const
+{
+	for (size_t i = begin; i < end; i++)
+	{
+		if (!moving[i])
+		{
+			pushes[i] = { 0.f, 0.f };
+			continue;
+		}
+
+		vec2 position = positions[i];
+		vec2 push = { 0.f, 0.f };
+
+		// The radius is a cell, so neighbours are in the 3x3 cells around
+		for (int y = m_cell_y[i] - 1; y <= m_cell_y[i] + 1; y++)
+		{
+			for (int x = m_cell_x[i] - 1; x <= m_cell_x[i] + 1; x++)
+			{
+				int b = bucket_of(x, y);
+				for (int k = m_offsets[b]; k < m_offsets[b + 1]; k++)
+				{
+					int j = m_members[k];
+					if (j == (int)i || m_cell_x[j] != x || m_cell_y[j] != y)
+					{
+						continue;
+					}
+
+					vec2 away = sub(position, positions[j]);
+					float distance_sq = dot(away, away);
+					if (distance_sq >= SEPARATION_RADIUS * SEPARATION_RADIUS)
+					{
+						continue;
+					}
+
+					// Ghosts on the same spot are pushed opposite ways by index
+					float distance = std::sqrt(distance_sq);
+					vec2 direction = distance > TOLERANCE ? mul(away, 1.f / distance) :
+						vec2{ j < (int)i ? 1.f : -1.f, 0.f };
+					push = add(push, mul(direction, (SEPARATION_RADIUS - distance) / SEPARATION_RADIUS));
+				}
+			}
+		}
+
+		float strength = len(push);
+		if (strength > 1.f)
+		{
+			push = mul(push, 1.f / strength);
+		}
+		pushes[i] = mul(push, SEPARATION_SPEED);
+	}
+}
+
+void CrowdSystem::query(vec2 position, float radius, std::vector<int>& members) const
+{
+	members.clear();
+	if (m_members.empty())
+	{
+		return;
+	}
+
+	int x0 = cell_of(position.x - radius), x1 = cell_of(position.x + radius);
+	int y0 = cell_of(position.y - radius), y1 = cell_of(position.y + radius);
+	for (int y = y0; y <= y1; y++)
+	{
+		for (int x = x0; x <= x1; x++)
+		{
+			int b = bucket_of(x, y);
+			for (int k = m_offsets[b]; k < m_offsets[b + 1]; k++)
+			{
+				int i = m_members[k];
+				vec2 away = sub(m_positions[i], position);
+				if (m_cell_x[i] == x && m_cell_y[i] == y && dot(away, away) <= radius * radius)
+				{
+					members.push_back(i);
+				}
+			}
+		}
+	}
+	std::sort(members.begin(), members.end());
+}
+
+vec2 CrowdSystem::get_position(int member) const
+{
+	return m_positions[member];
+}
+
+void CrowdSystem::clear()
+{
+	m_positions.clear();
+	m_cell_x.clear();
+	m_cell_y.clear();
+	m_buckets.clear();
+	m_members.clear();
+	m_offsets.clear();
+}
+
+size_t CrowdSystem::size() const
+{
+	return m_members.size();
+}
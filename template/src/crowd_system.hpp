@@ -0,0 +1,47 @@
+#pragma once
+
+#include "common.hpp"
+#include <vector>
+
+// Spatial hash over the ghosts of a level, rebuilt from their positions every update.
+// Members are known by their index in the positions they were built from. Ghosts that
+// are moving are steered apart from the others in one batch, and collision checks
+// only look at the ghosts hashed near what they test.
+class CrowdSystem
+{
+public:
+	// Files every position under the cell it is in, count sorted so the members of a
+	// cell are kept in index order
+	void build(const std::vector<vec2>& positions);
+
+	// Velocities that push moving members out of their neighbours, zero for members
+	// that stand still or have no one near
+	void separate(const std::vector<vec2>& positions, const std::vector<uint8_t>& moving,
+		std::vector<vec2>& pushes) const;
+
+	// The same for members [begin, end) only, pushes must already hold every member.
+	// Ranges that don't overlap can be separated in parallel
+	void separate(const std::vector<vec2>& positions, const std::vector<uint8_t>& moving,
+		std::vector<vec2>& pushes, size_t begin, size_t end) const;
+
+	// Members within radius of position when the crowd was built, in index order
+	void query(vec2 position, float radius, std::vector<int>& members) const;
+
+	// Where member was when the crowd was built
+	vec2 get_position(int member) const;
+
+	// Forgets every member
+	void clear();
+
+	size_t size() const;
+
+private:
+	int bucket_of(int x, int y) const;
+
+	// Cell of each member, and the members of each bucket from m_offsets[b] on
+	std::vector<int> m_cell_x, m_cell_y;
+	std::vector<int> m_offsets;
+	std::vector<int> m_members;
+	std::vector<int> m_buckets;
+	std::vector<vec2> m_positions;
+};
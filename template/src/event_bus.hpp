@@ -0,0 +1,135 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <algorithm>
+#include <stddef.h>
+
+// The robot hit a brick, speed is how fast it was going into it
+struct CollisionEvent
+{
+	float speed;
+
+	// Every bang of an update is the same sound, the hardest one decides if it plays
+	bool same_as(const CollisionEvent&) const { return true; }
+	void merge(const CollisionEvent& other) { speed = std::max(speed, other.speed); }
+};
+
+// The robot went into or out of the area of a trigger, like a sign
+struct TriggerEvent
+{
+	int trigger;
+	bool entered;
+
+	// Only where the robot ended up matters
+	bool same_as(const TriggerEvent& other) const { return trigger == other.trigger; }
+	void merge(const TriggerEvent& other) { entered = other.entered; }
+};
+
+// A ghost caught the robot
+struct HurtEvent
+{
+	int ghost;
+
+	// The level resets once no matter how many ghosts got there
+	bool same_as(const HurtEvent&) const { return true; }
+	void merge(const HurtEvent&) {}
+};
+
+// The level wants different background music
+struct MusicEvent
+{
+	Music music;
+
+	bool same_as(const MusicEvent&) const { return true; }
+	void merge(const MusicEvent& other) { music = other.music; }
+};
+
+// Fixed capacity ring of the events of one type emitted during an update, drained in
+// the order they were emitted at the update's sync point. An event the same as one
+// already queued is folded into it with merge. Emitting never allocates, a full ring
+// drops its oldest event.
+// Only the thread running the update emits, jobs it hands out must not.
+template <typename T, size_t N>
+class EventQueue
+{
+public:
+	void emit(const T& event)
+	{
+		for (size_t i = 0; i < m_count; i++)
+		{
+			T& queued = m_events[(m_head + i) % N];
+			if (queued.same_as(event))
+			{
+				queued.merge(event);
+				return;
+			}
+		}
+
+		if (m_count == N)
+		{
+			m_head = (m_head + 1) % N;
+			m_count--;
+			m_dropped++;
+		}
+		m_events[(m_head + m_count) % N] = event;
+		m_count++;
+	}
+
+	// Hands every queued event to handler and empties the ring, handler may emit more
+	// and they are drained too
+	template <typename Handler>
+	void drain(Handler handler)
+	{
+		while (m_count > 0)
+		{
+			T event = m_events[m_head];
+			m_head = (m_head + 1) % N;
+			m_count--;
+			handler(event);
+		}
+	}
+
+	void clear()
+	{
+		m_head = 0;
+		m_count = 0;
+	}
+
+	size_t size() const
+	{
+		return m_count;
+	}
+
+	// Events lost to a full ring since the queue was made
+	size_t dropped() const
+	{
+		return m_dropped;
+	}
+
+private:
+	T m_events[N];
+	size_t m_head = 0;
+	size_t m_count = 0;
+	size_t m_dropped = 0;
+};
+
+// What a level's update tells the rest of the game. The simulation emits into it
+// instead of playing sounds or resetting in the middle of its loops, and the level
+// drains it once the update is done
+struct EventBus
+{
+	EventQueue<CollisionEvent, 8> collisions;
+	EventQueue<TriggerEvent, 64> triggers;
+	EventQueue<HurtEvent, 4> hurts;
+	EventQueue<MusicEvent, 4> music;
+
+	// Forgets what was emitted, used when the level is unloaded
+	void clear()
+	{
+		collisions.clear();
+		triggers.clear();
+		hurts.clear();
+		music.clear();
+	}
+};
@@ -0,0 +1,231 @@
+#include "flow_field.hpp"
+
+namespace
+{
+	// The robot can move this far from the anchor and the field is kept anyway
+	const float DRIFT_RADIUS = brick_size;
+
+	// Further than this the detour through the anchor is not worth it, even if the
+	// anchor sees the robot
+	const float RETARGET_RANGE = 4.f * brick_size;
+
+	// Scratch for the nodes near a ghost, enter runs on the game and worker threads
+	thread_local std::vector<int> t_nearby;
+
+	// Index into the per channel arrays of a channel bit
+	int channel_index(uint8_t channel)
+	{
+		int index = 0;
+		while (channel > 1)
+		{
+			channel >>= 1;
+			index++;
+		}
+		return index;
+	}
+}
+
+void FlowField::set_graph(const LevelGraph* graph)
+{
+	m_graph = graph;
+	for (Channel& channel : m_channels)
+	{
+		channel.field.reset();
+		channel.stale = true;
+	}
+}
+
+void FlowField::set_goal(vec2 goal, uint8_t channel)
+{
+	m_goal = goal;
+
+	int cell_x = (int)floor(goal.x / brick_size);
+	int cell_y = (int)floor(goal.y / brick_size);
+	if (cell_x != m_goal_cell_x || cell_y != m_goal_cell_y)
+	{
+		m_goal_cell_x = cell_x;
+		m_goal_cell_y = cell_y;
+		for (Channel& other : m_channels)
+		{
+			other.moved = true;
+		}
+	}
+
+	if (m_graph == nullptr)
+	{
+		return;
+	}
+
+	Channel& current = m_channels[channel_index(channel)];
+	if (!current.stale && current.moved)
+	{
+		current.moved = false;
+		if (still_leads_to(*current.field, goal, channel))
+			m_rebuilds_avoided++;
+		else
+			current.stale = true;
+	}
+
+	if (current.stale)
+	{
+		std::shared_ptr<Field> field = std::make_shared<Field>();
+		m_graph->flow_to(goal, channel, field->distance, field->next);
+		field->anchor = goal;
+		current.field = field;
+		current.stale = false;
+		current.moved = false;
+		m_rebuild_count++;
+	}
+}
+
+vec2 FlowField::get_goal() const
+{
+	return m_goal;
+}
+
+int FlowField::next(int node, uint8_t channel) const
+{
+	const Field* field = channel_of(channel).field.get();
+	if (field == nullptr || node < 0 || node >= (int)field->next.size())
+	{
+		return LevelGraph::UNREACHABLE;
+	}
+	return field->next[node];
+}
+
+int FlowField::enter(vec2 position, uint8_t channel) const
+{
+	const Field* field = channel_of(channel).field.get();
+	if (m_graph == nullptr || field == nullptr)
+	{
+		return LevelGraph::UNREACHABLE;
+	}
+	return enter(*m_graph, *field, m_goal, position, channel);
+}
+
+int FlowField::enter(const LevelGraph& graph, const Field& field, vec2 goal, vec2 position, uint8_t channel)
+{
+	if (graph.can_see(position, goal, channel))
+	{
+		return LevelGraph::TO_GOAL;
+	}
+
+	std::vector<int>& nearby = t_nearby;
+	graph.get_nearby_nodes(position, nearby);
+
+	int best = LevelGraph::UNREACHABLE;
+	float best_distance = INFINITY;
+
+	for (int i : nearby)
+	{
+		if (i >= (int)field.distance.size())
+			continue;
+
+		// Cheaper than the line test, so it goes first
+		float distance = field.distance[i] + len(sub(position, graph.get_node(i)));
+		if (distance < best_distance && graph.can_see(position, graph.get_node(i), channel))
+		{
+			best = i;
+			best_distance = distance;
+		}
+	}
+	return best;
+}
+
+std::shared_ptr<const FlowField::Field> FlowField::get_field(uint8_t channel) const
+{
+	return channel_of(channel).field;
+}
+
+bool FlowField::can_see_goal(vec2 position, uint8_t channel) const
+{
+	return m_graph != nullptr && m_graph->can_see(position, m_goal, channel);
+}
+
+bool FlowField::can_see(vec2 a, vec2 b, uint8_t channel) const
+{
+	return m_graph != nullptr && m_graph->can_see(a, b, channel);
+}
+
+vec2 FlowField::get_node(int node) const
+{
+	return m_graph->get_node(node);
+}
+
+vec2 FlowField::get_anchor(uint8_t channel) const
+{
+	const Field* field = channel_of(channel).field.get();
+	return field != nullptr ? field->anchor : m_goal;
+}
+
+int FlowField::get_rebuild_count() const
+{
+	return m_rebuild_count;
+}
+
+int FlowField::get_rebuilds_avoided() const
+{
+	return m_rebuilds_avoided;
+}
+
+void FlowField::save_state(FlowFieldState& state) const
+{
+	state.goal = m_goal;
+	state.goal_cell_x = m_goal_cell_x;
+	state.goal_cell_y = m_goal_cell_y;
+	for (int i = 0; i < 4; i++)
+	{
+		const Channel& channel = m_channels[i];
+		state.built[i] = channel.field != nullptr && !channel.stale;
+		state.anchors[i] = state.built[i] ? channel.field->anchor : vec2{ 0.f, 0.f };
+		state.moved[i] = channel.moved;
+	}
+	state.rebuild_count = m_rebuild_count;
+	state.rebuilds_avoided = m_rebuilds_avoided;
+}
+
+void FlowField::load_state(const FlowFieldState& state)
+{
+	m_goal = state.goal;
+	m_goal_cell_x = state.goal_cell_x;
+	m_goal_cell_y = state.goal_cell_y;
+	for (int i = 0; i < 4; i++)
+	{
+		Channel& channel = m_channels[i];
+		channel.moved = state.moved[i] != 0;
+		if (!state.built[i] || m_graph == nullptr)
+		{
+			channel.field.reset();
+			channel.stale = true;
+			continue;
+		}
+
+		// Fields are handed out, one may still be read elsewhere so it is replaced
+		vec2 anchor = state.anchors[i];
+		if (channel.stale || channel.field == nullptr || !(channel.field->anchor == anchor))
+		{
+			std::shared_ptr<Field> field = std::make_shared<Field>();
+			m_graph->flow_to(anchor, (uint8_t)(1 << i), field->distance, field->next);
+			field->anchor = anchor;
+			channel.field = field;
+		}
+		channel.stale = false;
+	}
+	m_rebuild_count = state.rebuild_count;
+	m_rebuilds_avoided = state.rebuilds_avoided;
+}
+
+const FlowField::Channel& FlowField::channel_of(uint8_t channel) const
+{
+	return m_channels[channel_index(channel)];
+}
+
+bool FlowField::still_leads_to(const Field& field, vec2 goal, uint8_t channel) const
+{
+	float drift = len(sub(goal, field.anchor));
+	if (drift <= DRIFT_RADIUS)
+	{
+		return true;
+	}
+	return drift <= RETARGET_RANGE && m_graph->can_see(field.anchor, goal, channel);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "common.hpp"
+#include "level_graph.hpp"
+#include "snapshot.hpp"
+#include <memory>
+#include <vector>
+
+// Shortest distance to the robot from every node of a level graph, one field per
+// headlight channel, so every ghost reads its next waypoint in O(1) and pathfinding
+// no longer grows with ghost count.
+//
+// A field leads to its anchor, the robot position it was built from. It is kept
+// while the robot stays near the anchor, or a little further if the anchor can
+// still see the robot: ghosts then go through the anchor and on to the robot.
+// The drift is checked each time the robot crosses into another brick cell, and a
+// field is always rebuilt for a new graph.
+//
+// A rebuild makes a new Field rather than changing the old one, so a worker can
+// keep reading the one it was handed while the game moves on.
+class FlowField
+{
+public:
+	struct Field
+	{
+		std::vector<float> distance;
+		std::vector<int> next;
+		vec2 anchor;
+	};
+
+	// Follows the graph of a level, every field is rebuilt on next use
+	void set_graph(const LevelGraph* graph);
+
+	// Moves the goal to the robot's pixel position and makes sure the field of channel
+	// is up to date with it
+	void set_goal(vec2 goal, uint8_t channel);
+
+	vec2 get_goal() const;
+
+	// Robot position the field of channel was built from, every node whose next step
+	// is LevelGraph::TO_GOAL can see it
+	vec2 get_anchor(uint8_t channel) const;
+
+	// Where to go from node: another node, LevelGraph::TO_GOAL or LevelGraph::UNREACHABLE
+	int next(int node, uint8_t channel) const;
+
+	// Best way onto the field from anywhere, same results as next. Tests the straight
+	// line to the nodes, so only called when a ghost loses its place on the field
+	int enter(vec2 position, uint8_t channel) const;
+
+	// The same for a field handed out earlier with the goal at the time, only reads
+	// graph and field so it can run on any thread
+	static int enter(const LevelGraph& graph, const Field& field, vec2 goal, vec2 position, uint8_t channel);
+
+	// Current field of channel, empty if it was never built
+	std::shared_ptr<const Field> get_field(uint8_t channel) const;
+
+	// Whether position can go straight for the goal
+	bool can_see_goal(vec2 position, uint8_t channel) const;
+
+	// Whether a ghost can go straight between two pixel positions
+	bool can_see(vec2 a, vec2 b, uint8_t channel) const;
+
+	vec2 get_node(int node) const;
+
+	// Number of times a field has been rebuilt
+	int get_rebuild_count() const;
+
+	// Number of times the robot crossed into another cell and the field was kept
+	int get_rebuilds_avoided() const;
+
+	// Copies what the fields were built from into state
+	void save_state(FlowFieldState& state) const;
+
+	// Puts the fields back the way they were when state was saved, the ones built from
+	// another anchor since are built again
+	void load_state(const FlowFieldState& state);
+
+private:
+	struct Channel
+	{
+		std::shared_ptr<const Field> field;
+		bool stale = true; // must be rebuilt
+		bool moved = false; // the robot has changed cell since the drift was checked
+	};
+
+	const Channel& channel_of(uint8_t channel) const;
+
+	// Whether the field can still lead to the robot at goal
+	bool still_leads_to(const Field& field, vec2 goal, uint8_t channel) const;
+
+	const LevelGraph* m_graph = nullptr;
+	vec2 m_goal = { 0.f, 0.f };
+	int m_goal_cell_x = 0;
+	int m_goal_cell_y = 0;
+	Channel m_channels[4];
+	int m_rebuild_count = 0;
+	int m_rebuilds_avoided = 0;
+};
@@ -0,0 +1,167 @@
+#include "frame_scheduler.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+FrameScheduler s_frame_scheduler;
+
+namespace
+{
+	using Clock = std::chrono::high_resolution_clock;
+
+	const int STARVED_FRAMES = 30; // about half a second passed over before a task runs anyway
+	const float COST_SMOOTHING = 0.25f; // weight of the latest step in a task's expected cost
+
+	float ms_since(Clock::time_point start)
+	{
+		return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+	}
+}
+
+int FrameScheduler::add(const std::string& name, float cost_ms, Step step)
+{
+	Task task = { m_next_id++, name, cost_ms, step, 0, false };
+	m_added.push_back(task);
+	return task.id;
+}
+
+void FrameScheduler::run(float budget_ms)
+{
+	m_tasks.insert(m_tasks.end(), m_added.begin(), m_added.end());
+	m_added.clear();
+	if (m_tasks.empty())
+	{
+		return;
+	}
+
+	m_running = true;
+	Clock::time_point start = Clock::now();
+	bool reported = false;
+
+	// Starved tasks get one step before anything else, then the rest share what is left
+	for (int starved = 1; starved >= 0; starved--)
+	{
+		for (Task& task : m_tasks)
+		{
+			if (task.done || (task.frames_waited >= STARVED_FRAMES) != (starved == 1))
+			{
+				continue;
+			}
+
+			bool ran = false;
+			while (!task.done && (starved == 1 || ms_since(start) + task.cost_ms <= budget_ms))
+			{
+				float step_ms = run_step(task);
+				ran = true;
+
+				if (!reported && ms_since(start) > budget_ms)
+				{
+					fprintf(stderr, "frame task budget of %.1f ms overrun by %s, step took %.2f ms%s\n", budget_ms,
+						task.name.c_str(), step_ms, starved == 1 ? " after starving" : "");
+					reported = true;
+				}
+				if (starved == 1)
+				{
+					break;
+				}
+			}
+			task.frames_waited = ran ? 0 : task.frames_waited + 1;
+		}
+	}
+
+	m_tasks.erase(std::remove_if(m_tasks.begin(), m_tasks.end(), [](const Task& task) { return task.done; }),
+		m_tasks.end());
+	m_running = false;
+}
+
+float FrameScheduler::run_step(Task& task)
+{
+	Clock::time_point start = Clock::now();
+	task.done = task.step();
+	float step_ms = ms_since(start);
+	task.cost_ms += (step_ms - task.cost_ms) * COST_SMOOTHING;
+	return step_ms;
+}
+
+void FrameScheduler::finish(int id)
+{
+	Task* task = find(id);
+	if (task == nullptr)
+	{
+		return;
+	}
+
+	// The step may queue more tasks, which can move this one, so it runs from a copy
+	Step step = task->step;
+	task->done = true;
+	while (!step())
+	{
+	}
+}
+
+void FrameScheduler::cancel(int id)
+{
+	Task* task = find(id);
+	if (task != nullptr)
+	{
+		task->done = true;
+	}
+}
+
+bool FrameScheduler::is_queued(int id) const
+{
+	for (const std::vector<Task>* tasks : { &m_tasks, &m_added })
+	{
+		for (const Task& task : *tasks)
+		{
+			if (task.id == id && !task.done)
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+size_t FrameScheduler::size() const
+{
+	size_t count = 0;
+	for (const Task& task : m_tasks)
+	{
+		count += !task.done;
+	}
+	for (const Task& task : m_added)
+	{
+		count += !task.done;
+	}
+	return count;
+}
+
+void FrameScheduler::clear()
+{
+	// Tasks may be cleared from inside a step, the running frame drops them at its end
+	for (Task& task : m_tasks)
+	{
+		task.done = true;
+	}
+	m_added.clear();
+	if (!m_running)
+	{
+		m_tasks.clear();
+	}
+}
+
+FrameScheduler::Task* FrameScheduler::find(int id)
+{
+	for (std::vector<Task>* tasks : { &m_tasks, &m_added })
+	{
+		for (Task& task : *tasks)
+		{
+			if (task.id == id && !task.done)
+			{
+				return &task;
+			}
+		}
+	}
+	return nullptr;
+}
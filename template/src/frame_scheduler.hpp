@@ -0,0 +1,62 @@
+#pragma once
+
+#include "common.hpp"
+#include <functional>
+#include <string>
+#include <vector>
+
+// Spreads main thread work that doesn't have to finish this frame over several frames.
+// A task is a step function that does a slice of the work each call and returns true
+// once it is done. Every frame the queued tasks run, oldest first, as long as their
+// expected step cost fits the frame's budget; the cost is learned from the steps that
+// ran. A task passed over for too many frames in a row runs first next frame whatever
+// the budget, and the task that takes a frame over its budget is named in the log.
+// Only work the simulation doesn't read belongs here, so runs stay reproducible.
+class FrameScheduler
+{
+public:
+	typedef std::function<bool()> Step;
+
+	// Queues a task, cost_ms is a guess at how long one step takes. Returns an id to
+	// finish or cancel it with
+	int add(const std::string& name, float cost_ms, Step step);
+
+	// Runs steps of the queued tasks for up to about budget_ms
+	void run(float budget_ms);
+
+	// Runs task id to the end now, for when its result is needed
+	void finish(int id);
+
+	// Drops task id, its remaining steps never run
+	void cancel(int id);
+
+	bool is_queued(int id) const;
+
+	// Number of tasks waiting to run
+	size_t size() const;
+
+	// Drops every task
+	void clear();
+
+private:
+	struct Task
+	{
+		int id;
+		std::string name;
+		float cost_ms;
+		Step step;
+		int frames_waited;
+		bool done;
+	};
+
+	Task* find(int id);
+
+	// Runs one step of task, returns how long it took
+	float run_step(Task& task);
+
+	std::vector<Task> m_tasks;
+	std::vector<Task> m_added; // queued by steps while running, joins m_tasks next frame
+	bool m_running = false;
+	int m_next_id = 1;
+};
+extern FrameScheduler s_frame_scheduler;
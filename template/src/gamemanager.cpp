@@ -1,4 +1,5 @@
 #include "gamemanager.hpp"
+#include "world_context.hpp"
 
 #include <sstream>
 #include <vector>
@@ -76,6 +77,7 @@ bool GameManager::init(vec2 screen)
 	glfwSetScrollCallback(m_window, mouse_scroll_redirect);
 
 	m_sound_system = SoundSystem::get_system();
+	get_world_context().audio = m_sound_system;
 
 	m_title_menu.init(m_window, screen);
 	load_title_menu();
@@ -172,6 +174,28 @@ void GameManager::draw()
 	}
 }
 
+bool GameManager::draws_from_snapshot()
+{
+	// Menus don't update and the maker still draws straight from its entities
+	return !m_in_maker;
+}
+
+void GameManager::capture_frame()
+{
+	if (!m_in_menu && !m_in_maker)
+	{
+		m_world.capture_render_state();
+	}
+}
+
+void GameManager::publish_frame()
+{
+	if (!m_in_menu && !m_in_maker)
+	{
+		m_world.publish_render_state();
+	}
+}
+
 bool GameManager::game_over()
 {
 	if (m_is_over)
@@ -209,6 +233,15 @@ void GameManager::destroy()
 	glfwDestroyWindow(m_window);
 }
 
+uint64_t GameManager::get_state_hash()
+{
+	if (m_in_menu || m_in_maker)
+	{
+		return 0;
+	}
+	return m_world.get_state_hash();
+}
+
 void GameManager::on_key(GLFWwindow* window, int key, int scancode, int action, int mod)
 {
 	if (m_in_menu)
@@ -19,12 +19,25 @@ public:
 	// Draw the game
 	void draw();
 
+	// Whether draw() only reads the published render snapshot, so update() can run
+	// on another thread meanwhile
+	bool draws_from_snapshot();
+
+	// Copies what the next draw needs, once a frame's updates are done
+	void capture_frame();
+
+	// Hands the frame captured last to draw(), only between frames
+	void publish_frame();
+
 	// Is the game over
 	bool game_over();
 
 	// Destroy all assets
 	void destroy();
 
+	// Hash of the level simulation state, 0 while not playing a level
+	uint64_t get_state_hash();
+
 	// Handle input
 	void on_key(GLFWwindow*, int key, int, int action, int mod);
 	void on_mouse_move(GLFWwindow* window, double xpos, double ypos);
@@ -1,22 +1,19 @@
 // Header
 #include "ghost.hpp"
+#include "world_context.hpp"
 
 #include <cmath>
 
 Texture Ghost::s_ghost_texture;
+SharedInit Ghost::s_shared_init;
 
 bool Ghost::init(int id, vec3 colour, vec3 headlight_colour)
 {
+	WorldContext& world = get_world_context();
 	m_id = id;
 
-	if (!s_ghost_texture.is_valid())
-	{
-		if (!s_ghost_texture.load_from_file(textures_path("ghost.png")))
-		{
-			fprintf(stderr, "Failed to load ghost texture!");
-			return false;
-		}
-	}
+	if (!s_shared_init.run(load_texture))
+		return false;
 
 	rc.can_be_hidden = 0;
 	rc.texture = &s_ghost_texture;
@@ -38,58 +35,128 @@ bool Ghost::init(int id, vec3 colour, vec3 headlight_colour)
 
 	rc.colour = m_colour;
 
-	s_render_components[id] = &rc;
-	s_motion_components[id] = &mc;
+	world.render_components.insert(id, &rc);
+	world.motion_components.insert(id, &mc);
+	m_motion_system = &world.motion_system;
+	m_motion_system->add(id, &mc);
 
-	calculate_hitbox();
+	return true;
+}
 
+bool Ghost::load_texture()
+{
+	if (!s_ghost_texture.load_from_file(textures_path("ghost.png")))
+	{
+		fprintf(stderr, "Failed to load ghost texture!");
+		return false;
+	}
 	return true;
 }
 
 void Ghost::update(float ms)
 {
-    if (!m_is_chasing) {
+	// the motion system moves the ghost, this only decides where it should be next
+	m_step_velocity = { 0.f, 0.f };
+	m_motion_system->set_velocity(m_id, m_step_velocity);
+
+    if (!m_is_chasing || ms <= 0.f) {
         return;
     }
-	if (m_path.size() == 0 || len(sub(m_path.back(), m_goal)) > TOLERANCE)
+
+	// Ghosts only take new steps towards a robot in range, a step already taken is finished
+	bool in_range = len(sub(m_goal, mc.position)) < GHOST_CHASE_RANGE;
+	if (m_target == LevelGraph::TO_GOAL && !m_via_anchor && !m_flow_field->can_see_goal(mc.position, m_nav_channel))
 	{
-		set_path();
+		// The robot moved out of sight, the last segment is retargeted if it can be
+		if (!go_through_anchor(mc.position))
+			m_target = LevelGraph::UNREACHABLE;
+	}
+	if ((m_target == LevelGraph::UNREACHABLE || m_reenter) && !m_waiting && in_range &&
+		m_lost_at != m_flow_field->get_rebuild_count())
+	{
+		if (!m_path_service)
+		{
+			m_replans++;
+			m_reenter = false;
+			m_via_anchor = false;
+			m_target = m_flow_field->enter(mc.position, m_nav_channel);
+			if (m_target == LevelGraph::UNREACHABLE)
+			{
+				m_lost_at = m_flow_field->get_rebuild_count();
+			}
+		}
+		else
+		{
+			// Answered a few updates later, the ghost keeps going the way it was until then
+			m_request = { m_client, m_serial, 0, mc.position, m_goal, m_nav_channel,
+				m_flow_field->get_field(m_nav_channel) };
+			m_request_start = mc.position;
+			m_has_request = true;
+		}
 	}
 
-	if (m_path.size() > 0)
+	if (m_target != LevelGraph::UNREACHABLE)
 	{
-		float allowed_move = 100.f * ms / 1000.f;
-		vec2 next_pos = m_path[0];
+		float allowed_move = GHOST_SPEED * ms / 1000.f;
+		vec2 position = mc.position;
+		vec2 scale = mc.physics.scale;
 
 		while (allowed_move > TOLERANCE)
 		{
-			vec2 disp = sub(next_pos, mc.position);
+			vec2 next_pos = m_target != LevelGraph::TO_GOAL ? m_flow_field->get_node(m_target) :
+				(m_via_anchor ? m_anchor : m_goal);
+			vec2 disp = sub(next_pos, position);
 			if (disp.x != 0.f)
 			{
-				mc.physics.scale.x = -abs(mc.physics.scale.x) * disp.x / abs(disp.x);
+				scale.x = -abs(scale.x) * disp.x / abs(disp.x);
 			}
 			float dist = len(disp);
 
 			if (allowed_move < dist)
 			{
 				vec2 dir = normalize(disp);
-				mc.position = add(mc.position, mul(dir, allowed_move));
-				m_hitbox.translate(mul(dir, allowed_move));
+				position = add(position, mul(dir, allowed_move));
 				allowed_move = 0.f;
 			}
 			else
 			{
-				mc.position = next_pos;
-				m_hitbox.translate(disp);
+				position = next_pos;
 				allowed_move -= dist;
-				m_path.erase(m_path.begin() + 0);
 
-				if (m_path.size() > 0)
-					next_pos = m_path[0];
-				else
+				if (m_target == LevelGraph::TO_GOAL && m_via_anchor)
+				{
+					m_via_anchor = false;
+					if (!m_flow_field->can_see_goal(position, m_nav_channel))
+					{
+						m_target = LevelGraph::UNREACHABLE;
+						allowed_move = 0.f;
+					}
+				}
+				else if (m_target == LevelGraph::TO_GOAL)
+				{
 					allowed_move = 0.f;
+				}
+				else
+				{
+					m_target = in_range ? m_flow_field->next(m_target, m_nav_channel) : LevelGraph::UNREACHABLE;
+
+					// The robot may have drifted from where the field was built, out of
+					// sight of this node
+					if (m_target == LevelGraph::TO_GOAL && !m_flow_field->can_see_goal(position, m_nav_channel) &&
+						!go_through_anchor(position))
+					{
+						m_target = LevelGraph::UNREACHABLE;
+					}
+					if (m_target == LevelGraph::UNREACHABLE)
+						allowed_move = 0.f;
+				}
 			}
 		}
+
+		// the steps below get the ghost there, over more than one when it updates less often
+		m_step_velocity = mul(sub(position, mc.position), 1000.f / ms);
+		m_motion_system->set_velocity(m_id, m_step_velocity);
+		m_motion_system->set_scale(m_id, scale);
 	}
 }
 
@@ -100,26 +167,49 @@ vec2 Ghost::get_position()const
 
 void Ghost::set_position(vec2 position)
 {
-    vec2 translation;
+    m_step_velocity = { 0.f, 0.f };
+    m_motion_system->set_position(m_id, position);
+    m_motion_system->set_velocity(m_id, m_step_velocity);
+
+	// an answer on its way was for where the ghost was
+	m_target = LevelGraph::UNREACHABLE;
+	m_via_anchor = false;
+	m_lost_at = -1;
+	m_waiting = false;
+	m_has_request = false;
+	m_reenter = false;
+	m_serial++;
+}
 
-    translation.x = position.x - mc.position.x;
-    translation.y = position.y - mc.position.y;
+vec3 Ghost::get_colour()
+{
+	return m_colour;
+}
 
-    mc.position = position;
+vec2 Ghost::get_scale() const
+{
+	return mc.physics.scale;
+}
 
-    m_hitbox.translate(translation);
+Hitbox Ghost::get_hitbox() const
+{
+    // built where the ghost is, the crowd pushes it off the way it was following
+    return calculate_hitbox();
+}
 
-	m_path.clear();
+bool Ghost::is_moving() const
+{
+	return m_step_velocity.x != 0.f || m_step_velocity.y != 0.f;
 }
 
-vec3 Ghost::get_colour()
+bool Ghost::is_chasing() const
 {
-	return m_colour;
+	return m_is_chasing;
 }
 
-Hitbox Ghost::get_hitbox() const
+void Ghost::push(vec2 velocity)
 {
-    return m_hitbox;
+	m_motion_system->set_velocity(m_id, add(m_step_velocity, velocity));
 }
 
 void Ghost::set_goal(vec2 position)
@@ -127,9 +217,73 @@ void Ghost::set_goal(vec2 position)
 	m_goal = position;
 }
 
-void Ghost::set_level_graph(LevelGraph* graph)
+void Ghost::set_flow_field(const FlowField* flow_field)
+{
+	m_flow_field = flow_field;
+	m_target = LevelGraph::UNREACHABLE;
+	m_via_anchor = false;
+	m_lost_at = -1;
+	m_waiting = false;
+	m_has_request = false;
+	m_reenter = false;
+	m_serial++;
+}
+
+void Ghost::set_path_service(PathService* path_service, int client)
+{
+	m_path_service = path_service;
+	m_client = client;
+}
+
+void Ghost::send_request(uint32_t due)
 {
-	m_level_graph = graph;
+	if (!m_has_request)
+	{
+		return;
+	}
+
+	m_has_request = false;
+	m_request.due = due;
+	m_request_due = due;
+	if (m_path_service->submit(m_request))
+	{
+		m_waiting = true;
+		m_replans++;
+	}
+	m_request.field.reset();
+}
+
+void Ghost::take_path(const PathService::Result& result)
+{
+	if (result.serial != m_serial)
+	{
+		return;
+	}
+
+	// The answer is a few updates old, the ghost has moved at most a few pixels since
+	m_waiting = false;
+	m_reenter = false;
+	m_target = result.target;
+	m_via_anchor = false;
+	if (m_target == LevelGraph::UNREACHABLE)
+	{
+		m_lost_at = m_flow_field->get_rebuild_count();
+	}
+}
+
+void Ghost::set_nav_channel(uint8_t channel)
+{
+	// The edges of the old channel may not exist in the new one, the ghost asks for
+	// its way again and keeps going until the answer comes
+	if (channel != m_nav_channel)
+	{
+		m_reenter = true;
+		m_lost_at = -1;
+		m_waiting = false;
+		m_has_request = false;
+		m_serial++;
+	}
+	m_nav_channel = channel;
 }
 
 void Ghost::update_is_chasing(vec3 headlight_color) {
@@ -140,23 +294,83 @@ void Ghost::update_is_chasing(vec3 headlight_color) {
     m_is_chasing = !(m_colour.x == headlight_color.x && m_colour.y == headlight_color.y && m_colour.z == headlight_color.z);
 }
 
-void Ghost::set_path()
+bool Ghost::colour_is_white(vec3 colour) {
+	return colour.x == 1.f && colour.y == 1.f && colour.z == 1.f;
+}
+
+float Ghost::dist_from_goal() {
+	return len(sub(mc.position, m_goal));
+}
+
+int Ghost::get_replans() const
 {
-	if (len(sub(m_goal, mc.position)) < 800.f)
+	return m_replans;
+}
+
+int Ghost::get_replans_avoided() const
+{
+	return m_replans_avoided;
+}
+
+bool Ghost::go_through_anchor(vec2 position)
+{
+	m_anchor = m_flow_field->get_anchor(m_nav_channel);
+	m_via_anchor = m_flow_field->can_see(position, m_anchor, m_nav_channel);
+	if (m_via_anchor)
 	{
-		m_path = m_level_graph->get_path(mc.position, m_goal);
+		m_replans_avoided++;
 	}
+	return m_via_anchor;
 }
 
-bool Ghost::colour_is_white(vec3 colour) {
-	return colour.x == 1.f && colour.y == 1.f && colour.z == 1.f;
+void Ghost::save_state(GhostState& state) const
+{
+	state.position = mc.position;
+	state.facing = mc.physics.scale.x < 0.f ? -1.f : 1.f;
+	state.step_velocity = m_step_velocity;
+	state.goal = m_goal;
+	state.anchor = m_anchor;
+	state.target = m_target;
+	state.lost_at = m_lost_at;
+	state.request_start = m_waiting ? m_request_start : vec2{ 0.f, 0.f };
+	state.request_due = m_waiting ? m_request_due : 0;
+	state.nav_channel = m_nav_channel;
+	state.via_anchor = m_via_anchor;
+	state.waiting = m_waiting;
+	state.reenter = m_reenter;
 }
 
-float Ghost::dist_from_goal() {
-	return len(sub(mc.position, m_goal));
+void Ghost::load_state(const GhostState& state)
+{
+	m_motion_system->set_position(m_id, state.position);
+	m_motion_system->set_scale(m_id, { abs(mc.physics.scale.x) * state.facing, mc.physics.scale.y });
+	m_step_velocity = state.step_velocity;
+	m_motion_system->set_velocity(m_id, m_step_velocity);
+
+	m_goal = state.goal;
+	m_anchor = state.anchor;
+	m_target = state.target;
+	m_lost_at = state.lost_at;
+	m_nav_channel = state.nav_channel;
+	m_via_anchor = state.via_anchor != 0;
+	m_reenter = state.reenter != 0;
+
+	// Answers on their way were asked for after the state was saved, the request that
+	// was waiting is asked again so its answer comes on the same update as it did
+	m_serial++;
+	m_has_request = false;
+	m_waiting = false;
+	m_request_start = state.request_start;
+	m_request_due = state.request_due;
+	if (state.waiting && m_path_service)
+	{
+		PathService::Request request = { m_client, m_serial, m_request_due, m_request_start, m_goal,
+			m_nav_channel, m_flow_field->get_field(m_nav_channel) };
+		m_waiting = m_path_service->submit(request);
+	}
 }
 
-void Ghost::calculate_hitbox() {
+Hitbox Ghost::calculate_hitbox() const {
     std::vector<Square> squares(1);
 
     float width = brick_size;
@@ -166,6 +380,5 @@ void Ghost::calculate_hitbox() {
     Square square(position, (int)width);
     squares[0] = square;
 
-    Hitbox hitbox({}, squares);
-    m_hitbox = hitbox;
+    return Hitbox({}, squares);
 }
@@ -2,19 +2,59 @@
 
 #include "common.hpp"
 #include "hitbox.hpp"
-#include "level_graph.hpp"
+#include "flow_field.hpp"
+#include "path_service.hpp"
 #include "components.hpp"
+#include "motion_system.hpp"
+#include "snapshot.hpp"
 
 class Ghost : public Entity
 {
 	static Texture s_ghost_texture;
+	static SharedInit s_shared_init;
+
+	// Loads the texture every ghost shares, once for all worlds
+	static bool load_texture();
 	vec2 m_goal;
-	std::vector<vec2> m_path;
-	LevelGraph* m_level_graph;
+	const FlowField* m_flow_field = nullptr;
+	uint8_t m_nav_channel = NAV_WHITE;
+
+	// Node of the flow field the ghost is heading for, LevelGraph::TO_GOAL when it is
+	// going straight for the goal, LevelGraph::UNREACHABLE when it has no way there
+	int m_target = LevelGraph::UNREACHABLE;
+
+	// Going for the goal through the anchor of the field, the robot has drifted out
+	// of sight of the node the ghost came from
+	bool m_via_anchor = false;
+	vec2 m_anchor;
+
+	// Finds the ghost's way onto the flow field when it has lost its place, the answer
+	// comes back PathService::ANSWER_TICKS updates later as client m_client
+	PathService* m_path_service = nullptr;
+	int m_client = 0;
+	bool m_waiting = false; // for an answer to request m_serial
+	vec2 m_request_start = { 0.f, 0.f }; // where the ghost was when it asked
+	uint32_t m_request_due = 0; // update the answer is taken on
+	bool m_has_request = false; // m_request is still to be sent
+	PathService::Request m_request;
+	bool m_reenter = false; // should find its way onto the field again
+	uint32_t m_serial = 0;
+
+	// Rebuild count of the flow field when the ghost last failed to find a way onto it,
+	// it doesn't look again until the field changes
+	int m_lost_at = -1;
+
+	// Times the ghost had to find its way onto the field again, and times it lost
+	// sight of the robot but could keep going through the anchor instead
+	int m_replans = 0;
+	int m_replans_avoided = 0;
 
 	RenderComponent rc;
 	MotionComponent mc;
 
+	// Velocity of the step planned by the last update, without the crowd's push
+	vec2 m_step_velocity = { 0.f, 0.f };
+
 public:
 	// Creates all the associated render resources and default transform
 	bool init(int id, vec3 colour, vec3 headlight_colour);
@@ -31,28 +71,70 @@ public:
 	// Get the colour of the ghost
 	vec3 get_colour();
 
+	// Returns the scale of the ghost's texture, negative x when it faces left
+	vec2 get_scale() const;
+
 	// Returns the bricks hitbox for collision detection
 	Hitbox get_hitbox() const;
 
+	// Whether the ghost is partway through a step
+	bool is_moving() const;
+
+	// Whether the headlight lets the ghost chase the robot
+	bool is_chasing() const;
+
+	// Adds velocity to the step the ghost is taking until the next push, keeps the
+	// crowd apart
+	void push(vec2 velocity);
+
 	// Tell the ghost where it wants to go
 	void set_goal(vec2 position);
 
-	// Tell the ghost how to navigate the map
-	void set_level_graph(LevelGraph* graph);
+	// Tell the ghost how to navigate the map, it finds its way onto the field again
+	// as the nodes it knew may be gone
+	void set_flow_field(const FlowField* flow_field);
+
+	// Tell the ghost where to ask for its way onto the flow field, and who it is.
+	// Without one the ghost finds its way itself during update
+	void set_path_service(PathService* path_service, int client);
+
+	// Hands the service the request the last update made, if it made one, to be
+	// answered on update due. Ghosts can update in parallel, but the service takes
+	// requests from one thread
+	void send_request(uint32_t due);
+
+	// Hands the ghost the answer to a request it submitted
+	void take_path(const PathService::Result& result);
+
+	// Tell the ghost which headlight channel's edges it may use
+	void set_nav_channel(uint8_t channel);
 
 	// Update whether ghost is currently visible
 	void update_is_chasing(vec3 headlight_color);
 
-	// Set path
-	void set_path();
-
 	float dist_from_goal();
 
+	int get_replans() const;
+	int get_replans_avoided() const;
+
+	// Copies the part of the ghost that changes during play into state
+	void save_state(GhostState& state) const;
+
+	// Puts the ghost back into a previously saved state, heading the same way on the
+	// flow field, which must already be back in the state saved with it
+	void load_state(const GhostState& state);
+
 private:
     vec3 m_colour;
     bool m_is_chasing;
-    Hitbox m_hitbox;
 
-    void calculate_hitbox();
+    // Kept from init, ghosts update on job threads that have no world context bound
+    MotionSystem* m_motion_system = nullptr;
+
+    Hitbox calculate_hitbox() const;
+
+	// Heads for the goal through the anchor of the field, returns false if position
+	// can't see the anchor either
+	bool go_through_anchor(vec2 position);
 	bool colour_is_white(vec3 colour);
 };
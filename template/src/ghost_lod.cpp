@@ -0,0 +1,98 @@
+#include "ghost_lod.hpp"
+
+namespace
+{
+	const float NEAR_RANGE = 400.f; // about half a screen, ghosts the player is watching
+	const uint32_t MID_INTERVAL = 4; // ticks between updates of a mid range ghost
+}
+
+void GhostLod::schedule(const CrowdSystem& crowd, vec2 robot, const std::vector<uint8_t>& chasing,
+	const std::vector<uint8_t>& moving, uint32_t tick)
+{
+	size_t count = chasing.size();
+	m_tiers.assign(count, PARKED);
+	m_due.assign(count, 0);
+
+	// The robot coming in range is what wakes a parked ghost, only the ghosts hashed
+	// near it are looked at
+	crowd.query(robot, GHOST_CHASE_RANGE, m_in_range);
+	for (int i : m_in_range)
+	{
+		if (i < (int)count && chasing[i])
+		{
+			vec2 away = sub(crowd.get_position(i), robot);
+			m_tiers[i] = dot(away, away) < NEAR_RANGE * NEAR_RANGE ? NEAR : MID;
+		}
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		if (m_tiers[i] == PARKED && moving[i])
+		{
+			// Out of range ghosts finish the step they took, hidden ones stop right away
+			m_tiers[i] = MID;
+			m_due[i] = !chasing[i];
+		}
+
+		if (m_tiers[i] == NEAR)
+			m_due[i] = 1;
+		else if (m_tiers[i] == MID)
+			m_due[i] |= (tick + i) % MID_INTERVAL == 0;
+
+		m_tier_counts[m_tiers[i]]++;
+		if (m_due[i])
+			m_updates++;
+		else
+			m_skipped++;
+	}
+	m_ticks++;
+}
+
+bool GhostLod::is_due(size_t i) const
+{
+	return m_due[i] != 0;
+}
+
+float GhostLod::get_span(size_t i, float ms) const
+{
+	// A mid range ghost covers the ticks until it is due again
+	return m_tiers[i] == MID ? ms * MID_INTERVAL : ms;
+}
+
+GhostLod::Tier GhostLod::get_tier(size_t i) const
+{
+	return (Tier)m_tiers[i];
+}
+
+void GhostLod::add_update_time(double seconds)
+{
+	m_update_time += seconds;
+}
+
+void GhostLod::report() const
+{
+	if (m_ticks == 0)
+	{
+		return;
+	}
+
+	// Only the whole update is timed, so a skipped ghost update has no cost of its own
+	// to count. eitd_bench lod times the ghosts with and without the tiers
+	fprintf(stderr, "	ghost ai per update: %.1f near, %.1f mid, %.1f parked, skipped %ld of %ld updates, level update %.3f ms\n",
+		(double)m_tier_counts[NEAR] / m_ticks, (double)m_tier_counts[MID] / m_ticks,
+		(double)m_tier_counts[PARKED] / m_ticks, m_skipped, m_skipped + m_updates, m_update_time / m_ticks * 1000.0);
+}
+
+void GhostLod::clear()
+{
+	m_tiers.clear();
+	m_due.clear();
+	for (long& count : m_tier_counts)
+	{
+		count = 0;
+	}
+	m_updates = 0;
+	m_skipped = 0;
+	m_ticks = 0;
+	m_update_time = 0.0;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "common.hpp"
+#include "crowd_system.hpp"
+#include <vector>
+
+// Decides which ghosts update each tick by how far they are from the robot. Near ghosts
+// update every tick. Ghosts further off but still in chase range update every few ticks
+// for all the time since, the motion system spreads the step over the ticks between.
+// Ghosts that stand still and can't chase, being out of range or hidden by the
+// headlight, are parked and skipped until the robot comes in range or they chase again.
+class GhostLod
+{
+public:
+	enum Tier : uint8_t { NEAR, MID, PARKED, TIER_COUNT };
+
+	// Sorts the ghosts into tiers for tick. crowd holds where they were last update,
+	// chasing and moving say which ghosts chase the robot and which are partway
+	// through a step
+	void schedule(const CrowdSystem& crowd, vec2 robot, const std::vector<uint8_t>& chasing,
+		const std::vector<uint8_t>& moving, uint32_t tick);
+
+	// Whether ghost i updates this tick, and the time its update covers
+	bool is_due(size_t i) const;
+	float get_span(size_t i, float ms) const;
+
+	Tier get_tier(size_t i) const;
+
+	// Adds the time an update of the level took, measured by whoever runs the level
+	// since the simulation never reads the clock
+	void add_update_time(double seconds);
+
+	// Prints the ghosts in each tier per update, the updates skipped and the average
+	// time an update of the level took
+	void report() const;
+
+	// Forgets the ghosts and the counts
+	void clear();
+
+private:
+	std::vector<uint8_t> m_tiers;
+	std::vector<uint8_t> m_due;
+	std::vector<int> m_in_range;
+
+	// Totals since the level was loaded
+	long m_tier_counts[TIER_COUNT] = {};
+	long m_updates = 0;
+	long m_skipped = 0;
+	long m_ticks = 0;
+	double m_update_time = 0.0;
+};
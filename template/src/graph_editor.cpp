@@ -0,0 +1,267 @@
+#include "graph_editor.hpp"
+
+#include <algorithm>
+
+void GraphEditor::begin(LevelGraph* graph, const NavLayout& layout)
+{
+	m_graph = graph;
+	m_graph->set_layout(layout);
+	m_width = layout.width;
+	m_height = layout.height;
+
+	const int cell_count = m_width * m_height;
+	m_nodes.assign(cell_count, 0);
+	m_pairs.clear();
+	m_clear.clear();
+	m_filings.assign(cell_count, std::vector<Filing>());
+	m_pairs_tested = 0;
+
+	std::vector<int> nodes;
+	for (int cell = 0; cell < cell_count; cell++)
+	{
+		m_nodes[cell] = node_channels(cell);
+		if (m_nodes[cell])
+		{
+			nodes.push_back(cell);
+		}
+	}
+
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		for (size_t j = i + 1; j < nodes.size(); j++)
+		{
+			test_pair(nodes[i], nodes[j]);
+		}
+	}
+
+	publish();
+}
+
+void GraphEditor::set_cell(int x, int y, uint8_t blocked)
+{
+	m_pairs_tested = 0;
+	if (!m_graph || x < 0 || x >= m_width || y < 0 || y >= m_height ||
+		m_graph->get_grid().blocked(x, y) == blocked)
+	{
+		return;
+	}
+	m_graph->set_blocked(x, y, blocked);
+
+	// The cell's own node and those of its plus shape lose or gain channels, the
+	// diagonals stop or start being critical points
+	std::vector<int> changed;
+	for (int ny = std::max(0, y - 1); ny <= std::min(m_height - 1, y + 1); ny++)
+	{
+		for (int nx = std::max(0, x - 1); nx <= std::min(m_width - 1, x + 1); nx++)
+		{
+			int cell = ny * m_width + nx;
+			uint8_t channels = node_channels(cell);
+			if (channels != m_nodes[cell])
+			{
+				if (m_nodes[cell])
+				{
+					remove_node(cell);
+				}
+				m_nodes[cell] = channels;
+				changed.push_back(cell);
+			}
+		}
+	}
+
+	// Pairs through the cell, taken out first as testing files them again
+	const int64_t cell_count = m_width * m_height;
+	std::vector<Filing> filings;
+	filings.swap(m_filings[y * m_width + x]);
+	for (const Filing& filing : filings)
+	{
+		auto pair = m_pairs.find(filing.key);
+		if (pair != m_pairs.end() && pair->second.generation == filing.generation)
+		{
+			test_pair((int)(filing.key / cell_count), (int)(filing.key % cell_count));
+		}
+	}
+
+	std::vector<int> added;
+	for (int cell : changed)
+	{
+		if (m_nodes[cell])
+		{
+			add_node(cell, added);
+			added.push_back(cell);
+		}
+	}
+
+	publish();
+}
+
+int GraphEditor::get_pairs_tested() const
+{
+	return m_pairs_tested;
+}
+
+uint8_t GraphEditor::node_channels(int cell) const
+{
+	const OccupancyGrid& grid = m_graph->get_grid();
+	int x = cell % m_width;
+	int y = cell / m_width;
+
+	// A critical point is diagonal to a brick, as in NavLayout::add_brick
+	bool critical = false;
+	for (int dy = -1; dy <= 1; dy += 2)
+	{
+		for (int dx = -1; dx <= 1; dx += 2)
+		{
+			int cx = x + dx;
+			int cy = y + dy;
+			critical |= cx >= 0 && cx < m_width && cy >= 0 && cy < m_height && grid.blocked(cx, cy);
+		}
+	}
+	if (!critical)
+	{
+		return 0;
+	}
+
+	// Then kept in the channels where it and the cells beside it are clear, as in
+	// LevelGraph::place_nodes
+	const int plus[5][2] = { { -1, 0 }, { 1, 0 }, { 0, 1 }, { 0, -1 }, { 0, 0 } };
+	uint8_t channels = NAV_ALL_CHANNELS;
+	for (auto& offset : plus)
+	{
+		int px = x + offset[0];
+		int py = y + offset[1];
+		if (px >= 0 && px < m_width && py >= 0 && py < m_height)
+		{
+			channels &= ~grid.blocked(px, py);
+		}
+	}
+	return channels;
+}
+
+void GraphEditor::add_node(int cell, const std::vector<int>& skip)
+{
+	for (int other = 0; other < (int)m_nodes.size(); other++)
+	{
+		if (other != cell && m_nodes[other] && std::find(skip.begin(), skip.end(), other) == skip.end())
+		{
+			test_pair(std::min(cell, other), std::max(cell, other));
+		}
+	}
+}
+
+void GraphEditor::remove_node(int cell)
+{
+	const int64_t cell_count = m_width * m_height;
+	for (int other = 0; other < (int)m_nodes.size(); other++)
+	{
+		if (other != cell && m_nodes[other])
+		{
+			int a = std::min(cell, other);
+			int b = std::max(cell, other);
+			m_pairs.erase(a * cell_count + b);
+			m_clear.erase(a * cell_count + b);
+		}
+	}
+}
+
+void GraphEditor::test_pair(int a, int b)
+{
+	const int64_t key = a * (int64_t)(m_width * m_height) + b;
+	uint8_t channels = m_nodes[a] & m_nodes[b];
+	if (!channels)
+	{
+		m_pairs.erase(key);
+		m_clear.erase(key);
+		return;
+	}
+	m_pairs_tested++;
+
+	const OccupancyGrid& grid = m_graph->get_grid();
+	grid.crossed_cells(pixel_of(a), pixel_of(b), m_crossed);
+
+	Pair& pair = m_pairs[key];
+	pair.generation = ++m_generation;
+	const Filing filing = { key, pair.generation };
+
+	// The first cell blocking each channel is enough to find out when it opens up
+	int witnesses[4];
+	int witness_count = 0;
+	pair.clear = channels;
+	for (int cell : m_crossed)
+	{
+		uint8_t hit = grid.blocked(cell % m_width, cell / m_width) & pair.clear;
+		if (hit)
+		{
+			pair.clear &= ~hit;
+			witnesses[witness_count++] = cell;
+			file(cell, filing);
+		}
+	}
+
+	if (!pair.clear)
+	{
+		m_clear.erase(key);
+		return;
+	}
+	m_clear[key] = pair.clear;
+
+	// A slide that is clear somewhere can be blocked by any cell it crosses
+	for (int cell : m_crossed)
+	{
+		if (std::find(witnesses, witnesses + witness_count, cell) == witnesses + witness_count)
+		{
+			file(cell, filing);
+		}
+	}
+}
+
+void GraphEditor::file(int cell, const Filing& filing)
+{
+	// Pairs tested again leave their old filings behind, they are dropped whenever
+	// the list would have to grow
+	std::vector<Filing>& filings = m_filings[cell];
+	if (filings.size() == filings.capacity() && filings.size() >= 16)
+	{
+		filings.erase(std::remove_if(filings.begin(), filings.end(), [&](const Filing& old) {
+			auto pair = m_pairs.find(old.key);
+			return pair == m_pairs.end() || pair->second.generation != old.generation;
+		}), filings.end());
+
+		// Mostly live, grow now rather than sweep again after a few more
+		if (filings.size() * 2 > filings.capacity())
+		{
+			filings.reserve(filings.capacity() * 2);
+		}
+	}
+	filings.push_back(filing);
+}
+
+void GraphEditor::publish()
+{
+	const int64_t cell_count = m_width * m_height;
+	std::vector<int> index(cell_count, -1);
+	std::vector<vec2> nodes;
+	std::vector<uint8_t> node_channels;
+	for (int cell = 0; cell < cell_count; cell++)
+	{
+		if (m_nodes[cell])
+		{
+			index[cell] = (int)nodes.size();
+			nodes.push_back(pixel_of(cell));
+			node_channels.push_back(m_nodes[cell]);
+		}
+	}
+
+	std::vector<LevelGraph::NodePair> pairs;
+	pairs.reserve(m_clear.size());
+	for (auto& pair : m_clear)
+	{
+		pairs.push_back({ index[pair.first / cell_count], index[pair.first % cell_count], pair.second });
+	}
+
+	m_graph->set_edges(nodes, node_channels, pairs);
+}
+
+vec2 GraphEditor::pixel_of(int cell) const
+{
+	return to_pixel_position({ (float)(cell % m_width), (float)(cell / m_width) });
+}
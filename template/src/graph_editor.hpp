@@ -0,0 +1,74 @@
+#pragma once
+
+#include "common.hpp"
+#include "level_graph.hpp"
+#include <unordered_map>
+#include <vector>
+
+// Keeps the critical point graph of a small level up to date while its bricks are
+// edited, instead of generating it again. Nodes are known by their cell. Every node
+// pair is filed under each cell its slide crosses while it is clear in some channel,
+// and otherwise under the first cell that blocks it in each channel. Changing a cell
+// then re-tests the pairs filed under it and the nodes in the 3x3 block around it,
+// which are the only ones whose critical point or channels can change.
+class GraphEditor
+{
+public:
+	// Fills graph with the graph of layout and follows it from then on
+	void begin(LevelGraph* graph, const NavLayout& layout);
+
+	// Changes the channels cell x, y is blocked in and updates the graph
+	void set_cell(int x, int y, uint8_t blocked);
+
+	// Node pairs the last change had to test again
+	int get_pairs_tested() const;
+
+private:
+	struct Pair
+	{
+		uint8_t clear; // channels the slide is clear in
+		uint32_t generation; // filings from before the last test are out of date
+	};
+
+	struct Filing
+	{
+		int64_t key;
+		uint32_t generation;
+	};
+
+	// Channels a node at cell would be clear in, 0 if there is no critical point there
+	uint8_t node_channels(int cell) const;
+
+	// Pairs a new node with every other node, or drops all the pairs of a node
+	void add_node(int cell, const std::vector<int>& skip);
+	void remove_node(int cell);
+
+	// Tests the slide between the nodes at cells a < b and files the pair again
+	void test_pair(int a, int b);
+
+	// Files a pair under cell
+	void file(int cell, const Filing& filing);
+
+	// Hands the nodes and clear pairs over to the graph
+	void publish();
+
+	vec2 pixel_of(int cell) const;
+
+	LevelGraph* m_graph = nullptr;
+	int m_width = 0;
+	int m_height = 0;
+
+	// Channels of the node at each cell, 0 where there is none
+	std::vector<uint8_t> m_nodes;
+
+	// Pairs by a * cell count + b, and the pairs filed under each cell
+	std::unordered_map<int64_t, Pair> m_pairs;
+
+	// Channels of the pairs that are clear in some, the edges of the graph
+	std::unordered_map<int64_t, uint8_t> m_clear;
+	std::vector<std::vector<Filing>> m_filings;
+	uint32_t m_generation = 0;
+
+	std::vector<int> m_crossed;
+	int m_pairs_tested = 0;
+};
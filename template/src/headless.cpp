@@ -0,0 +1,173 @@
+// internal
+#include "common.hpp"
+#include "level.hpp"
+#include "random.hpp"
+#include "world_context.hpp"
+
+// stlib
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::high_resolution_clock;
+
+// Runs a level for a number of ticks without a window or audio device, feeding it key
+// presses from a script, then prints how long the ticks took, the slowest of them and
+// the final state hash.
+//
+//   eitd_headless <level> <ticks> [--input <script>] [--seed <seed>]
+//
+// Every line of a script is "<tick> <key> <press|release>", the key goes to the level
+// right before that tick's update. Keys are named as in key_codes, lines starting
+// with # are comments. The same level, script and seed always end in the same hash.
+
+namespace
+{
+	struct ScriptedKey
+	{
+		unsigned long tick;
+		int key;
+		int action;
+	};
+
+	// Keys the level handles
+	const std::map<std::string, int> key_codes = {
+		{ "space", GLFW_KEY_SPACE },
+		{ "left", GLFW_KEY_LEFT },
+		{ "right", GLFW_KEY_RIGHT },
+		{ "a", GLFW_KEY_A },
+		{ "d", GLFW_KEY_D },
+		{ "f", GLFW_KEY_F },
+		{ "r", GLFW_KEY_R },
+		{ "1", GLFW_KEY_1 },
+		{ "2", GLFW_KEY_2 },
+		{ "3", GLFW_KEY_3 },
+	};
+
+	// Reads a script into keys in tick order, returns false on a line it can't read
+	bool load_script(const char* path, std::vector<ScriptedKey>& keys)
+	{
+		std::ifstream file(path);
+		if (!file.is_open())
+		{
+			fprintf(stderr, "Failed to open input script %s\n", path);
+			return false;
+		}
+
+		std::string line;
+		for (int number = 1; std::getline(file, line); number++)
+		{
+			// blank lines and comments
+			size_t start = line.find_first_not_of(" \t\r");
+			if (start == std::string::npos || line[start] == '#')
+				continue;
+
+			std::istringstream words(line);
+			ScriptedKey scripted;
+			std::string key, action;
+			auto code = key_codes.end();
+			if (words >> scripted.tick >> key >> action)
+				code = key_codes.find(key);
+			if (code == key_codes.end() || (action != "press" && action != "release"))
+			{
+				fprintf(stderr, "%s:%d: expected <tick> <key> <press|release>\n", path, number);
+				return false;
+			}
+			scripted.key = code->second;
+			scripted.action = action == "press" ? GLFW_PRESS : GLFW_RELEASE;
+
+			if (!keys.empty() && scripted.tick < keys.back().tick)
+			{
+				fprintf(stderr, "%s:%d: ticks must not go backwards\n", path, number);
+				return false;
+			}
+			keys.push_back(scripted);
+		}
+		return true;
+	}
+}
+
+// Entry point
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		fprintf(stderr, "usage: %s <level> <ticks> [--input <script>] [--seed <seed>]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	std::string level_name = argv[1];
+	unsigned long ticks = strtoul(argv[2], nullptr, 10);
+	uint64_t seed = 0;
+	std::vector<ScriptedKey> keys;
+	for (int i = 3; i + 1 < argc; i += 2)
+	{
+		if (strcmp(argv[i], "--input") == 0)
+		{
+			if (!load_script(argv[i + 1], keys))
+				return EXIT_FAILURE;
+		}
+		else if (strcmp(argv[i], "--seed") == 0)
+		{
+			seed = strtoull(argv[i + 1], nullptr, 10);
+		}
+	}
+
+	// Nothing here draws, textures are only read for their size
+	use_null_renderer();
+
+	// The level gets a context of its own, its sounds go to the context's NullAudio
+	std::unique_ptr<WorldContext> world(new WorldContext());
+	WorldContextScope world_scope(world.get());
+	seed_random_streams(seed);
+
+	std::unique_ptr<Level> level(new Level());
+	auto load_start = Clock::now();
+	if (!level->parse_level(level_name, { "level_select", level_name }, { -1000.f, -1000.f }))
+	{
+		fprintf(stderr, "Failed to load level %s\n", level_name.c_str());
+		return EXIT_FAILURE;
+	}
+	auto load_end = Clock::now();
+
+	std::unordered_map<int, int> input_states;
+	size_t next_key = 0;
+	double worst_ms = 0.0;
+	unsigned long worst_tick = 0;
+	for (unsigned long tick = 0; tick < ticks; tick++)
+	{
+		for (; next_key < keys.size() && keys[next_key].tick == tick; next_key++)
+		{
+			// Doors only lead somewhere in the game, the run stays on its level
+			std::string destination = level->handle_key_press(keys[next_key].key, keys[next_key].action, input_states);
+			if (!destination.empty())
+				fprintf(stderr, "tick %lu door to %s\n", tick, destination.c_str());
+		}
+		auto update_start = Clock::now();
+		level->update(SIMULATION_STEP_MS);
+		double update_seconds = std::chrono::duration<double>(Clock::now() - update_start).count();
+		level->add_update_time(update_seconds);
+		if (update_seconds * 1000.0 > worst_ms)
+		{
+			worst_ms = update_seconds * 1000.0;
+			worst_tick = tick;
+		}
+	}
+	auto run_end = Clock::now();
+
+	double load_ms = std::chrono::duration<double, std::milli>(load_end - load_start).count();
+	double run_ms = std::chrono::duration<double, std::milli>(run_end - load_end).count();
+	printf("level %s: loaded in %.2f ms\n", level_name.c_str(), load_ms);
+	printf("%lu ticks in %.2f ms, %.4f ms/tick, worst %.3f ms on tick %lu\n", ticks, run_ms,
+		ticks > 0 ? run_ms / ticks : 0., worst_ms, worst_tick);
+	printf("state %016llx\n", (unsigned long long)level->get_state_hash());
+
+	level->destroy();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,240 @@
+#include "job_system.hpp"
+#include <algorithm>
+
+namespace
+{
+	const size_t CHUNKS_PER_WORKER = 4; // parallel_for splits finer than the workers so stealing can even out
+
+	// Which system's worker the thread is, if any
+	thread_local const JobSystem* t_system = nullptr;
+	thread_local unsigned t_index = 0;
+
+	// Jobs the thread is in, a job can run others while it waits
+	thread_local int t_running_jobs = 0;
+
+	struct RunningJob
+	{
+		RunningJob() { t_running_jobs++; }
+		~RunningJob() { t_running_jobs--; }
+	};
+}
+
+JobSystem::JobSystem(unsigned workers) : m_queued(0)
+{
+	workers = std::max(1u, workers);
+	for (unsigned i = 0; i < workers; i++)
+	{
+		m_workers.push_back(std::unique_ptr<Worker>(new Worker()));
+	}
+	for (unsigned i = 1; i < workers; i++)
+	{
+		m_threads.push_back(std::thread(&JobSystem::work, this, i));
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sleep_mutex);
+		m_stopping = true;
+	}
+	m_wake.notify_all();
+
+	for (auto& thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+JobSystem::Handle JobSystem::submit(std::function<void()> job, std::initializer_list<Handle> after)
+{
+	Handle handle = std::make_shared<Job>();
+	handle->run = std::move(job);
+	handle->waiting_on = 1;
+
+	for (const Handle& dependency : after)
+	{
+		if (!dependency)
+		{
+			continue;
+		}
+		std::lock_guard<std::mutex> lock(dependency->mutex);
+		if (!dependency->done)
+		{
+			dependency->dependents.push_back(handle);
+			handle->waiting_on++;
+		}
+	}
+
+	// Dependencies that finished meanwhile have already counted themselves off
+	if (--handle->waiting_on == 0)
+	{
+		push(handle);
+	}
+	return handle;
+}
+
+void JobSystem::wait(const Handle& job)
+{
+	unsigned index = current();
+	while (true)
+	{
+		{
+			std::lock_guard<std::mutex> lock(job->mutex);
+			if (job->done)
+			{
+				return;
+			}
+		}
+
+		Handle other;
+		if (take(index, other))
+		{
+			execute(other);
+		}
+		else
+		{
+			// What's left is running on another worker
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body)
+{
+	grain = std::max((size_t)1, grain);
+	size_t chunks = std::min((count + grain - 1) / grain, (size_t)size() * CHUNKS_PER_WORKER);
+	if (chunks <= 1 || size() == 1)
+	{
+		if (count > 0)
+		{
+			RunningJob running;
+			body(0, count);
+		}
+		return;
+	}
+
+	std::vector<Handle> jobs;
+	for (size_t c = 0; c < chunks; c++)
+	{
+		size_t begin = count * c / chunks;
+		size_t end = count * (c + 1) / chunks;
+		jobs.push_back(submit([&body, begin, end]() { body(begin, end); }));
+	}
+	for (const Handle& job : jobs)
+	{
+		wait(job);
+	}
+}
+
+unsigned JobSystem::size() const
+{
+	return (unsigned)m_workers.size();
+}
+
+void JobSystem::push(const Handle& job)
+{
+	Worker& worker = *m_workers[current()];
+	{
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.jobs.push_back(job);
+	}
+	m_queued++;
+
+	// Taking the lock orders this with a worker about to sleep, so it can't miss the job
+	{
+		std::lock_guard<std::mutex> lock(m_sleep_mutex);
+	}
+	m_wake.notify_one();
+}
+
+bool JobSystem::take(unsigned index, Handle& job)
+{
+	// Newest of its own first, it is likeliest to still be in cache
+	{
+		Worker& own = *m_workers[index];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.jobs.empty())
+		{
+			job = own.jobs.back();
+			own.jobs.pop_back();
+			m_queued--;
+			return true;
+		}
+	}
+
+	for (size_t k = 1; k < m_workers.size(); k++)
+	{
+		Worker& victim = *m_workers[(index + k) % m_workers.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.jobs.empty())
+		{
+			job = victim.jobs.front();
+			victim.jobs.pop_front();
+			m_queued--;
+			return true;
+		}
+	}
+	return false;
+}
+
+void JobSystem::execute(const Handle& job)
+{
+	{
+		RunningJob running;
+		job->run();
+	}
+
+	std::vector<Handle> dependents;
+	{
+		std::lock_guard<std::mutex> lock(job->mutex);
+		job->done = true;
+		dependents.swap(job->dependents);
+	}
+	for (const Handle& dependent : dependents)
+	{
+		if (--dependent->waiting_on == 0)
+		{
+			push(dependent);
+		}
+	}
+}
+
+void JobSystem::work(unsigned index)
+{
+	t_system = this;
+	t_index = index;
+
+	while (true)
+	{
+		Handle job;
+		if (take(index, job))
+		{
+			execute(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_sleep_mutex);
+		m_wake.wait(lock, [this] { return m_stopping || m_queued > 0; });
+		if (m_stopping)
+		{
+			return;
+		}
+	}
+}
+
+unsigned JobSystem::current() const
+{
+	return t_system == this ? t_index : 0;
+}
+
+JobSystem& get_job_system()
+{
+	static JobSystem jobs(std::max(1u, std::thread::hardware_concurrency()));
+	return jobs;
+}
+
+bool is_running_job()
+{
+	return t_running_jobs > 0;
+}
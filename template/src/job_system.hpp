@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work stealing job system for the systems of an update that don't depend on each
+// other. Every worker has a deque of jobs, it runs the newest of its own and steals
+// the oldest of another's when it runs out. The thread that made the system is
+// worker 0 and only runs jobs while it waits, so jobs must not touch GL.
+// A job can wait for others to finish before it starts, and parallel_for splits a
+// loop into jobs and returns once they are all done.
+// Any number of threads can submit and wait at once, threads that aren't workers
+// share worker 0's deque. A job runs on whichever thread takes it, which may be
+// waiting for another level's jobs, so jobs are handed everything they touch and
+// never reach the world context.
+class JobSystem
+{
+	struct Job;
+
+public:
+	typedef std::shared_ptr<Job> Handle;
+
+	// workers counts the creating thread, so 1 runs every job on it while it waits
+	explicit JobSystem(unsigned workers);
+	~JobSystem();
+
+	// Queues job to run once every job in after is done
+	Handle submit(std::function<void()> job, std::initializer_list<Handle> after = {});
+
+	// Runs jobs on the calling thread until job is done
+	void wait(const Handle& job);
+
+	// Runs body(begin, end) over [0, count) in chunks of at least grain items spread
+	// over the workers, and returns once every chunk is done
+	void parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+	// Number of workers, including the creating thread
+	unsigned size() const;
+
+private:
+	struct Job
+	{
+		std::function<void()> run;
+		std::atomic<int> waiting_on; // unfinished jobs it runs after, plus one while it is submitted
+		std::mutex mutex; // guards done and dependents
+		bool done = false;
+		std::vector<Handle> dependents;
+	};
+
+	struct Worker
+	{
+		std::mutex mutex;
+		std::deque<Handle> jobs;
+	};
+
+	// Puts a job whose dependencies are done on the calling worker's deque
+	void push(const Handle& job);
+
+	// Takes a job off worker index's own deque, or steals one, returns false if
+	// there was none anywhere
+	bool take(unsigned index, Handle& job);
+
+	void execute(const Handle& job);
+	void work(unsigned index);
+
+	// Worker the calling thread is in this system, 0 for threads that aren't workers
+	unsigned current() const;
+
+	std::vector<std::unique_ptr<Worker>> m_workers;
+	std::vector<std::thread> m_threads;
+
+	// Jobs sitting in deques, idle workers sleep while it is zero
+	std::atomic<int> m_queued;
+	std::mutex m_sleep_mutex;
+	std::condition_variable m_wake;
+	bool m_stopping = false;
+};
+
+// Job system shared by every level and the loading code, one worker per core
+JobSystem& get_job_system();
+
+// Whether the calling thread is in the middle of a job
+bool is_running_job();
@@ -1,6 +1,12 @@
 #include <iostream>
 #include "level.hpp"
+#include "world_context.hpp"
 #include "torch.hpp"
+#include "motion_system.hpp"
+#include "nav_cache.hpp"
+#include "job_system.hpp"
+#include <algorithm>
+#include <iterator>
 
 using json = nlohmann::json;
 
@@ -8,10 +14,20 @@ namespace
 {
     const size_t GHOST_DANGER_DIST = 500;
     const size_t COLLISION_SOUND_MIN_VEL = 5;
+    const size_t HISTORY_LENGTH = 600; // updates of history kept for rewinding, about 10s
+    const unsigned REWIND_TICKS = 60;
+    const size_t MAX_PARTICLES = 8192; // smoke, embers and trails alive at once, more are dropped
 }
 
 void Level::destroy()
 {
+	// a level that was never loaded has no context yet, it leaves the caller's alone
+	WorldContextScope world_scope(m_world != nullptr ? m_world : &get_world_context());
+
+	// the worker reads the graph, which is about to be regenerated
+	m_path_service.stop();
+	m_path_results.clear();
+
 	// clear all level-dependent resources
 	for (auto& brick_element : m_brick_map) {
 		delete brick_element.second;
@@ -19,6 +35,9 @@ void Level::destroy()
 	for (auto& interactable : m_interactables) {
 		delete interactable;
 	}
+	if (!m_ghosts.empty()) {
+		m_ghost_lod.report();
+	}
 	for (auto& ghost : m_ghosts) {
 		delete ghost;
 	}
@@ -37,27 +56,44 @@ void Level::destroy()
 	m_interactable = NULL;
     m_brick_map.clear();
     m_ghosts.clear();
+    m_crowd.clear();
+    m_ghost_lod.clear();
     m_interactables.clear();
     m_signs.clear();
+    m_signs_touched.clear();
     m_torches.clear();
 	m_backgrounds.clear();
+    m_events.clear();
+    get_world_context().particles.clear();
+    m_embers.clear();
+    m_ghost_trails.clear();
     m_rendering_system.destroy();
+    m_particle_renderer.destroy();
 	m_light.destroy();
 	m_robot.destroy();
 }
 
-void Level::draw_entities(const mat3 &projection, const vec2 &camera_shift) {
-    vec3 headlight_channel = m_light.get_headlight_channel();
-    m_rendering_system.render(projection, camera_shift, headlight_channel);
+void Level::draw_entities(const mat3 &projection, const vec2 &camera_shift, const RenderSnapshot &snapshot) {
+    m_rendering_system.render(projection, camera_shift, snapshot.sprites, snapshot.light.headlight_channel);
+    m_particle_renderer.draw(projection, camera_shift, snapshot.particles, snapshot.particle_batch);
+}
+
+void Level::draw_light(const mat3 &projection, const vec2 &camera_shift, const RenderSnapshot &snapshot) {
+    m_light.draw(projection, camera_shift, {width, height}, snapshot.light, m_torches);
 }
 
-void Level::draw_light(const mat3 &projection, const vec2 &camera_shift) {
-    m_light.draw(projection, camera_shift, {width, height}, m_torches);
+void Level::capture_render_state(RenderSnapshot &snapshot) const {
+    m_rendering_system.capture(snapshot.sprites);
+    if (m_world) {
+        m_world->particles.capture(snapshot.particles);
+        m_world->particles.take_batch(snapshot.particle_batch);
+    }
+    snapshot.light = m_light.get_state();
 }
 
 void Level::update(float elapsed_ms) {
 
-    SoundSystem* sound_system = SoundSystem::get_system();
+    WorldContextScope world_scope(m_world);
 
     vec2 robot_pos = m_robot.get_position();
     vec2 robot_head_pos = m_robot.get_head_position();
@@ -66,26 +102,12 @@ void Level::update(float elapsed_ms) {
 
     if (m_has_colour_changed) {
         vec3 headlight_channel = m_light.get_headlight_channel();
-        if (headlight_channel.x == 1.f && headlight_channel.y == 1.f && headlight_channel.z == 1.f) {
-            m_graph = &m_white_graph;
-        }
-        if (headlight_channel.x == 1.f && headlight_channel.y == 0.f && headlight_channel.z == 0.f) {
-            m_graph = &m_red_graph;
-        }
-        if (headlight_channel.x == 0.f && headlight_channel.y == 1.f && headlight_channel.z == 0.f) {
-            m_graph = &m_green_graph;
+        uint8_t nav_channel = nav_channel_of(headlight_channel);
+        if (nav_channel != 0) {
+            m_nav_channel = nav_channel;
         }
-        if (headlight_channel.x == 0.f && headlight_channel.y == 0.f && headlight_channel.z == 1.f) {
-            m_graph = &m_blue_graph;
-        }
-        for (auto &brick_element : m_brick_map) {
-            Brick* i_brick = brick_element.second;
-            i_brick->update(headlight_channel);
-        }
-
         for (auto &i_ghost : m_ghosts) {
-            i_ghost->set_level_graph(m_graph);
-			i_ghost->set_path();
+            i_ghost->set_nav_channel(m_nav_channel);
             i_ghost->update_is_chasing(headlight_channel);
         }
         m_has_colour_changed = false;
@@ -109,13 +131,11 @@ void Level::update(float elapsed_ms) {
             continue;
         }
         Brick brick = *m_brick_map[pos];
-        bool should_check_collisions = brick.get_is_collidable();
+        bool should_check_collisions = brick.get_is_collidable(m_light.get_headlight_channel());
         if (should_check_collisions) {
             if (brick.get_hitbox().collides_with(robot_hitbox_x)) {
                 vec2 vel = m_robot.get_velocity();
-                if (std::abs(vel.x) >= COLLISION_SOUND_MIN_VEL) {
-                    sound_system->play_sound_effect(Sound_Effects::collision);
-                }
+                m_events.collisions.emit({std::abs(vel.x)});
                 m_robot.set_velocity({0.f, vel.y});
 
                 float circle_width = brick_size / 2.f;
@@ -134,9 +154,7 @@ void Level::update(float elapsed_ms) {
 
             if (brick.get_hitbox().collides_with(robot_head_hitbox_x)) {
                 vec2 head_vel = m_robot.get_head_velocity();
-                if (std::abs(head_vel.x) >= COLLISION_SOUND_MIN_VEL) {
-                    sound_system->play_sound_effect(Sound_Effects::collision);
-                }
+                m_events.collisions.emit({std::abs(head_vel.x)});
                 m_robot.set_head_velocity({0.f, head_vel.y});
 
                 float circle_width = brick_size / 2.f;
@@ -172,13 +190,11 @@ void Level::update(float elapsed_ms) {
             continue;
         }
         Brick brick = *m_brick_map[pos];
-        bool should_check_collisions = brick.get_is_collidable();
+        bool should_check_collisions = brick.get_is_collidable(m_light.get_headlight_channel());
         if (should_check_collisions) {
             if (brick.get_hitbox().collides_with(robot_hitbox_y)) {
                 vec2 vel = m_robot.get_velocity();
-                if (std::abs(vel.y) >= COLLISION_SOUND_MIN_VEL) {
-                    sound_system->play_sound_effect(Sound_Effects::collision);
-                }
+                m_events.collisions.emit({std::abs(vel.y)});
                 m_robot.set_velocity({vel.x, 0.f});
 
                 float circle_width = brick_size / 2.f;
@@ -199,9 +215,7 @@ void Level::update(float elapsed_ms) {
 
             if (brick.get_hitbox().collides_with(robot_head_hitbox_y)) {
                 vec2 head_vel = m_robot.get_head_velocity();
-                if (std::abs(head_vel.y) >= COLLISION_SOUND_MIN_VEL) {
-                    sound_system->play_sound_effect(Sound_Effects::collision);
-                }
+                m_events.collisions.emit({std::abs(head_vel.y)});
                 m_robot.set_head_velocity({head_vel.x, 0.f});
 
                 float circle_width = brick_size / 2.f;
@@ -217,11 +231,12 @@ void Level::update(float elapsed_ms) {
                 translation_head = new_robot_head_pos.y - robot_head_pos.y;
             }
         }
-        Music level_bgm = get_level_music();
-        if (level_bgm != prev_bgm) {
-            sound_system->play_bgm(level_bgm);
-            prev_bgm = level_bgm;
-        }
+    }
+
+    Music level_bgm = get_level_music();
+    if (level_bgm != prev_bgm) {
+        m_events.music.emit({level_bgm});
+        prev_bgm = level_bgm;
     }
 
     m_robot.set_position(new_robot_pos);
@@ -233,20 +248,79 @@ void Level::update(float elapsed_ms) {
 
     Hitbox new_robot_hitbox = m_robot.get_hitbox();
 
+    // every ghost reads its way to the robot off the same field, ghosts that lost
+    // their place get the answers to last update's requests
+    if (!m_ghosts.empty()) {
+        m_flow_field.set_goal(m_robot.get_position(), m_nav_channel);
+
+        // only the answers due now are taken, so when they arrive doesn't depend on the
+        // worker's timing. It has had a few updates for them and only holds this one up
+        // when it is that far behind, answers that came early wait for their update
+        m_path_service.wait(m_tick);
+        PathService::Result result;
+        while (m_path_service.collect(result)) {
+            m_path_results.push_back(result);
+        }
+        uint32_t tick = m_tick;
+        auto not_due = std::stable_partition(m_path_results.begin(), m_path_results.end(),
+            [tick](const PathService::Result& path) { return path.due <= tick; });
+        std::stable_sort(m_path_results.begin(), not_due,
+            [](const PathService::Result& a, const PathService::Result& b) { return a.client < b.client; });
+        for (auto path = m_path_results.begin(); path != not_due; ++path) {
+            m_ghosts[path->client]->take_path(*path);
+        }
+        m_path_results.erase(m_path_results.begin(), not_due);
+    }
+
+    // ghosts far from the robot update less often, or not at all while they can't chase
+    m_crowd_chasing.resize(m_ghosts.size());
+    m_crowd_moving.resize(m_ghosts.size());
+    for (size_t i = 0; i < m_ghosts.size(); i++) {
+        m_crowd_chasing[i] = m_ghosts[i]->is_chasing();
+        m_crowd_moving[i] = m_ghosts[i]->is_moving();
+    }
+    m_ghost_lod.schedule(m_crowd, m_robot.get_position(), m_crowd_chasing, m_crowd_moving, m_tick);
+
+    // each ghost only moves itself and reads the field, so they update in parallel
+    vec2 robot_position = m_robot.get_position();
+    get_job_system().parallel_for(m_ghosts.size(), GHOST_UPDATE_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            if (m_ghost_lod.is_due(i)) {
+                m_ghosts[i]->set_goal(robot_position);
+                m_ghosts[i]->update(m_ghost_lod.get_span(i, elapsed_ms));
+            }
+        }
+    });
     for (auto &ghost : m_ghosts) {
-        ghost->set_goal(m_robot.get_position());
-        ghost->update(elapsed_ms);
-        if (ghost->get_hitbox().collides_with(new_robot_hitbox)) {
-            sound_system->play_sound_effect(Sound_Effects::robot_hurt);
-            reset_level();
+        ghost->send_request(m_tick + PathService::ANSWER_TICKS);
+    }
+    m_path_service.flush();
+
+    // ghosts heading the same way are pushed apart in one pass before they move
+    m_crowd_positions.resize(m_ghosts.size());
+    for (size_t i = 0; i < m_ghosts.size(); i++) {
+        m_crowd_positions[i] = m_ghosts[i]->get_position();
+        m_crowd_moving[i] = m_ghosts[i]->is_moving();
+    }
+    m_crowd.build(m_crowd_positions);
+    m_crowd_pushes.resize(m_ghosts.size());
+    get_job_system().parallel_for(m_ghosts.size(), GHOST_UPDATE_GRAIN, [&](size_t begin, size_t end) {
+        m_crowd.separate(m_crowd_positions, m_crowd_moving, m_crowd_pushes, begin, end);
+    });
+    for (size_t i = 0; i < m_ghosts.size(); i++) {
+        if (m_crowd_moving[i]) {
+            m_ghosts[i]->push(m_crowd_pushes[i]);
         }
     }
 
-    for (auto &sign : m_signs) {
-        if (sign->get_hitbox().collides_with(new_robot_hitbox))
-            sign->show_text();
-        else
-            sign->hide_text();
+    // signs only say something when the robot walks in or out
+    m_signs_touched.resize(m_signs.size());
+    for (size_t i = 0; i < m_signs.size(); i++) {
+        bool touched = m_signs[i]->get_hitbox().collides_with(new_robot_hitbox);
+        if (touched != (m_signs_touched[i] != 0)) {
+            m_signs_touched[i] = touched;
+            m_events.triggers.emit({(int)i, touched});
+        }
     }
 
     const Hitbox robot_hitbox = m_robot.get_hitbox();
@@ -261,6 +335,61 @@ void Level::update(float elapsed_ms) {
             }
         }
     }
+
+    // ghosts have set where they are heading, move them all at once
+    get_world_context().motion_system.step(elapsed_ms);
+
+    // particles are only looked at, nothing the simulation decides reads them
+    ParticleSystem& particles = get_world_context().particles;
+    m_embers.update(elapsed_ms, m_torches, particles);
+    m_ghost_trails.update(elapsed_ms, m_ghosts, particles);
+    particles.update(elapsed_ms);
+
+    // only the ghosts hashed near the robot can have reached it
+    m_crowd.query(m_robot.get_position(), GHOST_REACH, m_nearby_ghosts);
+    for (int i : m_nearby_ghosts) {
+        if (m_ghosts[i]->get_hitbox().collides_with(new_robot_hitbox)) {
+            m_events.hurts.emit({i});
+            break;
+        }
+    }
+
+    // everything has moved, the rest of the game hears about it now
+    dispatch_events();
+
+    m_tick++;
+    // nothing is kept before the level is saved, there is nowhere to rewind to yet
+    size_t slot;
+    if (m_history.push(slot)) {
+        capture_snapshot(m_history.header(slot), m_history.ghosts(slot));
+    }
+}
+
+void Level::dispatch_events() {
+    Audio* audio = get_world_context().audio;
+
+    m_events.triggers.drain([this](const TriggerEvent& event) {
+        if (event.entered)
+            m_signs[event.trigger]->show_text();
+        else
+            m_signs[event.trigger]->hide_text();
+    });
+
+    m_events.collisions.drain([audio](const CollisionEvent& event) {
+        if (event.speed >= COLLISION_SOUND_MIN_VEL) {
+            audio->play_sound_effect(Sound_Effects::collision);
+        }
+    });
+
+    m_events.music.drain([audio](const MusicEvent& event) {
+        audio->play_bgm(event.music);
+    });
+
+    // resetting moves everything back, so it goes last
+    m_events.hurts.drain([this, audio](const HurtEvent&) {
+        audio->play_sound_effect(Sound_Effects::robot_hurt);
+        reset_level();
+    });
 }
 
 void Level::update_background(float elapsed_ms, vec2 pos_diff)
@@ -310,6 +439,7 @@ std::string Level::interact()
 
 bool Level::parse_level(std::string level, std::vector<std::string> unlocked, vec2 start_pos)
 {
+    WorldContext& world = get_world_context();
     m_level = level;
 
     // Construct file name with path
@@ -326,9 +456,20 @@ bool Level::parse_level(std::string level, std::vector<std::string> unlocked, ve
 
     // clear all level-dependent resources
     destroy();
+    m_world = &world;
 
-    // Parse the json
-    json j = json::parse(file);
+    world.particles.reserve(MAX_PARTICLES);
+    if (!m_particle_renderer.init()) {
+        fprintf(stderr, "Failed to initialize particles\n");
+    }
+    else if (has_gpu_particles() && !m_particle_renderer.init_gpu(MAX_PARTICLES)) {
+        fprintf(stderr, "GPU particles unavailable, simulating them on the CPU\n");
+    }
+    world.particles.set_gpu_simulated(m_particle_renderer.is_gpu_simulated());
+
+    // Parse the json, the text is kept to check the nav cache against
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    json j = json::parse(content);
 
     width = j["size"]["width"];
     height = j["size"]["height"];
@@ -336,8 +477,8 @@ bool Level::parse_level(std::string level, std::vector<std::string> unlocked, ve
     // Get ambient light level
     m_light.set_ambient(j["ambient_light"]);
 
-    // Get first entity in this group
-    int min = next_id;
+    // Collect the entities of this group in spawn order
+    world.entities.begin_batch();
 
 	// Spawn background
 	spawn_background();
@@ -387,47 +528,14 @@ bool Level::parse_level(std::string level, std::vector<std::string> unlocked, ve
 
     // Get the bricks
     fprintf(stderr, "	getting bricks\n");
-    std::vector<vec2> potential_cp;
-    std::vector<vec2> diffs = {{-1.f, -1.f},
-                               {1.f,  -1.f},
-                               {-1.f, 1.f},
-                               {1.f,  1.f}};
-
-    std::vector<bool> empty((int)width, false);
-    std::vector<std::vector<bool>> bricks((int)height, empty);
-    std::vector<std::vector<bool>> white_bricks((int)height, empty);
-    std::vector<std::vector<bool>> red_bricks((int)height, empty);
-    std::vector<std::vector<bool>> green_bricks((int)height, empty);
-    std::vector<std::vector<bool>> blue_bricks((int)height, empty);
+    NavLayout layout;
+    layout.reset((int)width, (int)height);
 
     for (json brick : j["bricks"]) {
         vec2 pos = {brick["pos"]["x"], brick["pos"]["y"]};
         vec3 colour = {brick["colour"]["r"], brick["colour"]["g"], brick["colour"]["b"]};
 
-        // Set brick here
-        bricks[(int)pos.y][(int)pos.x] = true;
-
-        if (colour.x == 1.f && colour.y == 1.f && colour.z == 1.f) {
-            white_bricks[(int)pos.y][(int)pos.x] = true;
-            red_bricks[(int)pos.y][(int)pos.x] = true;
-            green_bricks[(int)pos.y][(int)pos.x] = true;
-            blue_bricks[(int)pos.y][(int)pos.x] = true;
-        } else if (colour.x == 1.f && colour.y == 0.f && colour.z == 0.f) {
-            red_bricks[(int)pos.y][(int)pos.x] = true;
-        } else if (colour.x == 0.f && colour.y == 1.f && colour.z == 0.f) {
-            green_bricks[(int)pos.y][(int)pos.x] = true;
-        } else if (colour.x == 0.f && colour.y == 0.f && colour.z == 1.f) {
-            blue_bricks[(int)pos.y][(int)pos.x] = true;
-        }
-
-        // Add brick to critical points if not already cancelled
-        for (vec2 diff : diffs) {
-            vec2 pot = add(pos, diff);
-            if (pot.x >= 0.f && pot.x < width && pot.y >= 0.f && pot.y < height) {
-                potential_cp.push_back(pot);
-            }
-        }
-
+        layout.add_brick(pos, colour);
         spawn_brick(to_pixel_position(pos), colour);
     }
 
@@ -438,14 +546,22 @@ bool Level::parse_level(std::string level, std::vector<std::string> unlocked, ve
     // Generate the graph
     if (m_ghosts.size() > 0)
     {
-        m_white_graph.generate(potential_cp, white_bricks, (int)width, (int)height);
-        m_red_graph.generate(potential_cp, red_bricks, (int)width, (int)height);
-        m_green_graph.generate(potential_cp, green_bricks, (int)width, (int)height);
-        m_blue_graph.generate(potential_cp, blue_bricks, (int)width, (int)height);
+        uint64_t content_hash = hash_level_content(content);
+
+        if (!load_nav_cache(level, content_hash, m_graph, layout))
+        {
+            m_graph.generate(layout, get_job_system());
+            save_nav_cache(level, content_hash, m_graph);
+        }
+    }
+    m_flow_field.set_graph(&m_graph);
+    if (m_ghosts.size() > 0)
+    {
+        m_path_service.start(&m_graph);
     }
 
-    // Level graph initially set to be the default white
-    m_graph = &m_white_graph;
+    // Ghosts initially navigate the default white channel
+    m_nav_channel = NAV_WHITE;
 
     // Spawn the robot
     vec2 robot_pos = {j["spawn"]["pos"]["x"], j["spawn"]["pos"]["y"]};
@@ -458,13 +574,26 @@ bool Level::parse_level(std::string level, std::vector<std::string> unlocked, ve
 	}
     spawn_robot(to_pixel_position(robot_pos));
 
+    // The shadow maps of the levels the open doors lead to load a strip a frame while
+    // this one is played, the others are let go
+    std::vector<std::string> next_levels = { level };
+    for (auto& door : m_interactables) {
+        if (level != "level_select" || find(unlocked.begin(), unlocked.end(), door->get_destination()) != unlocked.end()) {
+            next_levels.push_back(door->get_destination());
+        }
+    }
+    Light::keep_brickmaps(next_levels);
+    for (size_t i = 1; i < next_levels.size(); i++) {
+        Light::preload(next_levels[i]);
+    }
+
 	for (auto& background : m_backgrounds) {
 		background->set_position(to_pixel_position(robot_pos));
 	}
 
     save_level();
 
-    m_rendering_system.process(min, next_id);
+    m_rendering_system.process(world.entities.end_batch());
 
 	m_has_colour_changed = true;
 
@@ -503,6 +632,10 @@ std::string Level::handle_key_press(int key, int action, std::unordered_map<int,
         return interact();
     }
 
+    if ((action == GLFW_PRESS || action == GLFW_REPEAT) && key == GLFW_KEY_R) {
+        rewind(REWIND_TICKS);
+    }
+
     // headlight toggle
     if (action == GLFW_PRESS && key == GLFW_KEY_1) {
         m_light.set_red_channel();
@@ -573,7 +706,7 @@ std::string Level::get_current_level()
 bool Level::spawn_door(vec2 position, std::string next_level)
 {
 	Door *door = new Door();
-	if (door->init(next_id++, position))
+	if (door->init(get_world_context().entities.create(), position))
 	{
 		door->set_destination(next_level);
 		m_interactables.push_back(door);
@@ -587,10 +720,12 @@ bool Level::spawn_ghost(vec2 position, vec3 colour)
 {
     Ghost *ghost = new Ghost();
     vec3 headlight_channel = m_light.get_headlight_channel();
-    if (ghost->init(next_id++, colour, headlight_channel))
+    if (ghost->init(get_world_context().entities.create(), colour, headlight_channel))
     {
         ghost->set_position(position);
-        ghost->set_level_graph(m_graph);
+        ghost->set_flow_field(&m_flow_field);
+        ghost->set_path_service(&m_path_service, (int)m_ghosts.size());
+        ghost->set_nav_channel(m_nav_channel);
         m_ghosts.push_back(ghost);
         return true;
     }
@@ -599,9 +734,8 @@ bool Level::spawn_ghost(vec2 position, vec3 colour)
 
 bool Level::spawn_robot(vec2 position)
 {
-    if (m_robot.init(next_id, true))
+    if (m_robot.init(get_world_context().entities.create(), true))
     {
-        next_id += 104;
         m_robot.set_position(position);
         m_robot.set_head_position(position);
         m_robot.set_shoulder_position(position);
@@ -616,7 +750,7 @@ bool Level::spawn_robot(vec2 position)
 
 bool Level::spawn_torch(vec2 position) {
     Torch *torch = new Torch();
-    if (torch->init(next_id++))
+    if (torch->init(get_world_context().entities.create()))
     {
         torch->set_position(position);
         m_torches.push_back(torch);
@@ -631,13 +765,11 @@ bool Level::spawn_background()
 	for (int i = 0; i < 4; i++) {
 		float scale = 0.25f * i + 0.25f;
 		Background* background = new Background();
-		if (!background->init(next_id++, scale, scale))
+		if (!background->init(get_world_context().entities.create(), scale, scale))
 		{
 			return false;
 		}
-		// background uses total of 3 components
 		m_backgrounds.push_back(background);
-		next_id += 2;
 	}
 	return true;
 }
@@ -645,9 +777,8 @@ bool Level::spawn_background()
 bool Level::spawn_sign(vec2 position, std::string text)
 {
     Sign *sign = new Sign();
-    if (sign->init(next_id, text, position))
+    if (sign->init(get_world_context().entities.create(), text, position))
     {
-        next_id += 2;
         m_signs.push_back(sign);
         return true;
     }
@@ -657,7 +788,7 @@ bool Level::spawn_sign(vec2 position, std::string text)
 
 bool Level::spawn_brick(vec2 position, vec3 colour) {
     Brick *brick = new Brick();
-    if (brick->init(next_id++, colour))
+    if (brick->init(get_world_context().entities.create(), colour))
     {
         brick->set_position(position);
         m_brick_map.insert({position, brick});
@@ -668,25 +799,105 @@ bool Level::spawn_brick(vec2 position, vec3 colour) {
 }
 
 void Level::save_level() {
-    reset_positions.clear();
-    reset_positions.push_back(m_robot.get_position());
-    for (auto ghost : m_ghosts) {
-        reset_positions.push_back(ghost->get_position());
-    }
+    m_tick = 0;
+    m_reset_ghosts.resize(m_ghosts.size());
+    capture_snapshot(m_reset_snapshot, m_reset_ghosts.data());
+    m_history.reset(HISTORY_LENGTH, m_ghosts.size());
 }
 
 void Level::reset_level() {
-    int pos_i = 0;
-    m_robot.set_position(reset_positions[pos_i++]);
-    for (auto &ghost : m_ghosts) {
-        ghost->set_position(reset_positions[pos_i++]);
+    restore_snapshot(m_reset_snapshot, m_reset_ghosts.data());
+    m_history.clear();
+}
+
+bool Level::rewind(unsigned ticks) {
+    if (m_history.size() == 0) {
+        return false;
+    }
+    // always keep the oldest snapshot around so holding rewind stops there
+    while (ticks > 0 && m_history.size() > 1) {
+        m_history.pop();
+        ticks--;
+    }
+    size_t slot = m_history.newest();
+    restore_snapshot(m_history.header(slot), m_history.ghosts(slot));
+    return true;
+}
+
+uint64_t Level::get_state_hash() {
+    LevelSnapshot snapshot;
+    std::vector<GhostState> ghosts(m_ghosts.size());
+    capture_snapshot(snapshot, ghosts.data());
+    return hash_snapshot(snapshot, ghosts.data());
+}
+
+uint32_t Level::get_tick() const {
+    return m_tick;
+}
+
+void Level::add_update_time(double seconds) {
+    m_ghost_lod.add_update_time(seconds);
+}
+
+void Level::capture_snapshot(LevelSnapshot& snapshot, GhostState* ghosts) {
+    snapshot.tick = m_tick;
+    snapshot.headlight_channel = m_light.get_headlight_channel();
+    snapshot.nav_channel = m_nav_channel;
+    m_robot.save_state(snapshot.robot);
+    m_flow_field.save_state(snapshot.flow_field);
+    snapshot.ghost_count = (uint32_t)m_ghosts.size();
+    for (size_t i = 0; i < m_ghosts.size(); i++) {
+        m_ghosts[i]->save_state(ghosts[i]);
+        ghosts[i].crowd_position = i < m_crowd.size() ? m_crowd.get_position((int)i) : ghosts[i].position;
+    }
+}
+
+void Level::restore_snapshot(const LevelSnapshot& snapshot, const GhostState* ghosts) {
+    m_tick = snapshot.tick;
+    // particles are purely visual, they are let go instead of saving every puff
+    get_world_context().particles.clear();
+    m_robot.load_state(snapshot.robot);
+    m_light.set_position(m_robot.get_head_position());
+
+    // answers on their way were asked for after the snapshot
+    m_path_service.wait();
+    PathService::Result stale;
+    while (m_path_service.collect(stale)) {}
+    m_path_results.clear();
+
+    // the fields go back first, ghosts waiting for a way onto one ask again
+    m_nav_channel = (uint8_t)snapshot.nav_channel;
+    m_flow_field.load_state(snapshot.flow_field);
+    size_t ghost_count = std::min((size_t)snapshot.ghost_count, m_ghosts.size());
+    m_crowd_positions.resize(m_ghosts.size());
+    for (size_t i = 0; i < m_ghosts.size(); i++) {
+        if (i < ghost_count) {
+            m_ghosts[i]->load_state(ghosts[i]);
+            m_crowd_positions[i] = ghosts[i].crowd_position;
+        } else {
+            m_crowd_positions[i] = m_ghosts[i]->get_position();
+        }
+    }
+
+    // the ghosts asked in their own order rather than by when the answers are due,
+    // rewinding already holds the game up so they are all answered now
+    m_path_service.wait();
+
+    // the next update finds which ghosts are in range where the crowd was
+    m_crowd.build(m_crowd_positions);
+
+    vec3 channel = m_light.get_headlight_channel();
+    vec3 saved = snapshot.headlight_channel;
+    if (channel.x != saved.x || channel.y != saved.y || channel.z != saved.z) {
+        m_light.set_headlight_channel(saved);
+        m_has_colour_changed = true;
     }
 }
 
 float Level::get_min_ghost_distance() {
     float min_ghost_dist = INFINITY;
     for(auto& ghost : m_ghosts) {
-        float dist = ghost->dist_from_goal();
+        float dist = len(sub(ghost->get_position(), m_robot.get_position()));
         if (dist < min_ghost_dist) {
             min_ghost_dist = dist;
         }
@@ -5,6 +5,10 @@
 #include "Robot/robot.hpp"
 #include "ghost.hpp"
 #include "level_graph.hpp"
+#include "flow_field.hpp"
+#include "path_service.hpp"
+#include "crowd_system.hpp"
+#include "ghost_lod.hpp"
 #include "Interactables/door.hpp"
 #include "light.hpp"
 #include "sign.hpp"
@@ -14,22 +18,40 @@
 #include "systems.hpp"
 #include "background.hpp"
 #include "torch.hpp"
-#include "sound_system.hpp"
+#include "snapshot.hpp"
+#include "render_snapshot.hpp"
+#include "world_context.hpp"
+#include "event_bus.hpp"
+#include "particle_emitters.hpp"
 
 class Level
 {
     public:
-    // Renders level
+    // Renders level as it was when snapshot was captured
     // projection is the 2D orthographic projection matrix
-	void draw_entities(const mat3& projection, const vec2& camera_shift);
-    void draw_light(const mat3& projection, const vec2& camera_shift);
+	void draw_entities(const mat3& projection, const vec2& camera_shift, const RenderSnapshot& snapshot);
+    void draw_light(const mat3& projection, const vec2& camera_shift, const RenderSnapshot& snapshot);
+
+    // Copies what drawing the level reads into snapshot, the camera is left to the caller
+    void capture_render_state(RenderSnapshot& snapshot) const;
 
     // Releases all level-associated resources
 	void destroy();
 
     // Update level entites, returns name of audio file to be played if something happens on update
+    // elapsed_ms is the fixed simulation step, the level never reads the clock itself
     void update(float elapsed_ms);
 
+    // Hash of the current simulation state, used to check that runs are reproducible
+    uint64_t get_state_hash();
+
+    // Number of updates since the level was loaded
+    uint32_t get_tick() const;
+
+    // Adds how long an update took, timed by the caller as the level never reads the
+    // clock. Only reported with the ghost tiers when the level is unloaded
+    void add_update_time(double seconds);
+
 	// Updates the background
 	void update_background(float elapsed_ms, vec2 pos_diff);
 
@@ -45,6 +67,15 @@ class Level
 	// Resets the level
 	void reset_level();
 
+	// Steps the level back by up to ticks updates, returns false if there is no history
+	bool rewind(unsigned ticks);
+
+	// Copies the state of the level into snapshot, ghosts needs room for every ghost
+	void capture_snapshot(LevelSnapshot& snapshot, GhostState* ghosts);
+
+	// Puts the level back into the state held in snapshot
+	void restore_snapshot(const LevelSnapshot& snapshot, const GhostState* ghosts);
+
 	// Generate a level from a text file
 	bool parse_level(std::string level, std::vector<std::string> unlocked, vec2 start_pos);
 
@@ -73,6 +104,10 @@ private:
 	bool spawn_background();
 	bool spawn_torch(vec2 position);
 
+	// Hands what the update emitted to the audio, the signs and the reset, the update's
+	// one sync point
+	void dispatch_events();
+
 	// get the closest ghost to the robot
 	float get_min_ghost_distance();
 	Music prev_bgm = Music::standard;
@@ -86,12 +121,21 @@ private:
 	std::string m_level;
 	float width, height;
 
+	// Context the level's entities were spawned in, bound while the level updates so
+	// it can be driven from any thread
+	WorldContext* m_world = nullptr;
+
 	// Systems
 	RenderingSystem m_rendering_system;
 
 	// Light effect
 	Light m_light;
 
+	// Draws the context's particles, the embers and trails the level adds to them
+	ParticleRenderer m_particle_renderer;
+	EmberEmitter m_embers;
+	GhostTrailEmitter m_ghost_trails;
+
 	// Data structure for unordered_map, using vec2 as key
 	struct vec2Hash {
 		std::size_t operator()(const vec2& v) const
@@ -111,16 +155,36 @@ private:
 
 	vec2 m_starting_camera_pos;
 
-    LevelGraph* m_graph;
-    LevelGraph m_white_graph;
-    LevelGraph m_red_graph;
-    LevelGraph m_green_graph;
-    LevelGraph m_blue_graph;
+    // One graph for every headlight channel, ghosts follow the edges of m_nav_channel
+    LevelGraph m_graph;
+    FlowField m_flow_field;
+    PathService m_path_service;
+    std::vector<PathService::Result> m_path_results; // answers collected before they are due
+    uint8_t m_nav_channel = NAV_WHITE;
+
+    // Ghosts by where they were this update, and the scratch for separating them and
+    // deciding which of them update
+    CrowdSystem m_crowd;
+    GhostLod m_ghost_lod;
+    std::vector<vec2> m_crowd_positions;
+    std::vector<uint8_t> m_crowd_chasing;
+    std::vector<uint8_t> m_crowd_moving;
+    std::vector<vec2> m_crowd_pushes;
+    std::vector<int> m_nearby_ghosts;
+
+    // Emitted while the level updates, drained at its end
+    EventBus m_events;
+    std::vector<uint8_t> m_signs_touched;
+
     Door* m_interactable;
 
     bool m_has_colour_changed = true;
 
-    std::vector<vec2> reset_positions;
+    // State the level is put back into on reset, and the recent history for rewinding
+    LevelSnapshot m_reset_snapshot;
+    std::vector<GhostState> m_reset_ghosts;
+    SnapshotRing m_history;
+    uint32_t m_tick = 0;
 
 	double m_scroll_amount = 0;
 	bool m_scroll_down = false;
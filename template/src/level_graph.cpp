@@ -1,289 +1,742 @@
 #include "level_graph.hpp"
-#include <queue>
+#include <functional>
+#include <atomic>
+#include <string.h>
 
-static int v_id = 0;
-
-CriticalPoint::CriticalPoint()
+namespace
 {
-}
+	// Per thread scratch space for searches, indexed by node with the start and
+	// goal after the graph nodes. An entry only counts if its stamp matches the
+	// current search, so nothing has to be cleared between searches.
+	struct PathSearch
+	{
+		// Gets ready for a search over node_count nodes
+		void begin(size_t node_count)
+		{
+			if (g.size() < node_count)
+			{
+				g.resize(node_count);
+				parent.resize(node_count);
+				goal_cost.resize(node_count);
+				opened.resize(node_count, 0);
+				closed.resize(node_count, 0);
+				sees_goal.resize(node_count, 0);
+			}
 
-CriticalPoint::CriticalPoint(vec2 loc)
-{
-	m_id = v_id++;
-	m_position = loc;
-	m_edges.clear();
-}
+			if (++stamp == 0)
+			{
+				std::fill(opened.begin(), opened.end(), 0);
+				std::fill(closed.begin(), closed.end(), 0);
+				std::fill(sees_goal.begin(), sees_goal.end(), 0);
+				stamp = 1;
+			}
 
-void CriticalPoint::add_edge(CriticalPoint* cp)
-{
-	m_edges.push_back(std::make_pair(len(sub(get_position(), cp->get_position())), cp));
-}
+			start_edges.clear();
+			heap.clear();
+		}
 
-void CriticalPoint::remove_edge(CriticalPoint* x)
-{
-	for (int i = 0; i < m_edges.size(); i++)
+		uint32_t stamp = 0;
+		std::vector<float> g;
+		std::vector<int> parent;
+		std::vector<float> goal_cost;
+		std::vector<uint32_t> opened;
+		std::vector<uint32_t> closed;
+		std::vector<uint32_t> sees_goal;
+		std::vector<std::pair<int, float>> start_edges;
+		std::vector<int> nearby;
+
+		// Min heap of (g + h, node)
+		std::vector<std::pair<float, int>> heap;
+	};
+
+	thread_local PathSearch t_search;
+
+	// Rows of the pair matrix handed to a thread at a time when generating
+	const int GENERATE_BLOCK_ROWS = 4;
+
+	// Critical points sorted by row then column, so duplicates end up next to each other
+	bool grid_order(vec2 a, vec2 b)
 	{
-		if (m_edges[i].second->get_id() == x->get_id())
-		{
-			m_edges.erase(m_edges.begin() + i);
-			return;
-		}
+		return a.y < b.y || (a.y == b.y && a.x < b.x);
 	}
+
+	bool same_point(vec2 a, vec2 b)
+	{
+		return a.x == b.x && a.y == b.y;
+	}
+
+	template <typename T>
+	void write_array(std::vector<char>& buffer, const std::vector<T>& values)
+	{
+		uint32_t count = (uint32_t)values.size();
+		const char* count_bytes = (const char*)&count;
+		buffer.insert(buffer.end(), count_bytes, count_bytes + sizeof(count));
+		const char* bytes = (const char*)values.data();
+		buffer.insert(buffer.end(), bytes, bytes + values.size() * sizeof(T));
+	}
+
+	template <typename T>
+	bool read_array(const char*& read, const char* end, std::vector<T>& values)
+	{
+		uint32_t count;
+		if ((size_t)(end - read) < sizeof(count))
+			return false;
+		memcpy(&count, read, sizeof(count));
+		read += sizeof(count);
+
+		if ((size_t)(end - read) / sizeof(T) < count)
+			return false;
+		values.resize(count);
+		memcpy(values.data(), read, count * sizeof(T));
+		read += count * sizeof(T);
+		return true;
+	}
+
+	const std::greater<std::pair<float, int>> HEAP_ORDER;
+
+	const float DIAGONAL_COST = 1.41421356f;
 }
 
-std::vector<Edge> CriticalPoint::get_edges()
+uint8_t nav_channel_of(vec3 colour)
 {
-	return m_edges;
+	if (colour.x == 1.f && colour.y == 1.f && colour.z == 1.f)
+		return NAV_WHITE;
+	if (colour.x == 1.f && colour.y == 0.f && colour.z == 0.f)
+		return NAV_RED;
+	if (colour.x == 0.f && colour.y == 1.f && colour.z == 0.f)
+		return NAV_GREEN;
+	if (colour.x == 0.f && colour.y == 0.f && colour.z == 1.f)
+		return NAV_BLUE;
+	return 0;
 }
 
-int CriticalPoint::get_id()
+uint8_t nav_blocked_by(vec3 colour)
 {
-	return m_id;
+	uint8_t channel = nav_channel_of(colour);
+	return channel == NAV_WHITE ? NAV_ALL_CHANNELS : channel;
 }
 
-vec2 CriticalPoint::get_position()
+void NavLayout::reset(int width, int height)
 {
-	return m_position;
+	this->width = width;
+	this->height = height;
+	critical_points.clear();
+	cells.assign(width * height, 0);
 }
 
-LevelGraph::LevelGraph()
+void NavLayout::add_brick(vec2 position, vec3 colour)
+{
+	int x = (int)position.x;
+	int y = (int)position.y;
+
+	// White bricks are solid whatever the headlight, coloured ones only in their channel
+	cells[y * width + x] |= nav_blocked_by(colour);
+
+	// Add the diagonals to the critical points, they are checked against the grid later
+	std::vector<vec2> diffs = { { -1.f, -1.f }, { 1.f, -1.f }, { -1.f, 1.f }, { 1.f, 1.f } };
+	for (vec2 diff : diffs) {
+		vec2 pot = add(position, diff);
+		if (pot.x >= 0.f && pot.x < width && pot.y >= 0.f && pot.y < height) {
+			critical_points.push_back(pot);
+		}
+	}
+}
+
+uint8_t NavLayout::blocked(int x, int y) const
 {
-	m_vertices.clear();
+	return cells[y * width + x];
 }
 
-static float h(CriticalPoint* u, vec2 goal)
+const int LevelGraph::TO_GOAL;
+const int LevelGraph::UNREACHABLE;
+const int LevelGraph::CLUSTERED_LEVEL_CELLS;
+
+LevelGraph::LevelGraph()
 {
-	return len(sub(u->get_position(), goal));
+	m_nodes.clear();
 }
 
-std::vector<vec2> LevelGraph::get_path(const vec2 start, const vec2 goal)
+std::vector<vec2> LevelGraph::get_path(const vec2 start, const vec2 goal, const uint8_t channel) const
 {
-	static vec2 s_goal = goal;
-	CriticalPoint start_node(start);
-	CriticalPoint goal_node(goal);
+	const int node_count = (int)m_nodes.size();
+	const int start_node = node_count;
+	const int goal_node = node_count + 1;
 
-	add_critical_point(&start_node);
-	add_critical_point(&goal_node);
+	PathSearch& search = t_search;
+	search.begin(node_count + 2);
+	const uint32_t stamp = search.stamp;
 
-	if (can_travel_between(start_node, goal_node))
+	// Connect the start and goal to what they can see nearby, outside of the graph
+	get_nearby_nodes(start, search.nearby);
+	for (int i : search.nearby)
+	{
+		if ((m_node_channels[i] & channel) && can_travel_between(start, m_nodes[i], channel))
+		{
+			search.start_edges.push_back(std::make_pair(i, len(sub(start, m_nodes[i]))));
+		}
+	}
+	get_nearby_nodes(goal, search.nearby);
+	for (int i : search.nearby)
+	{
+		if ((m_node_channels[i] & channel) && can_travel_between(goal, m_nodes[i], channel))
+		{
+			search.sees_goal[i] = stamp;
+			search.goal_cost[i] = len(sub(goal, m_nodes[i]));
+		}
+	}
+	if (can_travel_between(start, goal, channel))
 	{
-		start_node.add_edge(&goal_node);
-		goal_node.add_edge(&start_node);
+		search.start_edges.push_back(std::make_pair(goal_node, len(sub(start, goal))));
 	}
 
-	// We will use this a lot so simplify it
-	typedef std::pair<float, std::vector<CriticalPoint*>> elem;
+	auto position_of = [&](int node) {
+		return node == start_node ? start : (node == goal_node ? goal : m_nodes[node]);
+	};
 
-	// Make priority queue comparison function
-	struct ComparePath {
-		bool operator()(elem const& e1, elem const& e2)
-		{ 
-			return e1.first + h(e1.second.back(), s_goal)
-				> e2.first + h(e2.second.back(), s_goal);
+	auto relax = [&](int from, int to, float cost) {
+		if (search.closed[to] == stamp)
+		{
+			return;
 		}
-	};
 
-	// Initialize the queue
-	std::priority_queue<elem, std::vector<elem>, ComparePath> frontier;
+		float g = search.g[from] + cost;
+		if (search.opened[to] == stamp && g >= search.g[to])
+		{
+			return;
+		}
 
-	std::vector<CriticalPoint*> v;
-	v.push_back(&start_node);
-	elem n = std::make_pair(0.f, v);
-	frontier.push(n);
+		search.opened[to] = stamp;
+		search.g[to] = g;
+		search.parent[to] = from;
+		search.heap.push_back(std::make_pair(g + len(sub(position_of(to), goal)), to));
+		std::push_heap(search.heap.begin(), search.heap.end(), HEAP_ORDER);
+	};
 
-	float best_path_length = INFINITY;
-	std::vector<CriticalPoint*> best_path;
+	search.opened[start_node] = stamp;
+	search.g[start_node] = 0.f;
+	search.parent[start_node] = -1;
+	search.heap.push_back(std::make_pair(len(sub(start, goal)), start_node));
 
-	while (!frontier.empty())
-	{
-		elem element = frontier.top();
-		frontier.pop();
+	bool found = false;
 
-		CriticalPoint* cp = element.second.back();
+	while (!search.heap.empty())
+	{
+		std::pop_heap(search.heap.begin(), search.heap.end(), HEAP_ORDER);
+		int node = search.heap.back().second;
+		search.heap.pop_back();
 
-		if (element.first + h(cp, goal) > best_path_length)
+		// Stale heap entry, the node was reached more cheaply already
+		if (search.closed[node] == stamp)
 		{
 			continue;
 		}
+		search.closed[node] = stamp;
 
-		if (cp->get_id() == goal_node.get_id())
+		if (node == goal_node)
 		{
-			best_path_length = element.first;
-			best_path = element.second;
+			found = true;
+			break;
+		}
+
+		if (node == start_node)
+		{
+			for (auto& edge : search.start_edges)
+			{
+				relax(node, edge.first, edge.second);
+			}
 			continue;
 		}
 
-		for (auto& edge : cp->get_edges())
+		for (int e = m_edge_offsets[node]; e < m_edge_offsets[node + 1]; e++)
 		{
-			auto it = std::find(v.begin(), v.end(), edge.second);
-			if (it != v.end())
+			if (m_edges[e].channels & channel)
 			{
-				continue;
+				relax(node, m_edges[e].to, m_edges[e].cost);
 			}
+		}
 
-			v.push_back(edge.second);
-			std::vector<CriticalPoint*> n_v = element.second;
-			n_v.push_back(edge.second);
-			elem n_e = std::make_pair(element.first + edge.first, n_v);
-			frontier.push(n_e);
+		if (search.sees_goal[node] == stamp)
+		{
+			relax(node, goal_node, search.goal_cost[node]);
 		}
 	}
 
-	remove_critical_point(&start_node);
-	remove_critical_point(&goal_node);
+	if (!found)
+	{
+		// The start or goal may see no node, or the nodes they see may not join up
+		return get_cell_path(start, goal, channel);
+	}
 
 	std::vector<vec2> path;
-
-	for (int i = 0; i < best_path.size(); i++)
+	for (int node = goal_node; node != -1; node = search.parent[node])
 	{
-		path.push_back(best_path[i]->get_position());
+		path.push_back(position_of(node));
 	}
+	std::reverse(path.begin(), path.end());
 
 	return path;
 }
 
-bool LevelGraph::generate(std::vector<vec2> cps, std::vector<std::vector<bool>> data, int width, int height)
+std::vector<vec2> LevelGraph::get_cell_path(vec2 start, vec2 goal, uint8_t channel) const
 {
-	fprintf(stderr, "Generating graph\n");
-	m_vertices.clear();
-	m_data = data;
+	std::vector<vec2> path;
+	const int width = m_grid.get_width();
+	const int height = m_grid.get_height();
+
+	// Both ends slide to the centre of the cell they mostly overlap, which they are
+	// already partly in
+	vec2 start_cell = to_grid_position(start);
+	vec2 goal_cell = to_grid_position(goal);
+	int start_x = (int)floor(start_cell.x + 0.5f);
+	int start_y = (int)floor(start_cell.y + 0.5f);
+	int goal_x = (int)floor(goal_cell.x + 0.5f);
+	int goal_y = (int)floor(goal_cell.y + 0.5f);
+	if ((m_grid.blocked(start_x, start_y) & channel) || (m_grid.blocked(goal_x, goal_y) & channel))
+	{
+		return path;
+	}
 
-	int num_crits = 0;
-	int num_edges = 0;
+	auto centre = [&](int cell) { return to_pixel_position({ (float)(cell % width), (float)(cell / width) }); };
+	auto open = [&](int x, int y) { return !(m_grid.blocked(x, y) & channel); };
 
-	std::vector<vec2> diffs = { { -1.f, 0.f }, { 1.f, 0.f }, { 0.f, 1.f }, { 0.f, -1.f }, { 0.f, 0.f } };
+	const int first = start_y * width + start_x;
+	const int last = goal_y * width + goal_x;
+	if (!can_travel_between(start, centre(first), channel) || !can_travel_between(centre(last), goal, channel))
+	{
+		return path;
+	}
 
-	for (vec2 cp : cps)
+	// A* over the open cells, 8 way without cutting corners
+	PathSearch& search = t_search;
+	search.begin(width * height);
+	const uint32_t stamp = search.stamp;
+
+	auto estimate = [&](int cell) {
+		return len(sub({ (float)(cell % width), (float)(cell / width) }, { (float)goal_x, (float)goal_y }));
+	};
+
+	search.opened[first] = stamp;
+	search.g[first] = 0.f;
+	search.parent[first] = -1;
+	search.heap.push_back(std::make_pair(estimate(first), first));
+
+	bool found = false;
+	while (!search.heap.empty())
 	{
-		bool valid = true;
-		for (vec2 diff : diffs)
+		std::pop_heap(search.heap.begin(), search.heap.end(), HEAP_ORDER);
+		int cell = search.heap.back().second;
+		search.heap.pop_back();
+
+		if (search.closed[cell] == stamp)
 		{
-			vec2 pos = add(cp, diff);
-			if (pos.x >= 0.f && pos.x < width && pos.y >= 0.f && pos.y < height)
+			continue;
+		}
+		search.closed[cell] = stamp;
+
+		if (cell == last)
+		{
+			found = true;
+			break;
+		}
+
+		int x = cell % width;
+		int y = cell / width;
+		for (int dy = -1; dy <= 1; dy++)
+		{
+			for (int dx = -1; dx <= 1; dx++)
 			{
-				valid &= !data[(int)pos.y][(int)pos.x];
+				if ((dx == 0 && dy == 0) || !open(x + dx, y + dy))
+					continue;
+				if (dx != 0 && dy != 0 && (!open(x + dx, y) || !open(x, y + dy)))
+					continue;
+
+				int to = (y + dy) * width + x + dx;
+				float g = search.g[cell] + (dx != 0 && dy != 0 ? DIAGONAL_COST : 1.f);
+				if (search.closed[to] == stamp || (search.opened[to] == stamp && g >= search.g[to]))
+					continue;
+
+				search.opened[to] = stamp;
+				search.g[to] = g;
+				search.parent[to] = cell;
+				search.heap.push_back(std::make_pair(g + estimate(to), to));
+				std::push_heap(search.heap.begin(), search.heap.end(), HEAP_ORDER);
 			}
 		}
-		
-		if (valid)
+	}
+
+	if (!found)
+	{
+		return path;
+	}
+
+	std::vector<vec2> points(1, goal);
+	for (int cell = last; cell != -1; cell = search.parent[cell])
+	{
+		points.push_back(centre(cell));
+	}
+	points.push_back(start);
+	std::reverse(points.begin(), points.end());
+
+	// Pull the string, so ghosts don't step from cell to cell
+	path.push_back(start);
+	size_t anchor = 0;
+	for (size_t k = 2; k < points.size(); k++)
+	{
+		if (!can_travel_between(points[anchor], points[k], channel))
+		{
+			path.push_back(points[k - 1]);
+			anchor = k - 1;
+		}
+	}
+	path.push_back(goal);
+
+	return path;
+}
+
+void LevelGraph::flow_to(vec2 goal, uint8_t channel, std::vector<float>& distance, std::vector<int>& next) const
+{
+	const int node_count = (int)m_nodes.size();
+	distance.assign(node_count, INFINITY);
+	next.assign(node_count, UNREACHABLE);
+
+	// Min heap of (distance, node), stale entries are skipped when popped
+	std::vector<std::pair<float, int>> heap;
+
+	std::vector<int> nearby;
+	get_nearby_nodes(goal, nearby);
+	for (int i : nearby)
+	{
+		if ((m_node_channels[i] & channel) && can_travel_between(goal, m_nodes[i], channel))
 		{
-			CriticalPoint v(to_pixel_position(cp));
-			m_vertices.push_back(v);
-			num_crits++;
+			distance[i] = len(sub(goal, m_nodes[i]));
+			next[i] = TO_GOAL;
+			heap.push_back(std::make_pair(distance[i], i));
 		}
 	}
+	std::make_heap(heap.begin(), heap.end(), HEAP_ORDER);
 
-	for (int i = 0; i < m_vertices.size(); i++)
+	while (!heap.empty())
 	{
-		for (int j = i + 1; j < m_vertices.size(); j++)
+		std::pop_heap(heap.begin(), heap.end(), HEAP_ORDER);
+		float d = heap.back().first;
+		int node = heap.back().second;
+		heap.pop_back();
+
+		if (d > distance[node])
+		{
+			continue;
+		}
+
+		for (int e = m_edge_offsets[node]; e < m_edge_offsets[node + 1]; e++)
 		{
-			CriticalPoint* a = &m_vertices[i];
-			CriticalPoint* b = &m_vertices[j];
-			if (can_travel_between(*a, *b))
+			const Edge& edge = m_edges[e];
+			if ((edge.channels & channel) && d + edge.cost < distance[edge.to])
 			{
-				float distance = len(sub(a->get_position(), b->get_position()));
-				a->add_edge(b);
-				b->add_edge(a);
-				num_edges++;
+				distance[edge.to] = d + edge.cost;
+				next[edge.to] = node;
+				heap.push_back(std::make_pair(distance[edge.to], edge.to));
+				std::push_heap(heap.begin(), heap.end(), HEAP_ORDER);
 			}
 		}
 	}
+}
 
-	fprintf(stderr, "	generated graph with n=%d, m=%d\n", num_crits, num_edges);
-	return true;
+bool LevelGraph::can_see(vec2 a, vec2 b, uint8_t channel) const
+{
+	return can_travel_between(a, b, channel) != 0;
 }
 
-bool LevelGraph::can_travel_between(CriticalPoint a, CriticalPoint b)
+size_t LevelGraph::get_node_count() const
 {
-	vec2 start = to_grid_position(a.get_position());
-	vec2 finish = to_grid_position(b.get_position());
-	vec2 disp = sub(finish, start);
-	
-	if (abs(disp.x) > abs(disp.y))
+	return m_nodes.size();
+}
+
+size_t LevelGraph::get_edge_count() const
+{
+	return m_edges.size() / 2;
+}
+
+vec2 LevelGraph::get_node(int i) const
+{
+	return m_nodes[i];
+}
+
+void LevelGraph::get_nearby_nodes(vec2 position, std::vector<int>& nodes) const
+{
+	nodes.clear();
+	if (m_bucket_offsets.empty())
 	{
-		float xdist = 0.f;
-		float max = abs(disp.x);
-		float sign = disp.x / max;
+		return;
+	}
+
+	vec2 cell = to_grid_position(position);
+	int column = std::max(0, std::min(m_bucket_columns - 1, (int)floor(cell.x) / m_bucket_size));
+	int row = std::max(0, std::min(m_bucket_rows - 1, (int)floor(cell.y) / m_bucket_size));
 
-		while (xdist < abs(disp.x))
+	for (int r = std::max(0, row - 1); r <= std::min(m_bucket_rows - 1, row + 1); r++)
+	{
+		for (int c = std::max(0, column - 1); c <= std::min(m_bucket_columns - 1, column + 1); c++)
 		{
-			float xfirst = floor(xdist) + TOLERANCE;
-			float xlast = floor(xdist + 1.f + TOLERANCE) - TOLERANCE;
+			int bucket = r * m_bucket_columns + c;
+			nodes.insert(nodes.end(), m_bucket_nodes.begin() + m_bucket_offsets[bucket],
+				m_bucket_nodes.begin() + m_bucket_offsets[bucket + 1]);
+		}
+	}
+}
 
-			float yfirst = add(start, mul(disp, xfirst / max)).y;
-			float ylast = add(start, mul(disp, xlast / max)).y;
+void LevelGraph::index_nodes()
+{
+	int width = std::max(1, m_grid.get_width());
+	int height = std::max(1, m_grid.get_height());
+	m_bucket_size = width * height > CLUSTERED_LEVEL_CELLS ? ClusterGraph::CLUSTER_SIZE : std::max(width, height);
+	m_bucket_columns = (width + m_bucket_size - 1) / m_bucket_size;
+	m_bucket_rows = (height + m_bucket_size - 1) / m_bucket_size;
+
+	// Counting sort, so each bucket keeps its nodes in index order
+	std::vector<int> bucket_of(m_nodes.size());
+	m_bucket_offsets.assign(m_bucket_columns * m_bucket_rows + 1, 0);
+	for (size_t i = 0; i < m_nodes.size(); i++)
+	{
+		vec2 cell = to_grid_position(m_nodes[i]);
+		int column = std::max(0, std::min(m_bucket_columns - 1, (int)floor(cell.x) / m_bucket_size));
+		int row = std::max(0, std::min(m_bucket_rows - 1, (int)floor(cell.y) / m_bucket_size));
+		bucket_of[i] = row * m_bucket_columns + column;
+		m_bucket_offsets[bucket_of[i] + 1]++;
+	}
+	for (size_t b = 1; b < m_bucket_offsets.size(); b++)
+	{
+		m_bucket_offsets[b] += m_bucket_offsets[b - 1];
+	}
 
-			if (m_data[(int)floor(yfirst + 1.f - TOLERANCE)][(int)floor(start.x + sign * xfirst)] ||
-				m_data[(int)floor(yfirst       + TOLERANCE)][(int)floor(start.x + sign * xfirst)] ||
-				m_data[(int)floor(ylast  + 1.f - TOLERANCE)][(int)floor(start.x + sign * xlast)] ||
-				m_data[(int)floor(ylast        + TOLERANCE)][(int)floor(start.x + sign * xlast)])
-			{
-				return false;
-			}
+	m_bucket_nodes.resize(m_nodes.size());
+	std::vector<int> fill(m_bucket_offsets.begin(), m_bucket_offsets.end() - 1);
+	for (size_t i = 0; i < m_nodes.size(); i++)
+	{
+		m_bucket_nodes[fill[bucket_of[i]]++] = (int)i;
+	}
+}
 
-			float remaining = max - xdist;
-			if (remaining - floor(remaining) > TOLERANCE)
-				xdist += remaining - floor(remaining);
-			else
-				xdist++;
-		}
+void LevelGraph::set_layout(const NavLayout& layout)
+{
+	m_grid.build(layout);
+	m_nodes.clear();
+	m_node_channels.clear();
+	m_edge_offsets.assign(1, 0);
+	m_edges.clear();
+	index_nodes();
+}
 
-		return true;
+void LevelGraph::set_blocked(int x, int y, uint8_t blocked)
+{
+	m_grid.set_cell(x, y, blocked);
+}
+
+void LevelGraph::set_edges(const std::vector<vec2>& nodes, const std::vector<uint8_t>& node_channels,
+	const std::vector<NodePair>& pairs)
+{
+	m_nodes = nodes;
+	m_node_channels = node_channels;
+	connect(std::vector<std::vector<NodePair>>(1, pairs));
+	index_nodes();
+}
+
+const OccupancyGrid& LevelGraph::get_grid() const
+{
+	return m_grid;
+}
+
+void LevelGraph::serialise(std::vector<char>& buffer) const
+{
+	write_array(buffer, m_nodes);
+	write_array(buffer, m_node_channels);
+	write_array(buffer, m_edge_offsets);
+	write_array(buffer, m_edges);
+}
+
+bool LevelGraph::deserialise(const char*& read, const char* end, const NavLayout& layout)
+{
+	if (!read_array(read, end, m_nodes) || !read_array(read, end, m_node_channels) ||
+		!read_array(read, end, m_edge_offsets) || !read_array(read, end, m_edges))
+	{
+		return false;
+	}
+
+	// Make sure every edge stays inside the graph before trusting it
+	if (m_node_channels.size() != m_nodes.size() || m_edge_offsets.size() != m_nodes.size() + 1 ||
+		m_edge_offsets.front() != 0 || m_edge_offsets.back() != (int)m_edges.size())
+	{
+		return false;
+	}
+	for (size_t i = 0; i < m_nodes.size(); i++)
+	{
+		if (m_edge_offsets[i] > m_edge_offsets[i + 1])
+			return false;
 	}
-	else
+	for (const Edge& edge : m_edges)
 	{
-		float ydist = 0.f;
-		float max = abs(disp.y);
-		float sign = disp.y / max;
+		if (edge.to < 0 || edge.to >= (int)m_nodes.size())
+			return false;
+	}
 
-		while (ydist < abs(disp.y))
-		{
-			float yfirst = floor(ydist) + TOLERANCE;
-			float ylast = floor(ydist + 1.f + TOLERANCE) - TOLERANCE;
+	m_grid.build(layout);
+	index_nodes();
+	return true;
+}
+
+void LevelGraph::generate(const NavLayout& layout, JobSystem& jobs)
+{
+	fprintf(stderr, "Generating graph\n");
+
+	m_grid.build(layout);
+
+	if (layout.width * layout.height > CLUSTERED_LEVEL_CELLS)
+	{
+		generate_clustered(jobs);
+		index_nodes();
+		fprintf(stderr, "	generated clustered graph with n=%d, m=%d\n", (int)get_node_count(), (int)get_edge_count());
+		return;
+	}
+
+	// Every brick adds its four diagonals, so neighbouring bricks add the same points
+	std::vector<vec2> cps = layout.critical_points;
+	std::sort(cps.begin(), cps.end(), grid_order);
+	cps.erase(std::unique(cps.begin(), cps.end(), same_point), cps.end());
+
+	place_nodes(cps);
+
+	// One task per worker, pairs[t] are the edges found by task t.
+	// Early rows test more pairs, so the tasks take blocks in turn rather than a share each
+	std::vector<std::vector<NodePair>> pairs(jobs.size());
+	const int node_count = (int)m_nodes.size();
+	const int block_count = (node_count + GENERATE_BLOCK_ROWS - 1) / GENERATE_BLOCK_ROWS;
 
-			float xfirst = add(start, mul(disp, yfirst / max)).x;
-			float xlast = add(start, mul(disp, ylast / max)).x;
+	std::atomic<int> next_block(0);
+	auto find_pairs = [&](size_t task) {
+		for (int b = next_block++; b < block_count; b = next_block++)
+		{
+			int first = b * GENERATE_BLOCK_ROWS;
+			int last = std::min(node_count, first + GENERATE_BLOCK_ROWS);
 
-			if (m_data[(int)floor(start.y + sign * yfirst)][(int)floor(xfirst + 1.f - TOLERANCE)] ||
-				m_data[(int)floor(start.y + sign * yfirst)][(int)floor(xfirst       + TOLERANCE)] ||
-				m_data[(int)floor(start.y + sign * ylast)] [(int)floor(xlast  + 1.f - TOLERANCE)] ||
-				m_data[(int)floor(start.y + sign * ylast)] [(int)floor(xlast        + TOLERANCE)])
+			for (int i = first; i < last; i++)
 			{
-				return false;
+				for (int j = i + 1; j < node_count; j++)
+				{
+					uint8_t channels = m_node_channels[i] & m_node_channels[j];
+					if (channels)
+					{
+						channels = can_travel_between(m_nodes[i], m_nodes[j], channels);
+					}
+					if (channels)
+					{
+						pairs[task].push_back({ i, j, channels });
+					}
+				}
 			}
-
-			float remaining = max - ydist;
-			if (remaining - floor(remaining) > TOLERANCE)
-				ydist += remaining - floor(remaining);
-			else
-				ydist++;
 		}
+	};
 
-		return true;
+	std::vector<JobSystem::Handle> tasks;
+	for (size_t task = 0; task < pairs.size(); task++)
+	{
+		tasks.push_back(jobs.submit([&find_pairs, task]() { find_pairs(task); }));
+	}
+	for (const JobSystem::Handle& task : tasks)
+	{
+		jobs.wait(task);
+	}
+
+	connect(pairs);
+	index_nodes();
+	fprintf(stderr, "	generated graph with n=%d, m=%d\n", (int)get_node_count(), (int)get_edge_count());
+}
+
+void LevelGraph::generate_clustered(JobSystem& jobs)
+{
+	ClusterGraph clusters;
+	clusters.build(m_grid, jobs);
+
+	m_nodes.clear();
+	for (vec2 node : clusters.get_nodes())
+	{
+		m_nodes.push_back(to_pixel_position(node));
 	}
+	m_node_channels = clusters.get_node_channels();
 
-	return false;
+	std::vector<std::vector<NodePair>> pairs(1);
+	for (const ClusterGraph::Link& link : clusters.get_links())
+	{
+		pairs[0].push_back({ link.first, link.second, link.channels });
+	}
+	connect(pairs);
 }
 
-void LevelGraph::add_critical_point(CriticalPoint* cp)
+void LevelGraph::place_nodes(const std::vector<vec2>& cps)
 {
-	vec2 pos = cp->get_position();
+	m_nodes.clear();
+	m_node_channels.clear();
+
+	std::vector<vec2> diffs = { { -1.f, 0.f }, { 1.f, 0.f }, { 0.f, 1.f }, { 0.f, -1.f }, { 0.f, 0.f } };
 
-	for (auto& v : m_vertices)
+	for (vec2 cp : cps)
 	{
-		if (can_travel_between(*cp, v))
+		uint8_t channels = NAV_ALL_CHANNELS;
+		for (vec2 diff : diffs)
+		{
+			vec2 pos = add(cp, diff);
+			if (pos.x >= 0.f && pos.x < m_grid.get_width() && pos.y >= 0.f && pos.y < m_grid.get_height())
+			{
+				channels &= ~m_grid.blocked((int)pos.x, (int)pos.y);
+			}
+		}
+		
+		if (channels)
 		{
-			cp->add_edge(&v);
-			v.add_edge(cp);
+			m_nodes.push_back(to_pixel_position(cp));
+			m_node_channels.push_back(channels);
 		}
 	}
 }
 
-void LevelGraph::remove_critical_point(CriticalPoint* cp)
+void LevelGraph::connect(const std::vector<std::vector<NodePair>>& pairs)
 {
-	for (auto& e : cp->get_edges())
+	// Count the edges of each node first so they can be placed straight into their slots
+	std::vector<int> degree(m_nodes.size(), 0);
+	for (auto& found : pairs)
+	{
+		for (auto& pair : found)
+		{
+			degree[pair.first]++;
+			degree[pair.second]++;
+		}
+	}
+
+	m_edge_offsets.assign(m_nodes.size() + 1, 0);
+	for (size_t i = 0; i < m_nodes.size(); i++)
+	{
+		m_edge_offsets[i + 1] = m_edge_offsets[i] + degree[i];
+	}
+
+	m_edges.resize(m_edge_offsets.back());
+	std::vector<int> fill(m_edge_offsets.begin(), m_edge_offsets.end() - 1);
+	for (auto& found : pairs)
+	{
+		for (auto& pair : found)
+		{
+			float distance = len(sub(m_nodes[pair.first], m_nodes[pair.second]));
+			m_edges[fill[pair.first]++] = { pair.second, distance, pair.channels };
+			m_edges[fill[pair.second]++] = { pair.first, distance, pair.channels };
+		}
+	}
+
+	// Threads find edges in any order, sorting makes the graph the same for any thread count
+	for (size_t i = 0; i < m_nodes.size(); i++)
 	{
-		CriticalPoint* v = e.second;
-		v->remove_edge(cp);
+		std::sort(m_edges.begin() + m_edge_offsets[i], m_edges.begin() + m_edge_offsets[i + 1],
+			[](const Edge& a, const Edge& b) { return a.to < b.to; });
 	}
 }
+
+uint8_t LevelGraph::can_travel_between(vec2 a, vec2 b, uint8_t channels) const
+{
+	return m_grid.clear_channels(a, b, channels);
+}
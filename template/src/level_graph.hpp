@@ -4,102 +4,197 @@ When parsing a level, generate a graph:
 	1. Based on the level data, generate a node for each critical point.
 	2. For each pair of nodes, connect them with an edge if it is 
 	   possible to travel straight between them without causing any 
-	   collisions. We check this by incrementally moving along the path
-	   and testing that our outer edges are not colliding with any 
-	   bricks.
+	   collisions. We check this exactly on a bit-packed occupancy grid,
+	   visiting the cells the ghost's box sweeps over (see
+	   occupancy_grid.hpp).
 	3. Save this graph.
 
-Then whenever we need to find a path between some start position and 
-end position:
+Ghosts chasing the robot don't search for paths of their own. flow_to
+runs Dijkstra outwards from the robot, giving every node its next step
+towards it, and a FlowField keeps that per headlight channel until the
+robot drifts too far from where it was built (see flow_field.hpp).
 
-	1. If either we do not currently have a path to follow or if the 
-	   robot has moved enough from its position when we last generated 
-	   a path, generate a path to the robot.
-	2. Create nodes at the start and end positions and add them to the 
-	   graph, connecting them with other nodes by the same logic as 
-	   before.
-	3. Run A* path finding using a priority queue starting at the start
-	   position searching for the end position. Return the result.
+Then each ghost follows the field on each update by:
 
-Then we use this path on each update by:
-
-	1. Setting some distance that we would like our ghost to move per 
+	1. Connecting its position to the nodes it can see, by the same 
+	   logic as before, and taking the one with the shortest way to the 
+	   robot as its target. This is only done when it has lost its 
+	   place, and the connections are never added to the graph, so the 
+	   graph is never modified after it is generated and can be read 
+	   from several threads at once.
+	2. Setting some distance that we would like our ghost to move per 
 	   update.
-	2. If the distance to the next element on the path is greater than 
-	   what we are allowed to move, moving our full allowance in 
-	   towards that node.
-	3. Otherwise, moving completely to that node, decreasing our 
-	   allowed movement by the distance we just moved, and looping back
-	   to step 2.
+	3. If the distance to its target is greater than what we are 
+	   allowed to move, moving our full allowance towards it.
+	4. Otherwise, moving completely to the target, decreasing our 
+	   allowed movement by the distance we just moved, taking the 
+	   target's next step from the field and looping back to step 3.
+
+get_path still answers a single path with A* over node indices for 
+anything that needs one outside the field.
 
 ******************************************************************/
 
 #pragma once
 
 #include "common.hpp"
+#include "job_system.hpp"
+#include "occupancy_grid.hpp"
+#include "cluster_graph.hpp"
 #include <vector>
 #include <string>
-#include <map>
 #include <utility>
-#include <SDL.h>
-#undef main
 #include <algorithm>
 #include <math.h>
 
+// Headlight channels as bits. Bricks block channels, nodes and edges carry the
+// channels they can be used in, so one graph serves every headlight colour.
+static const uint8_t NAV_WHITE = 1;
+static const uint8_t NAV_RED = 2;
+static const uint8_t NAV_GREEN = 4;
+static const uint8_t NAV_BLUE = 8;
+static const uint8_t NAV_ALL_CHANNELS = NAV_WHITE | NAV_RED | NAV_GREEN | NAV_BLUE;
 
-class CriticalPoint;
+// Channel bit of a headlight colour, 0 if it is not one of the four channels
+uint8_t nav_channel_of(vec3 colour);
 
-typedef std::pair<float, CriticalPoint*>  Edge;
+// Channels a brick of colour blocks, a white brick blocks all of them
+uint8_t nav_blocked_by(vec3 colour);
 
-class CriticalPoint
+// Brick grid of a level, each cell holding the channels it is blocked in, plus the
+// candidate critical points (the diagonals of every brick). Filled in one brick at
+// a time while a level is parsed
+struct NavLayout
 {
-public:
-	// Constructors
-	CriticalPoint();
-	CriticalPoint(vec2 loc);
-
-	// Adds an edge
-	void add_edge(CriticalPoint* cp);
+	// Empties the grid and sizes it for a width x height level
+	void reset(int width, int height);
 
-	// Removes an edge
-	void remove_edge(CriticalPoint* x);
+	// Adds a brick at a grid position
+	void add_brick(vec2 position, vec3 colour);
 
-	// Gets the edges connected to this vertex
-	std::vector<Edge> get_edges();
+	// Channels the cell at x, y is blocked in
+	uint8_t blocked(int x, int y) const;
 
-	// Gets this vertex's id
-	int get_id();
-
-	// Gets position
-	vec2 get_position();
-
-private:
-	int m_id;
-	vec2 m_position;
-	std::vector<Edge> m_edges;
+	int width = 0;
+	int height = 0;
+	std::vector<vec2> critical_points;
+	std::vector<uint8_t> cells;
 };
 
 class LevelGraph
 {
 public:
+	// Next steps written by flow_to for nodes that see the goal and nodes that can't reach it
+	static const int TO_GOAL = -1;
+	static const int UNREACHABLE = -2;
+
+	// Levels with more cells than this get a ClusterGraph instead of a node per
+	// critical point, whose edges take O(V^2) line tests to find
+	static const int CLUSTERED_LEVEL_CELLS = 128 * 128;
+
 	// Constructor
 	LevelGraph();
 
-	// Given a string with map data, generates a graph
-	bool generate(std::vector<vec2> cps, std::vector<std::vector<bool>> data, int width, int height);
+	// Generates the graph of a level. The pair tests are split into row blocks that
+	// the workers of jobs take in turn, each test checks all four channels at once
+	void generate(const NavLayout& layout, JobSystem& jobs);
+
+	// Gets shortest path from start to goal for the headlight channel, including both,
+	// empty if there is none. Uses A* search on level graph, and on the cells when the
+	// graph can't join them. Never modifies the graph so it is safe to call from
+	// several threads at once
+	std::vector<vec2> get_path(vec2 start, vec2 goal, uint8_t channel) const;
+
+	// Dijkstra from goal over the edges of the channel. For every node, distance is the
+	// length of its shortest path to goal and next the node to go to from it, TO_GOAL
+	// or UNREACHABLE
+	void flow_to(vec2 goal, uint8_t channel, std::vector<float>& distance, std::vector<int>& next) const;
+
+	// Whether an object can travel straight between two pixel positions in the channel
+	bool can_see(vec2 a, vec2 b, uint8_t channel) const;
+
+	size_t get_node_count() const;
+	size_t get_edge_count() const;
+
+	// Pixel position of node i
+	vec2 get_node(int i) const;
 
-	// Gets shortest path from start to goal
-	// Uses A* search on level graph
-	std::vector<vec2> get_path(vec2 start, vec2 goal);
+	// Replaces nodes with the nodes that a search from position should try to connect
+	// to: all of them on a small level, those in the surrounding clusters on a large one
+	void get_nearby_nodes(vec2 position, std::vector<int>& nodes) const;
+
+	// A pair of nodes and the channels an object can travel straight between them in,
+	// first < second
+	struct NodePair
+	{
+		int first;
+		int second;
+		uint8_t channels;
+	};
+
+	// Takes the bricks of layout and leaves the graph empty, for a GraphEditor to
+	// fill in with set_edges
+	void set_layout(const NavLayout& layout);
+
+	// Changes the channels cell x, y is blocked in without touching nodes or edges
+	void set_blocked(int x, int y, uint8_t blocked);
+
+	// Replaces the nodes, given as pixel positions, and the edges between them
+	void set_edges(const std::vector<vec2>& nodes, const std::vector<uint8_t>& node_channels,
+		const std::vector<NodePair>& pairs);
+
+	const OccupancyGrid& get_grid() const;
+
+	// Appends the nodes and edges to buffer, the grid is left out
+	void serialise(std::vector<char>& buffer) const;
+
+	// Reads back a graph written by serialise, layout is the level it was generated from.
+	// Moves read past the graph, returns false if the bytes don't hold a whole graph
+	bool deserialise(const char*& read, const char* end, const NavLayout& layout);
 
 private:
-	std::vector<CriticalPoint> m_vertices;
-	std::vector<std::vector<bool>> m_data;
+	struct Edge
+	{
+		int to;
+		float cost;
+		uint32_t channels;
+	};
+
+	// Node positions in pixels and the channels each node is clear in
+	std::vector<vec2> m_nodes;
+	std::vector<uint8_t> m_node_channels;
+
+	// The edges of node i are m_edges[m_edge_offsets[i]] up to m_edges[m_edge_offsets[i + 1]]
+	std::vector<int> m_edge_offsets;
+	std::vector<Edge> m_edges;
+
+	OccupancyGrid m_grid;
+
+	// Node indices bucketed by the cell they are in, m_bucket_size cells square.
+	// Bucket b holds m_bucket_nodes[m_bucket_offsets[b]] up to m_bucket_offsets[b + 1]
+	int m_bucket_size = 1;
+	int m_bucket_columns = 0;
+	int m_bucket_rows = 0;
+	std::vector<int> m_bucket_offsets;
+	std::vector<int> m_bucket_nodes;
+
+	// Sorts the nodes into buckets, one for the whole of a small level
+	void index_nodes();
+
+	// Builds the nodes and edges of a large level from a ClusterGraph
+	void generate_clustered(JobSystem& jobs);
+
+	// A* over the open cells of the grid, pulled straight. Slower than the graph but
+	// finds every path, used when a start or goal can't see a node that leads on
+	std::vector<vec2> get_cell_path(vec2 start, vec2 goal, uint8_t channel) const;
+
+	// Returns the ones of channels in which an object can travel between two pixel
+	// positions with no collisions
+	uint8_t can_travel_between(vec2 a, vec2 b, uint8_t channels) const;
 
-	// Test if object can travel between two positions with no collisions
-	bool can_travel_between(CriticalPoint a, CriticalPoint b);
+	// Keeps the critical points that are clear of bricks in some channel as nodes
+	void place_nodes(const std::vector<vec2>& cps);
 
-	// Temporary modification
-	void add_critical_point(CriticalPoint* cp);
-	void remove_critical_point(CriticalPoint* cp);
+	// Builds the edges from node pairs found by each worker, first < second in every pair
+	void connect(const std::vector<std::vector<NodePair>>& pairs);
 };
@@ -1,10 +1,23 @@
 #include "light.hpp"
 #include "torch.hpp"
+#include "frame_scheduler.hpp"
+#include "world_context.hpp"
 #include <math.h>
 #include <iostream>
 #include <string>
+#include <algorithm>
+#include <memory>
 
-std::map<std::string, Texture> Light::brickmap_textures;
+namespace
+{
+    const float PRELOAD_STEP_MS = 2.f; // first guess at a step of a shadow map load
+
+    std::string brickmap_path(const std::string& level)
+    {
+        std::string path = shadow_path;
+        return path.append(level).append("_brickmap.bmp");
+    }
+}
 
 bool Light::init(std::string level) {
     // Since we are not going to apply transformation to this screen geometry
@@ -19,26 +32,42 @@ bool Light::init(std::string level) {
             1.05f,  1.05f, 0.0f,
     };
 
-    // Clearing errors
-    gl_flush_errors();
+    if (has_renderer())
+    {
+        // Clearing errors
+        gl_flush_errors();
 
-    // Vertex Buffer creation
-    glGenBuffers(1, &mesh.vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(screen_vertex_buffer_data), screen_vertex_buffer_data, GL_STATIC_DRAW);
+        // Vertex Buffer creation
+        glGenBuffers(1, &mesh.vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(screen_vertex_buffer_data), screen_vertex_buffer_data, GL_STATIC_DRAW);
 
-    if (gl_has_errors())
-        return false;
+        if (gl_has_errors())
+            return false;
+    }
 
     // Loading shaders
     if (!effect.load_from_file(shader_path("light.vs.glsl"), shader_path("light.fs.glsl")))
         return false;
 
-	if (brickmap_textures.find(level) == brickmap_textures.end()
-		|| !brickmap_textures[level].is_valid())
+    WorldContext& world = get_world_context();
+    std::map<std::string, Texture>& brickmap_textures = world.brickmaps;
+    std::map<std::string, int>& preload_tasks = world.brickmap_preloads;
+
+    // The rest of a preload is needed now
+    auto preloading = preload_tasks.find(level);
+    if (preloading != preload_tasks.end())
+    {
+        int task = preloading->second;
+        s_frame_scheduler.finish(task);
+        preload_tasks.erase(level);
+    }
+
+	// Shadow maps are only drawn, without a renderer there is nothing to load
+	if (has_renderer() && (brickmap_textures.find(level) == brickmap_textures.end()
+		|| !brickmap_textures[level].is_valid()))
 	{
-		std::string path = shadow_path;
-		path = path.append(level).append("_brickmap.bmp");
+		std::string path = brickmap_path(level);
 		if (!brickmap_textures[level].load_from_file(path.c_str()))
 		{
 			fprintf(stderr, "Failed to load brickmap texture!");
@@ -47,6 +76,7 @@ bool Light::init(std::string level) {
 	}
 
     m_headlight_channel = {1.f, 1.f, 1.f};
+    motion.radians = 0.f;
 	rc.texture = &brickmap_textures[level];
 
 	if (!rc.init_sprite())
@@ -58,14 +88,8 @@ bool Light::init(std::string level) {
 // Releases all graphics resources
 void Light::destroy() 
 {
-	for (const auto& it : brickmap_textures)
-	{
-		Texture t = it.second;
-		if (t.id != 0) glDeleteTextures(1, &t.id);
-		if (t.depth_render_buffer_id != 0) glDeleteRenderbuffers(1, &t.depth_render_buffer_id);	
-	}
-
-	brickmap_textures.clear();
+    if (!has_renderer())
+        return;
 
     glDeleteBuffers(1, &mesh.vbo);
 
@@ -74,6 +98,67 @@ void Light::destroy()
     glDeleteShader(effect.program);
 }
 
+void Light::preload(const std::string& level)
+{
+	// Shadow maps are only drawn
+	if (!has_renderer())
+	{
+		return;
+	}
+
+	WorldContext& world = get_world_context();
+	std::map<std::string, Texture>& brickmap_textures = world.brickmaps;
+	std::map<std::string, int>& preload_tasks = world.brickmap_preloads;
+
+	auto loaded = brickmap_textures.find(level);
+	if (preload_tasks.count(level) != 0 || (loaded != brickmap_textures.end() && loaded->second.is_valid()))
+	{
+		return;
+	}
+
+	// Doors can lead to screens that aren't levels
+	std::string path = brickmap_path(level);
+	if (!std::ifstream(path).good())
+	{
+		return;
+	}
+
+	std::shared_ptr<TextureLoad> load = std::make_shared<TextureLoad>(&brickmap_textures[level], path);
+	preload_tasks[level] = s_frame_scheduler.add("shadow map of " + level, PRELOAD_STEP_MS, [load, level, &preload_tasks]()
+	{
+		bool done = load->step();
+		if (done)
+		{
+			preload_tasks.erase(level);
+		}
+		return done;
+	});
+}
+
+void Light::keep_brickmaps(const std::vector<std::string>& levels)
+{
+	WorldContext& world = get_world_context();
+	std::map<std::string, Texture>& brickmap_textures = world.brickmaps;
+	std::map<std::string, int>& preload_tasks = world.brickmap_preloads;
+
+	for (auto it = brickmap_textures.begin(); it != brickmap_textures.end();)
+	{
+		if (std::find(levels.begin(), levels.end(), it->first) != levels.end())
+		{
+			++it;
+			continue;
+		}
+
+		auto preloading = preload_tasks.find(it->first);
+		if (preloading != preload_tasks.end())
+		{
+			s_frame_scheduler.cancel(preloading->second);
+			preload_tasks.erase(preloading);
+		}
+		it = brickmap_textures.erase(it);
+	}
+}
+
 // pos is the robot pos
 // todo: in the future, light will be slightly above robot,
 // and there might be other lights that are not headlights
@@ -123,6 +208,10 @@ vec3 Light::get_headlight_channel(){
     return m_headlight_channel;
 }
 
+void Light::set_headlight_channel(vec3 channel){
+    m_headlight_channel = channel;
+}
+
 void Light::set_red_channel(){
     if  (isRed(m_headlight_channel)) {
         m_headlight_channel = {1.f, 1.f, 1.f};
@@ -171,7 +260,8 @@ void Light::set_prev_light_channel() {
     }
 }
 
-void Light::draw(const mat3& projection, const vec2& camera_shift, const vec2& size, std::vector<Torch*> torches){
+void Light::draw(const mat3& projection, const vec2& camera_shift, const vec2& size, const LightState& state,
+                 std::vector<Torch*> torches){
     // Setting shaders
     glUseProgram(effect.program);
 
@@ -200,18 +290,18 @@ void Light::draw(const mat3& projection, const vec2& camera_shift, const vec2& s
     // pass light position as uniform
     GLuint light_position_uloc = glGetUniformLocation(effect.program, "light_position");
     // cast light pos to array so we can pass as uniform, for some reason it doesnt like vectors
-    vec2 light_screen_position = add(motion.position, camera_shift);
+    vec2 light_screen_position = add(state.position, camera_shift);
     float light[] = {light_screen_position.x, light_screen_position.y};
     glUniform2fv(light_position_uloc, 1, light);
 
     //pass light angle as uniform
     GLuint light_angle_uloc = glGetUniformLocation(effect.program, "light_angle");
-    float angle = motion.radians;
+    float angle = state.radians;
     glUniform1f(light_angle_uloc, angle);
 
     // pass headlight channel
     GLuint headlight_channel_uloc = glGetUniformLocation(effect.program, "headlight_channel");
-    float channel[] = {m_headlight_channel.x, m_headlight_channel.y, m_headlight_channel.z};
+    float channel[] = {state.headlight_channel.x, state.headlight_channel.y, state.headlight_channel.z};
     glUniform3fv(headlight_channel_uloc, 1, channel);
 
 	// pass torches size
@@ -246,6 +336,10 @@ void Light::draw(const mat3& projection, const vec2& camera_shift, const vec2& s
     glDisableVertexAttribArray(0);
 }
 
+LightState Light::get_state() const {
+    return { motion.position, motion.radians, m_headlight_channel };
+}
+
 bool Light::isWhite(vec3 color) {
     return m_headlight_channel.x == 1.0 && m_headlight_channel.y == 1.0 && m_headlight_channel.z == 1.0;
 }
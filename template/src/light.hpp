@@ -7,19 +7,36 @@
 #include <vector>
 #include <map>
 
-class Light : public Entity
+// What drawing the light reads that the simulation changes
+struct LightState
 {
-	static std::map<std::string, Texture> brickmap_textures;
+    vec2 position;
+    float radians;
+    vec3 headlight_channel;
+};
 
+class Light : public Entity
+{
 public:
     // Creates all the associated render resources and default transform
     bool init(std::string level);
 
-    // Releases all associated resources
+    // Releases all associated resources, the shadow maps are kept for the next levels
     void destroy();
 
-    // Renders the water
-    void draw(const mat3& projection, const vec2& camera_shift, const vec2& size, std::vector<Torch*> torches);
+    // Loads the shadow map of level into the world's over the next frames, so entering
+    // it doesn't stall
+    static void preload(const std::string& level);
+
+    // Releases the world's shadow maps of every level not in levels
+    static void keep_brickmaps(const std::vector<std::string>& levels);
+
+    // Renders the water, lit as in state
+    void draw(const mat3& projection, const vec2& camera_shift, const vec2& size, const LightState& state,
+              std::vector<Torch*> torches);
+
+    // Copies the state draw() needs
+    LightState get_state() const;
 
     void set_position(vec2 pos);
 
@@ -36,6 +53,8 @@ public:
 
     vec3 get_headlight_channel();
 
+    void set_headlight_channel(vec3 channel);
+
     void set_red_channel();
     void set_green_channel();
     void set_blue_channel();
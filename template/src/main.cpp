@@ -1,13 +1,16 @@
 // internal
 #include "common.hpp"
 #include "gamemanager.hpp"
-
-#define GL3W_IMPLEMENTATION
-#include <gl3w.h>
+#include "random.hpp"
+#include "frame_scheduler.hpp"
+#include "simulation_thread.hpp"
 
 // stlib
 #include <chrono>
 #include <iostream>
+#include <random>
+#include <cstring>
+#include <cstdlib>
 
 using Clock = std::chrono::high_resolution_clock;
 
@@ -16,9 +19,38 @@ GameManager gm;
 const int width = 1200;
 const int height = 800;
 
+// How often the state hash is printed in deterministic mode
+const unsigned long HASH_INTERVAL = 60;
+
+// Time each frame gives work queued on the frame scheduler, out of about 16 ms
+const float FRAME_TASK_BUDGET_MS = 2.f;
+
 // Entry point
 int main(int argc, char* argv[])
 {
+	// --deterministic [seed] runs exactly one fixed step per frame from a fixed seed,
+	// so the same input produces the same state hashes on every run
+	bool deterministic = false;
+	uint64_t seed = std::random_device()();
+	for (int i = 1; i < argc; i++)
+	{
+		// --gpu-particles simulates particles with transform feedback instead of on the CPU
+		if (strcmp(argv[i], "--gpu-particles") == 0)
+		{
+			use_gpu_particles();
+		}
+		if (strcmp(argv[i], "--deterministic") == 0)
+		{
+			deterministic = true;
+			seed = 0;
+			if (i + 1 < argc && argv[i + 1][0] != '-')
+			{
+				seed = strtoull(argv[++i], nullptr, 10);
+			}
+		}
+	}
+	seed_random_streams(seed);
+
 	// Initializing world (after renderer.init().. sorry)
 	if (!gm.init({ (float)width, (float)height }))
 	{
@@ -31,26 +63,60 @@ int main(int argc, char* argv[])
 	auto t = Clock::now();
 
 	float elapsed_sec = 0.f;
+	unsigned long ticks = 0;
 
-	// variable timestep loop.. can be improved (:
+	// The updates of a frame, which end by capturing what the next draw shows
+	auto simulate = [&]()
+	{
+		if (deterministic)
+		{
+			// one step per frame no matter how long the frame took
+			gm.update(SIMULATION_STEP_MS);
+			if (++ticks % HASH_INTERVAL == 0)
+			{
+				fprintf(stderr, "tick %lu state %016llx\n", ticks, (unsigned long long)gm.get_state_hash());
+			}
+		}
+		else
+		{
+			// Calculating elapsed times in milliseconds from the previous iteration
+			auto now = Clock::now();
+			elapsed_sec += (float)(std::chrono::duration_cast<std::chrono::microseconds>(now - t)).count() / 1000;
+			t = now;
+
+			for (float b = SIMULATION_STEP_MS; elapsed_sec > b; elapsed_sec -= b)
+			{
+				gm.update(b);
+			}
+		}
+		gm.capture_frame();
+	};
+
+	// Simulates the next frame on its own thread while this one draws the last
+	SimulationThread simulation;
+
+	// fixed timestep loop, the simulation only ever sees SIMULATION_STEP_MS
 	while (!gm.game_over())
 	{
 		// Processes system messages, if this wasn't present the window would become unresponsive
 		glfwPollEvents();
 
-		// Calculating elapsed times in milliseconds from the previous iteration
-		auto now = Clock::now();
-		elapsed_sec += (float)(std::chrono::duration_cast<std::chrono::microseconds>(now - t)).count() / 1000;
-		t = now;
-
-		for (float b = 17.f; elapsed_sec > b; elapsed_sec -= b)
+		if (gm.draws_from_snapshot())
+		{
+			simulation.start(simulate);
+			gm.draw();
+			simulation.wait();
+			gm.publish_frame();
+		}
+		else
 		{
-			gm.update(b);
+			simulate();
+			gm.draw();
 		}
-		gm.draw();
+		s_frame_scheduler.run(FRAME_TASK_BUDGET_MS);
 	}
 
 	gm.destroy();
 
 	return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
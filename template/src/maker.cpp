@@ -47,7 +47,7 @@ bool Maker::init(GLFWwindow* window, vec2 screen)
 	m_screen_scale = static_cast<float>(fb_width) / screen.x;
 
 	// Initialize the screen texture
-	m_screen_tex.create_from_screen(m_window);
+	m_screen_tex.create_from_screen(fb_width, fb_height);
 
 	camera_pos = { 0.f, 0.f };
 	mouse_pos = { 0.f, 0.f };
@@ -161,6 +161,8 @@ void Maker::update(float ms)
 	{
 		m_maker_level.handle_mouse_click(mouse_pos.x, mouse_pos.y, camera_pos, false);
 	}
+
+	m_maker_level.update(ms);
 }
 
 // Should the game be over ?
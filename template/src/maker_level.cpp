@@ -1,9 +1,17 @@
 #include <iostream>
 #include "maker_level.hpp"
+#include "world_context.hpp"
+#include "motion_system.hpp"
 #include "bitmap_image.hpp"
+#include "frame_scheduler.hpp"
 
 using json = nlohmann::json;
 
+namespace
+{
+	const float HOVER_STEP_MS = 1.f; // first guess at a hover respawn, brick edits cost more
+}
+
 static bool within_range(vec2 p1, vec2 p2, float range)
 {
 	bool x = p1.x > p2.x - range && p1.x < p2.x + range;
@@ -13,6 +21,8 @@ static bool within_range(vec2 p1, vec2 p2, float range)
 
 void MakerLevel::destroy()
 {
+	s_frame_scheduler.cancel(m_hover_task);
+
 	// clear all level-dependent resources
 	for (auto& brick : m_bricks) {
 		delete brick;
@@ -27,6 +37,10 @@ void MakerLevel::destroy()
 		delete torch;
 	}
 
+	m_previewing = false;
+	m_placed_ghosts.clear();
+	m_graph_editor = GraphEditor();
+
 	clear_level_components();
 	m_rendering_system.clear();
 	m_bricks.clear();
@@ -38,10 +52,11 @@ void MakerLevel::destroy()
 
 vec2 MakerLevel::generate_starter()
 {
+	WorldContext& world = get_world_context();
 	m_ot = ObjectType::brick;
 	m_ot_selection = 0;
 
-	min = next_id;
+	world.entities.begin_batch();
 
 	spawn_robot({ 6.f * 64.f, height - 5 * 64.f });
 
@@ -63,18 +78,18 @@ vec2 MakerLevel::generate_starter()
 	}
 
 
-	m_rendering_system.process(min, next_id);
+	m_rendering_system.process(world.entities.end_batch());
+	build_graph();
 
 	return m_robot.get_position();
 }
 
 vec2 MakerLevel::load_level()
 {
+	WorldContext& world = get_world_context();
 	m_ot = ObjectType::brick;
 	m_ot_selection = 0;
 
-	min = next_id;
-
 	for (float x = 0.f; x < width; x += 64.f)
 	{
 		for (float y = 0.f; y < height; y += 64.f)
@@ -107,8 +122,8 @@ vec2 MakerLevel::load_level()
 	width = (float) j["size"]["width"] * 64.f;
 	height = (float) j["size"]["height"] * 64.f;
 
-	// Get first entity in this group
-	int min = next_id;
+	// Collect the entities of this group in spawn order
+	world.entities.begin_batch();
 
 	// Get the doors
 	fprintf(stderr, "	getting doors\n");
@@ -190,7 +205,8 @@ vec2 MakerLevel::load_level()
 	vec2 robot_pos = { j["spawn"]["pos"]["x"], j["spawn"]["pos"]["y"] };
 	spawn_robot(to_pixel_position(robot_pos));
 
-	m_rendering_system.process(min, next_id);
+	m_rendering_system.process(world.entities.end_batch());
+	build_graph();
 
 	return m_robot.get_position();
 }
@@ -202,6 +218,11 @@ void MakerLevel::draw_entities(const mat3& projection, const vec2& camera_shift)
 
 void MakerLevel::handle_key_press(int key, int action)
 {
+	// ghost preview toggle
+	if (action == GLFW_PRESS && key == GLFW_KEY_P) {
+		set_previewing(!m_previewing);
+	}
+
 	if (action == GLFW_PRESS && key == GLFW_KEY_TAB) {
 		m_ot_selection = (m_ot_selection + 1) % 5;
 		m_ot = (ObjectType)m_ot_selection;
@@ -239,6 +260,7 @@ void MakerLevel::handle_key_press(int key, int action)
 
 void MakerLevel::handle_mouse_click(double xpos, double ypos, vec2 camera, bool left)
 {
+	WorldContext& world = get_world_context();
 	float x = (float)xpos + camera.x - 600.f + brick_size / 2.f;
 	float y = (float)ypos + camera.y - 400.f + brick_size / 2.f;
 	vec2 position = { x - fmod(x, 64.f) , y - fmod(y, 64.f) };
@@ -248,7 +270,8 @@ void MakerLevel::handle_mouse_click(double xpos, double ypos, vec2 camera, bool
 		return;
 	}
 
-	int start = next_id;
+	// The object placed is the one under the mouse
+	s_frame_scheduler.finish(m_hover_task);
 
 	if (m_hover_object_is_spawned && left)
 	{
@@ -258,6 +281,8 @@ void MakerLevel::handle_mouse_click(double xpos, double ypos, vec2 camera, bool
 
 	if (left) 
 	{
+		world.entities.begin_batch();
+
 		switch (m_ot)
 		{
 		case ObjectType::brick:
@@ -286,10 +311,7 @@ void MakerLevel::handle_mouse_click(double xpos, double ypos, vec2 camera, bool
 			break;
 		}
 
-		for (int i = start; i < next_id; i++)
-		{
-			m_rendering_system.add(i);
-		}
+		m_rendering_system.process(world.entities.end_batch());
 	}
 	else if (!m_hover_object_is_spawned)
 	{
@@ -301,12 +323,23 @@ void MakerLevel::handle_mouse_move(float xpos, float ypos, vec2 camera_pos)
 {
 	float x = xpos + camera_pos.x - 600.f + brick_size / 2.f;
 	float y = ypos + camera_pos.y - 400.f + brick_size / 2.f;
-	vec2 position = { x - fmod(x, 64.f) , y - fmod(y, 64.f) };
-	refresh_hover_object(position.x, position.y);
+	m_hover_target = { x - fmod(x, 64.f) , y - fmod(y, 64.f) };
+
+	// Respawning the hover object edits the navigation graph, it is done once a frame
+	// at most, for wherever the mouse is by then
+	if (!s_frame_scheduler.is_queued(m_hover_task))
+	{
+		m_hover_task = s_frame_scheduler.add("maker hover respawn", HOVER_STEP_MS, [this]()
+		{
+			refresh_hover_object(m_hover_target.x, m_hover_target.y);
+			return true;
+		});
+	}
 }
 
 void MakerLevel::refresh_hover_object(float x, float y)
 {
+	WorldContext& world = get_world_context();
 	vec2 position = { x, y };
 
 	if (m_hover_object_is_spawned)
@@ -317,6 +350,8 @@ void MakerLevel::refresh_hover_object(float x, float y)
 	m_robot.set_position(m_robot_position);
 	m_hover_object_position = position;
 
+	world.entities.begin_batch();
+
 	switch (m_ot)
 	{
 	case ObjectType::brick:
@@ -343,14 +378,17 @@ void MakerLevel::refresh_hover_object(float x, float y)
 
 	m_lot = m_ot;
 
+	std::vector<int> spawned = world.entities.end_batch();
 	if (m_hover_object_is_spawned)
 	{
-		m_rendering_system.add(next_id - 1);
+		m_rendering_system.process(spawned);
 	}
 }
 
 void MakerLevel::process()
 {
+	set_previewing(false);
+
 	if (m_hover_object_is_spawned)
 	{
 		delete_object(m_hover_object_position);
@@ -446,6 +484,80 @@ void MakerLevel::process()
 	image.clear();
 }
 
+void MakerLevel::update(float ms)
+{
+	if (!m_previewing || m_ghosts.empty())
+	{
+		return;
+	}
+
+	vec2 goal = m_robot.get_position();
+	m_flow_field.set_goal(goal, NAV_WHITE);
+	for (auto& ghost : m_ghosts)
+	{
+		ghost->set_goal(goal);
+		ghost->update(ms);
+	}
+	get_world_context().motion_system.step(ms);
+}
+
+void MakerLevel::build_graph()
+{
+	NavLayout layout;
+	layout.reset((int)(width / 64.f), (int)(height / 64.f));
+	for (auto& brick : m_bricks)
+	{
+		layout.add_brick(to_grid_position(brick->get_position()), brick->get_colour());
+	}
+
+	m_graph_editor.begin(&m_graph, layout);
+	m_flow_field.set_graph(&m_graph);
+	for (auto& ghost : m_ghosts)
+	{
+		ghost->set_flow_field(&m_flow_field);
+	}
+}
+
+void MakerLevel::set_nav_cell(int x, int y, uint8_t blocked)
+{
+	m_graph_editor.set_cell(x, y, blocked);
+
+	// The nodes are numbered again, every field and every ghost's place on it is gone
+	m_flow_field.set_graph(&m_graph);
+	for (auto& ghost : m_ghosts)
+	{
+		ghost->set_flow_field(&m_flow_field);
+	}
+}
+
+void MakerLevel::set_previewing(bool previewing)
+{
+	if (previewing == m_previewing)
+	{
+		return;
+	}
+	m_previewing = previewing;
+
+	if (previewing)
+	{
+		// Every ghost chases, as under a white headlight
+		for (auto& ghost : m_ghosts)
+		{
+			m_placed_ghosts.push_back(std::make_pair(ghost, ghost->get_position()));
+			ghost->update_is_chasing({ 1.f, 1.f, 1.f });
+		}
+	}
+	else
+	{
+		for (auto& placed : m_placed_ghosts)
+		{
+			placed.first->set_position(placed.second);
+			placed.first->update_is_chasing(placed.first->get_colour());
+		}
+		m_placed_ghosts.clear();
+	}
+}
+
 bool MakerLevel::delete_object(vec2 position)
 {
 	int x = (int)(position.x / 64.f);
@@ -472,12 +584,22 @@ bool MakerLevel::delete_object(vec2 position)
 
 	bool clean = true;
 	bool found = false;
+	bool brick = false;
 
 	if (e == &m_robot)
 	{
 		return true;
 	}
 
+	for (auto placed = m_placed_ghosts.begin(); placed != m_placed_ghosts.end(); ++placed)
+	{
+		if (placed->first == e)
+		{
+			m_placed_ghosts.erase(placed);
+			break;
+		}
+	}
+
 	if (!found && !m_ghosts.empty()) {
 		if (e == m_ghosts.back())
 		{
@@ -540,6 +662,7 @@ bool MakerLevel::delete_object(vec2 position)
 			clean = false;
 			m_bricks.pop_back();
 			found = true;
+			brick = true;
 		}
 		else
 		{
@@ -549,6 +672,7 @@ bool MakerLevel::delete_object(vec2 position)
 				clean = false;
 				m_bricks.erase(it_b);
 				found = true;
+				brick = true;
 			}
 		}
 	}
@@ -556,6 +680,12 @@ bool MakerLevel::delete_object(vec2 position)
 	if (found)
 	{
 		m_rendering_system.remove(id, clean);
+		release_entity(id);
+	}
+
+	if (brick)
+	{
+		set_nav_cell(x, y, 0);
 	}
 
 	return true;
@@ -610,7 +740,7 @@ bool MakerLevel::spawn_door(vec2 position, std::string next_level)
 	}
 
 	Door* door = new Door();
-	if (door->init(next_id++, position))
+	if (door->init(get_world_context().entities.create(), position))
 	{
 		door->set_destination(next_level);
 		m_interactables.push_back(door);
@@ -632,9 +762,15 @@ bool MakerLevel::spawn_ghost(vec2 position, vec3 colour)
 	}
 
 	Ghost* ghost = new Ghost();
-	if (ghost->init(next_id++, colour, colour))
+	if (ghost->init(get_world_context().entities.create(), colour, colour))
 	{
 		ghost->set_position(position);
+		ghost->set_flow_field(&m_flow_field);
+		if (m_previewing)
+		{
+			m_placed_ghosts.push_back(std::make_pair(ghost, position));
+			ghost->update_is_chasing({ 1.f, 1.f, 1.f });
+		}
 		m_ghosts.push_back(ghost);
 		slots[(int)(position.x / 64.f)][(int)(position.y / 64.f)] = ghost;
 		return true;
@@ -650,10 +786,9 @@ bool MakerLevel::spawn_robot(vec2 position)
 		return false;
 	}
 
-	if (m_robot.init(next_id, false))
+	if (m_robot.init(get_world_context().entities.create(), false))
 	{
 		m_robot_position = position;
-		next_id += 104;
 		m_robot.set_position(position);
 		slots[(int)(position.x / 64.f)][(int)(position.y / 64.f)] = &m_robot;
 		return true;
@@ -672,7 +807,7 @@ bool MakerLevel::spawn_torch(vec2 position)
 	}
 
 	Torch* torch = new Torch();
-	if (torch->init(next_id++))
+	if (torch->init(get_world_context().entities.create()))
 	{
 		torch->set_position(position);
 		m_torches.push_back(torch);
@@ -693,12 +828,12 @@ bool MakerLevel::spawn_brick(vec2 position, vec3 colour)
 	}
 
 	Brick* brick = new Brick();
-	if (brick->init(next_id++, colour))
+	if (brick->init(get_world_context().entities.create(), colour))
 	{
 		brick->set_position(position);
 		m_bricks.push_back(brick);
 		slots[(int)(position.x / 64.f)][(int)(position.y / 64.f)] = brick;
-		brick->update(colour);
+		set_nav_cell((int)(position.x / 64.f), (int)(position.y / 64.f), nav_blocked_by(colour));
 		return true;
 	}
 	fprintf(stderr, "	brick spawn failed\n");
@@ -5,6 +5,8 @@
 #include "Robot/robot.hpp"
 #include "ghost.hpp"
 #include "level_graph.hpp"
+#include "graph_editor.hpp"
+#include "flow_field.hpp"
 #include "Interactables/door.hpp"
 #include "light.hpp"
 #include "sign.hpp"
@@ -44,6 +46,9 @@ public:
 	// Generate JSON and shadow image for current level
 	void process();
 
+	// Moves the ghosts after the robot while previewing
+	void update(float ms);
+
 private:
 	// Spawn entities
 	bool spawn_robot(vec2 position);
@@ -56,6 +61,16 @@ private:
 	bool valid_robot_position(vec2 position);
 	bool valid_torch_position(vec2 position);
 
+	// Builds the navigation graph of the bricks placed so far
+	void build_graph();
+
+	// Updates the graph for a change to the bricks in cell x, y
+	void set_nav_cell(int x, int y, uint8_t blocked);
+
+	// Starts or stops the ghosts chasing the robot, they go back to where they were
+	// placed when it stops
+	void set_previewing(bool previewing);
+
 	std::string m_level;
 	float width = 64.f * 40.f, height = 64.f * 40.f;
 
@@ -65,16 +80,26 @@ private:
 	vec3 m_color = { 1.f, 1.f, 1.f };
 	bool m_hover_object_is_spawned = false;
 	vec2 m_hover_object_position;
+
+	// Where the mouse moved the hover object to, and the frame task that moves it
+	vec2 m_hover_target;
+	int m_hover_task = 0;
 	vec2 m_robot_position;
 
 	// Systems
-	int min;
 	RenderingSystem m_rendering_system;
 
 	// Level entities
 	bool permanent[40][40];
 	Entity* slots[40][40];
 
+	// Navigation, updated brick by brick so the ghosts can be previewed while editing
+	LevelGraph m_graph;
+	GraphEditor m_graph_editor;
+	FlowField m_flow_field;
+	bool m_previewing = false;
+	std::vector<std::pair<Ghost*, vec2>> m_placed_ghosts;
+
 	Robot m_robot;
 	std::vector<Brick*> m_bricks;
 	std::vector<Ghost*> m_ghosts;
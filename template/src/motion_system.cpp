@@ -0,0 +1,212 @@
+#include "motion_system.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MOTION_SYSTEM_SSE2
+#endif
+
+namespace
+{
+	const int NO_BODY = -1;
+
+	// v += a * t, p += v * t over count floats, four at a time with SSE2
+	void integrate_axis(float* position, float* velocity, const float* acceleration, size_t count, float seconds)
+	{
+		size_t i = 0;
+
+#ifdef MOTION_SYSTEM_SSE2
+		__m128 t = _mm_set1_ps(seconds);
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 v = _mm_loadu_ps(velocity + i);
+			v = _mm_add_ps(v, _mm_mul_ps(_mm_loadu_ps(acceleration + i), t));
+			_mm_storeu_ps(velocity + i, v);
+			_mm_storeu_ps(position + i, _mm_add_ps(_mm_loadu_ps(position + i), _mm_mul_ps(v, t)));
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			velocity[i] += acceleration[i] * seconds;
+			position[i] += velocity[i] * seconds;
+		}
+	}
+}
+
+void MotionSystem::add(int id, MotionComponent* mirror)
+{
+	if (id >= (int)m_sparse.size())
+	{
+		m_sparse.resize(id + 1, NO_BODY);
+	}
+
+	int index = m_sparse[id];
+	if (index == NO_BODY)
+	{
+		index = (int)m_ids.size();
+		m_sparse[id] = index;
+		m_ids.push_back(id);
+		m_mirrors.push_back(mirror);
+		m_position_x.push_back(0.f);
+		m_position_y.push_back(0.f);
+		m_velocity_x.push_back(0.f);
+		m_velocity_y.push_back(0.f);
+		m_acceleration_x.push_back(0.f);
+		m_acceleration_y.push_back(0.f);
+		m_scale_x.push_back(0.f);
+		m_scale_y.push_back(0.f);
+	}
+
+	m_mirrors[index] = mirror;
+	m_position_x[index] = mirror->position.x;
+	m_position_y[index] = mirror->position.y;
+	m_velocity_x[index] = mirror->velocity.x;
+	m_velocity_y[index] = mirror->velocity.y;
+	m_acceleration_x[index] = mirror->acceleration.x;
+	m_acceleration_y[index] = mirror->acceleration.y;
+	m_scale_x[index] = mirror->physics.scale.x;
+	m_scale_y[index] = mirror->physics.scale.y;
+}
+
+void MotionSystem::remove(int id)
+{
+	int index = index_of(id);
+	if (index == NO_BODY)
+	{
+		return;
+	}
+
+	int last = (int)m_ids.size() - 1;
+	m_ids[index] = m_ids[last];
+	m_mirrors[index] = m_mirrors[last];
+	m_position_x[index] = m_position_x[last];
+	m_position_y[index] = m_position_y[last];
+	m_velocity_x[index] = m_velocity_x[last];
+	m_velocity_y[index] = m_velocity_y[last];
+	m_acceleration_x[index] = m_acceleration_x[last];
+	m_acceleration_y[index] = m_acceleration_y[last];
+	m_scale_x[index] = m_scale_x[last];
+	m_scale_y[index] = m_scale_y[last];
+	m_sparse[m_ids[index]] = index;
+	m_sparse[id] = NO_BODY;
+
+	m_ids.pop_back();
+	m_mirrors.pop_back();
+	m_position_x.pop_back();
+	m_position_y.pop_back();
+	m_velocity_x.pop_back();
+	m_velocity_y.pop_back();
+	m_acceleration_x.pop_back();
+	m_acceleration_y.pop_back();
+	m_scale_x.pop_back();
+	m_scale_y.pop_back();
+}
+
+bool MotionSystem::contains(int id) const
+{
+	return index_of(id) != NO_BODY;
+}
+
+void MotionSystem::set_position(int id, vec2 position)
+{
+	int index = index_of(id);
+	m_position_x[index] = position.x;
+	m_position_y[index] = position.y;
+	m_mirrors[index]->position = position;
+}
+
+void MotionSystem::set_velocity(int id, vec2 velocity)
+{
+	int index = index_of(id);
+	m_velocity_x[index] = velocity.x;
+	m_velocity_y[index] = velocity.y;
+	m_mirrors[index]->velocity = velocity;
+}
+
+void MotionSystem::set_acceleration(int id, vec2 acceleration)
+{
+	int index = index_of(id);
+	m_acceleration_x[index] = acceleration.x;
+	m_acceleration_y[index] = acceleration.y;
+	m_mirrors[index]->acceleration = acceleration;
+}
+
+void MotionSystem::set_scale(int id, vec2 scale)
+{
+	int index = index_of(id);
+	m_scale_x[index] = scale.x;
+	m_scale_y[index] = scale.y;
+	m_mirrors[index]->physics.scale = scale;
+}
+
+vec2 MotionSystem::get_position(int id) const
+{
+	int index = index_of(id);
+	return { m_position_x[index], m_position_y[index] };
+}
+
+vec2 MotionSystem::get_velocity(int id) const
+{
+	int index = index_of(id);
+	return { m_velocity_x[index], m_velocity_y[index] };
+}
+
+void MotionSystem::step(float ms)
+{
+	integrate(ms / 1000.f);
+
+	// Scales are only ever set as intents, they go back with the rest so the
+	// mirrors are whole again
+	for (size_t i = 0; i < m_ids.size(); i++)
+	{
+		MotionComponent* mirror = m_mirrors[i];
+		mirror->position = { m_position_x[i], m_position_y[i] };
+		mirror->velocity = { m_velocity_x[i], m_velocity_y[i] };
+		mirror->physics.scale = { m_scale_x[i], m_scale_y[i] };
+	}
+}
+
+void MotionSystem::clear()
+{
+	for (int id : m_ids)
+	{
+		m_sparse[id] = NO_BODY;
+	}
+
+	m_ids.clear();
+	m_mirrors.clear();
+	m_position_x.clear();
+	m_position_y.clear();
+	m_velocity_x.clear();
+	m_velocity_y.clear();
+	m_acceleration_x.clear();
+	m_acceleration_y.clear();
+	m_scale_x.clear();
+	m_scale_y.clear();
+}
+
+size_t MotionSystem::size() const
+{
+	return m_ids.size();
+}
+
+int MotionSystem::index_of(int id) const
+{
+	if (id < 0 || id >= (int)m_sparse.size())
+	{
+		return NO_BODY;
+	}
+	return m_sparse[id];
+}
+
+void MotionSystem::integrate(float seconds)
+{
+	size_t count = m_ids.size();
+	if (count == 0)
+	{
+		return;
+	}
+
+	integrate_axis(m_position_x.data(), m_velocity_x.data(), m_acceleration_x.data(), count, seconds);
+	integrate_axis(m_position_y.data(), m_velocity_y.data(), m_acceleration_y.data(), count, seconds);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "common.hpp"
+#include "components.hpp"
+#include <vector>
+
+// Integrates every kinematic body (the ghosts) in one pass over structure of
+// arrays data. Entities only set intents through here, the MotionComponent they
+// register is a mirror that is written back after each step for rendering.
+// The robot and the backgrounds keep moving themselves, the robot is resolved
+// against bricks and the backgrounds follow the camera.
+class MotionSystem
+{
+public:
+	// Starts integrating id, its current motion is copied from mirror
+	void add(int id, MotionComponent* mirror);
+
+	// Stops integrating id, swapping the last body into its place
+	void remove(int id);
+
+	bool contains(int id) const;
+
+	// Intents, each also updates the mirror right away
+	void set_position(int id, vec2 position);
+	void set_velocity(int id, vec2 velocity);
+	void set_acceleration(int id, vec2 acceleration);
+	void set_scale(int id, vec2 scale);
+
+	vec2 get_position(int id) const;
+	vec2 get_velocity(int id) const;
+
+	// Advances every body by ms and writes the results back to the mirrors
+	void step(float ms);
+
+	// Forgets every body
+	void clear();
+
+	// Number of bodies being integrated
+	size_t size() const;
+
+private:
+	int index_of(int id) const;
+	void integrate(float seconds);
+
+	std::vector<int> m_sparse;
+	std::vector<int> m_ids;
+	std::vector<MotionComponent*> m_mirrors;
+
+	// One array per component, body i is at index i in all of them
+	std::vector<float> m_position_x, m_position_y;
+	std::vector<float> m_velocity_x, m_velocity_y;
+	std::vector<float> m_acceleration_x, m_acceleration_y;
+	std::vector<float> m_scale_x, m_scale_y;
+};
@@ -0,0 +1,131 @@
+#include "nav_cache.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <iterator>
+
+namespace
+{
+	const uint32_t NAV_CACHE_MAGIC = 0x56414E45; // "ENAV"
+	// Bump whenever the graph layout or the way graphs are generated changes
+	const uint32_t NAV_CACHE_VERSION = 3;
+
+	struct NavCacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t content_hash;
+		uint32_t reserved;
+		uint32_t payload_size;
+		uint64_t checksum; // of the payload that follows the header
+	};
+
+	std::string cache_filename(const std::string& level)
+	{
+		std::string filename = level_path;
+		filename.append(level);
+		filename.append(".navcache");
+		return filename;
+	}
+}
+
+uint64_t hash_level_content(const std::string& content)
+{
+	return hash_bytes(content.data(), content.size());
+}
+
+bool load_nav_cache(const std::string& level, uint64_t content_hash, LevelGraph& graph, const NavLayout& layout)
+{
+	std::ifstream file(cache_filename(level), std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	NavCacheHeader header;
+	if (bytes.size() < sizeof(header))
+	{
+		fprintf(stderr, "	nav cache for %s is truncated\n", level.c_str());
+		return false;
+	}
+	memcpy(&header, bytes.data(), sizeof(header));
+
+	if (header.magic != NAV_CACHE_MAGIC || header.version != NAV_CACHE_VERSION)
+	{
+		fprintf(stderr, "	nav cache for %s is from another version\n", level.c_str());
+		return false;
+	}
+	if (header.content_hash != content_hash)
+	{
+		fprintf(stderr, "	nav cache for %s is out of date\n", level.c_str());
+		return false;
+	}
+
+	const char* read = bytes.data() + sizeof(header);
+	const char* end = bytes.data() + bytes.size();
+	if ((size_t)(end - read) != header.payload_size || hash_bytes(read, header.payload_size) != header.checksum)
+	{
+		fprintf(stderr, "	nav cache for %s is damaged\n", level.c_str());
+		return false;
+	}
+
+	if (!graph.deserialise(read, end, layout) || read != end)
+	{
+		fprintf(stderr, "	nav cache for %s is damaged\n", level.c_str());
+		return false;
+	}
+
+	fprintf(stderr, "	loaded graph from nav cache\n");
+	return true;
+}
+
+bool save_nav_cache(const std::string& level, uint64_t content_hash, const LevelGraph& graph)
+{
+	std::vector<char> payload;
+	graph.serialise(payload);
+
+	NavCacheHeader header;
+	header.magic = NAV_CACHE_MAGIC;
+	header.version = NAV_CACHE_VERSION;
+	header.content_hash = content_hash;
+	header.reserved = 0;
+	header.payload_size = (uint32_t)payload.size();
+	header.checksum = hash_bytes(payload.data(), payload.size());
+
+	// written beside the cache and moved over it, so another run never reads it half written
+	std::string filename = cache_filename(level);
+	std::string temp_filename = filename + ".tmp";
+	{
+		std::ofstream file(temp_filename, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			fprintf(stderr, "	failed to write nav cache for %s\n", level.c_str());
+			return false;
+		}
+
+		file.write((const char*)&header, sizeof(header));
+		file.write(payload.data(), payload.size());
+		file.close();
+		if (!file.good())
+		{
+			fprintf(stderr, "	failed to write nav cache for %s\n", level.c_str());
+			remove(temp_filename.c_str());
+			return false;
+		}
+	}
+
+	// rename won't replace a file on windows
+	if (rename(temp_filename.c_str(), filename.c_str()) != 0)
+	{
+		remove(filename.c_str());
+		if (rename(temp_filename.c_str(), filename.c_str()) != 0)
+		{
+			fprintf(stderr, "	failed to replace nav cache for %s\n", level.c_str());
+			remove(temp_filename.c_str());
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "common.hpp"
+#include "level_graph.hpp"
+#include <string>
+
+// Generating the navigation graph of a level is the slow part of loading it, so
+// it is kept in a cache file next to the level, <level>.navcache. The cache is
+// keyed by a hash of the level file, so it is simply regenerated when the level
+// changes, and carries a checksum so a damaged file is never loaded.
+
+// Hashes the text of a level file
+uint64_t hash_level_content(const std::string& content);
+
+// Fills graph from the cache of level, layout is the level it was made from.
+// Returns false if there is no cache, or it is for another version of the level, an
+// older cache format, or damaged
+bool load_nav_cache(const std::string& level, uint64_t content_hash, LevelGraph& graph, const NavLayout& layout);
+
+// Writes the cache of level, replacing the old one in one step
+bool save_nav_cache(const std::string& level, uint64_t content_hash, const LevelGraph& graph);
@@ -0,0 +1,299 @@
+#include "occupancy_grid.hpp"
+#include "level_graph.hpp"
+
+#include <math.h>
+
+namespace
+{
+	const int64_t S = OccupancyGrid::SUBDIVISIONS;
+	const int CHANNEL_COUNT = 4;
+
+	// Division rounding down and up, b must be positive
+	int64_t floor_div(int64_t a, int64_t b)
+	{
+		return a >= 0 ? a / b : -((-a + b - 1) / b);
+	}
+
+	int64_t ceil_div(int64_t a, int64_t b)
+	{
+		return -floor_div(-a, b);
+	}
+
+	int64_t to_fixed(float pixels)
+	{
+		return (int64_t)llround(pixels * S / brick_size);
+	}
+
+	// Whether the segment from (x0, y0) by (dx, dy) passes through the inside of the
+	// open box (bx0, bx1) x (by0, by1). Separating axis test: the two box axes, then
+	// the segment normal, along which the segment projects to a single point.
+	bool segment_enters_box(int64_t x0, int64_t y0, int64_t dx, int64_t dy,
+		int64_t bx0, int64_t by0, int64_t bx1, int64_t by1)
+	{
+		if (std::max(x0, x0 + dx) <= bx0 || std::min(x0, x0 + dx) >= bx1 ||
+			std::max(y0, y0 + dy) <= by0 || std::min(y0, y0 + dy) >= by1)
+		{
+			return false;
+		}
+
+		int64_t corners[4] = {
+			(bx0 - x0) * dy - (by0 - y0) * dx,
+			(bx1 - x0) * dy - (by0 - y0) * dx,
+			(bx0 - x0) * dy - (by1 - y0) * dx,
+			(bx1 - x0) * dy - (by1 - y0) * dx
+		};
+
+		bool any_below = false;
+		bool any_above = false;
+		for (int64_t corner : corners)
+		{
+			any_below |= corner < 0;
+			any_above |= corner > 0;
+		}
+		return any_below && any_above;
+	}
+
+	// Calls visit(x, y) for every cell the box can reach on the way from (x0, y0) to
+	// (x1, y1), walking along the longer axis, "major", one cell line at a time and
+	// finding the range of cells the box covers on the other axis while in that line.
+	// Stops early when visit returns false
+	template <typename Visit>
+	void walk_cells(int64_t x0, int64_t y0, int64_t x1, int64_t y1, Visit visit)
+	{
+		bool transposed = std::abs(y1 - y0) > std::abs(x1 - x0);
+		int64_t major0 = transposed ? y0 : x0;
+		int64_t minor0 = transposed ? x0 : y0;
+		int64_t major_delta = transposed ? y1 - y0 : x1 - x0;
+		int64_t minor_delta = transposed ? x1 - x0 : y1 - y0;
+
+		// Minor coordinate at major coordinate m, rounded down and up
+		int64_t denominator = std::max<int64_t>(1, std::abs(major_delta));
+		int64_t sign = major_delta > 0 ? 1 : -1;
+		auto minor_floor = [&](int64_t m) { return minor0 + floor_div((m - major0) * minor_delta * sign, denominator); };
+		auto minor_ceil = [&](int64_t m) { return minor0 + ceil_div((m - major0) * minor_delta * sign, denominator); };
+
+		int64_t major_min = std::min(major0, major0 + major_delta);
+		int64_t major_max = std::max(major0, major0 + major_delta);
+
+		for (int64_t line = floor_div(major_min, S); line <= ceil_div(major_max, S); line++)
+		{
+			int64_t from = std::max(major_min, (line - 1) * S);
+			int64_t to = std::min(major_max, (line + 1) * S);
+
+			int64_t low = std::min(minor_floor(from), minor_floor(to));
+			int64_t high = std::max(minor_ceil(from), minor_ceil(to));
+
+			for (int64_t cell = floor_div(low, S); cell <= ceil_div(high, S); cell++)
+			{
+				if (!visit((int)(transposed ? cell : line), (int)(transposed ? line : cell)))
+				{
+					return;
+				}
+			}
+		}
+	}
+}
+
+void OccupancyGrid::build(const NavLayout& layout)
+{
+	m_width = layout.width;
+	m_height = layout.height;
+	m_row_words = (m_width + 63) / 64;
+	m_column_words = (m_height + 63) / 64;
+	m_cells = layout.cells;
+
+	for (int channel = 0; channel < CHANNEL_COUNT; channel++)
+	{
+		m_rows[channel].assign((size_t)m_row_words * m_height, 0);
+		m_columns[channel].assign((size_t)m_column_words * m_width, 0);
+	}
+
+	for (int y = 0; y < m_height; y++)
+	{
+		for (int x = 0; x < m_width; x++)
+		{
+			uint8_t cell = layout.blocked(x, y);
+			for (int channel = 0; channel < CHANNEL_COUNT; channel++)
+			{
+				if (cell & (1 << channel))
+				{
+					m_rows[channel][y * m_row_words + x / 64] |= 1ull << (x % 64);
+					m_columns[channel][x * m_column_words + y / 64] |= 1ull << (y % 64);
+				}
+			}
+		}
+	}
+}
+
+uint8_t OccupancyGrid::blocked(int x, int y) const
+{
+	if (x < 0 || x >= m_width || y < 0 || y >= m_height)
+	{
+		return NAV_ALL_CHANNELS;
+	}
+
+	return m_cells[y * m_width + x];
+}
+
+uint8_t OccupancyGrid::clear_channels(vec2 from, vec2 to, uint8_t channels) const
+{
+	int64_t x0 = to_fixed(from.x);
+	int64_t y0 = to_fixed(from.y);
+	int64_t x1 = to_fixed(to.x);
+	int64_t y1 = to_fixed(to.y);
+
+	if (y0 == y1)
+	{
+		return slide_along_row(x0, x1, y0, channels);
+	}
+	if (x0 == x1)
+	{
+		return slide_along_column(y0, y1, x0, channels);
+	}
+	return slide(x0, y0, x1, y1, channels);
+}
+
+void OccupancyGrid::crossed_cells(vec2 from, vec2 to, std::vector<int>& cells) const
+{
+	cells.clear();
+	int64_t x0 = to_fixed(from.x);
+	int64_t y0 = to_fixed(from.y);
+	int64_t x1 = to_fixed(to.x);
+	int64_t y1 = to_fixed(to.y);
+	if (x0 == x1 && y0 == y1)
+	{
+		return;
+	}
+
+	walk_cells(x0, y0, x1, y1, [&](int x, int y) {
+		if (x >= 0 && x < m_width && y >= 0 && y < m_height &&
+			segment_enters_box(x0, y0, x1 - x0, y1 - y0, (x - 1) * S, (y - 1) * S, (x + 1) * S, (y + 1) * S))
+		{
+			cells.push_back(y * m_width + x);
+		}
+		return true;
+	});
+}
+
+void OccupancyGrid::set_cell(int x, int y, uint8_t blocked)
+{
+	m_cells[y * m_width + x] = blocked;
+	for (int channel = 0; channel < CHANNEL_COUNT; channel++)
+	{
+		uint64_t& row = m_rows[channel][y * m_row_words + x / 64];
+		uint64_t& column = m_columns[channel][x * m_column_words + y / 64];
+		if (blocked & (1 << channel))
+		{
+			row |= 1ull << (x % 64);
+			column |= 1ull << (y % 64);
+		}
+		else
+		{
+			row &= ~(1ull << (x % 64));
+			column &= ~(1ull << (y % 64));
+		}
+	}
+}
+
+int OccupancyGrid::get_width() const
+{
+	return m_width;
+}
+
+int OccupancyGrid::get_height() const
+{
+	return m_height;
+}
+
+bool OccupancyGrid::span_blocked(const std::vector<uint64_t>& plane, int words_per_line,
+	int line_count, int line_length, int line, int first, int last)
+{
+	if (line < 0 || line >= line_count || first < 0 || last >= line_length)
+	{
+		return true;
+	}
+
+	const uint64_t* words = &plane[(size_t)line * words_per_line];
+	int first_word = first / 64;
+	int last_word = last / 64;
+
+	for (int w = first_word; w <= last_word; w++)
+	{
+		uint64_t mask = ~0ull;
+		if (w == first_word)
+			mask &= ~0ull << (first % 64);
+		if (w == last_word)
+			mask &= ~0ull >> (63 - last % 64);
+
+		if (words[w] & mask)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+uint8_t OccupancyGrid::slide_along_row(int64_t x0, int64_t x1, int64_t y, uint8_t channels) const
+{
+	// The box overlaps the inside of column c while its left edge is in (c - 1, c + 1)
+	int first = (int)floor_div(std::min(x0, x1), S);
+	int last = (int)ceil_div(std::max(x0, x1), S);
+	int top = (int)floor_div(y, S);
+	int bottom = (int)ceil_div(y, S);
+
+	uint8_t clear = channels;
+	for (int channel = 0; channel < CHANNEL_COUNT; channel++)
+	{
+		if (!(clear & (1 << channel)))
+			continue;
+
+		for (int row = top; row <= bottom; row++)
+		{
+			if (span_blocked(m_rows[channel], m_row_words, m_height, m_width, row, first, last))
+			{
+				clear &= ~(1 << channel);
+				break;
+			}
+		}
+	}
+	return clear;
+}
+
+uint8_t OccupancyGrid::slide_along_column(int64_t y0, int64_t y1, int64_t x, uint8_t channels) const
+{
+	int first = (int)floor_div(std::min(y0, y1), S);
+	int last = (int)ceil_div(std::max(y0, y1), S);
+	int left = (int)floor_div(x, S);
+	int right = (int)ceil_div(x, S);
+
+	uint8_t clear = channels;
+	for (int channel = 0; channel < CHANNEL_COUNT; channel++)
+	{
+		if (!(clear & (1 << channel)))
+			continue;
+
+		for (int column = left; column <= right; column++)
+		{
+			if (span_blocked(m_columns[channel], m_column_words, m_width, m_height, column, first, last))
+			{
+				clear &= ~(1 << channel);
+				break;
+			}
+		}
+	}
+	return clear;
+}
+
+uint8_t OccupancyGrid::slide(int64_t x0, int64_t y0, int64_t x1, int64_t y1, uint8_t channels) const
+{
+	uint8_t clear = channels;
+	walk_cells(x0, y0, x1, y1, [&](int x, int y) {
+		uint8_t hit = blocked(x, y) & clear;
+		if (hit && segment_enters_box(x0, y0, x1 - x0, y1 - y0, (x - 1) * S, (y - 1) * S, (x + 1) * S, (y + 1) * S))
+		{
+			clear &= ~hit;
+		}
+		return clear != 0;
+	});
+	return clear;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "common.hpp"
+#include <vector>
+
+struct NavLayout;
+
+// Bit-packed brick occupancy of a level, one bit plane per headlight channel.
+// Each plane is kept twice, row-major and column-major, with 64 cells per word,
+// so a slide along a row or a column is tested a whole word at a time. Diagonal
+// slides look cells up in a byte per cell holding all four channels.
+//
+// Ghosts are a one-cell box whose top-left corner sits at their grid position
+// (bricks and ghosts are both drawn centred on their position, so the half-cell
+// offset cancels). A slide from a to b is blocked in a channel if the box sweeps
+// over the inside of a blocked cell; only touching an edge or corner is fine.
+// Positions are snapped to 1/SUBDIVISIONS of a cell and the test is exact in
+// integers from there on.
+class OccupancyGrid
+{
+public:
+	// Fixed point steps per cell, so a pixel is SUBDIVISIONS / brick_size steps
+	static const int SUBDIVISIONS = 256;
+
+	// Takes the blocked cells of layout
+	void build(const NavLayout& layout);
+
+	// Channels the cell at x, y is blocked in, cells outside the level block all of them
+	uint8_t blocked(int x, int y) const;
+
+	// Returns the ones of channels in which the box can slide between two pixel
+	// positions without overlapping a blocked cell
+	uint8_t clear_channels(vec2 from, vec2 to, uint8_t channels) const;
+
+	// Cells the box overlaps while sliding between two pixel positions, whatever
+	// they hold, so the slide is clear exactly when none of them is blocked
+	void crossed_cells(vec2 from, vec2 to, std::vector<int>& cells) const;
+
+	// Changes the channels cell x, y is blocked in
+	void set_cell(int x, int y, uint8_t blocked);
+
+	int get_width() const;
+	int get_height() const;
+
+private:
+	// Whether any cell from first to last (inclusive) along line of plane is set,
+	// anything outside the level counts as set
+	static bool span_blocked(const std::vector<uint64_t>& plane, int words_per_line,
+		int line_count, int line_length, int line, int first, int last);
+
+	uint8_t slide_along_row(int64_t x0, int64_t x1, int64_t y, uint8_t channels) const;
+	uint8_t slide_along_column(int64_t y0, int64_t y1, int64_t x, uint8_t channels) const;
+	uint8_t slide(int64_t x0, int64_t y0, int64_t x1, int64_t y1, uint8_t channels) const;
+
+	int m_width = 0;
+	int m_height = 0;
+	int m_row_words = 0;
+	int m_column_words = 0;
+
+	// Bit x % 64 of m_rows[channel][y * m_row_words + x / 64] is set if cell x, y is
+	// blocked in channel, m_columns is the same with x and y swapped
+	std::vector<uint64_t> m_rows[4];
+	std::vector<uint64_t> m_columns[4];
+	std::vector<uint8_t> m_cells;
+};
@@ -0,0 +1,130 @@
+#include "particle_emitters.hpp"
+#include "ghost.hpp"
+#include "random.hpp"
+#include "torch.hpp"
+
+namespace
+{
+	const float PI = 3.14159265f;
+
+	const float SMOKE_SPAWN_DELAY_MS = 25.f;
+	const size_t SMOKE_COUNT = 3; // # of smokes generated at the same time
+	const float SMOKE_WIDTH = 40.f;
+	const float SMOKE_LIFE_MS = 500.f;
+	const float SMOKE_MAX_SCALE = 3.f;
+	const float SMOKE_MIN_SCALE = 1.5f;
+	const float SMOKE_SIZE_MOD = 0.7f;
+	const float SMOKE_VELOCITY_Y = 50.f;
+
+	const float EMBER_SPAWN_DELAY_MS = 150.f; // per torch
+	const float EMBER_LIFE_MS = 900.f;
+	const float EMBER_SPREAD = 12.f;
+	const float EMBER_RISE = 40.f;
+	const vec3 EMBER_COLOUR = { 1.f, 0.55f, 0.15f };
+
+	const float TRAIL_SPAWN_DELAY_MS = 100.f;
+	const float TRAIL_LIFE_MS = 300.f;
+	const float TRAIL_ALPHA = 0.35f;
+}
+
+void RocketSmokeEmitter::start()
+{
+	m_started = true;
+}
+
+void RocketSmokeEmitter::stop()
+{
+	m_started = false;
+}
+
+void RocketSmokeEmitter::update(float ms, vec2 robot_position, vec2 robot_velocity, ParticleSystem& particles)
+{
+	m_next_spawn -= ms;
+	if (!m_started || m_next_spawn >= 0.f)
+		return;
+	m_next_spawn = SMOKE_SPAWN_DELAY_MS;
+
+	// blown back against the way the robot goes, but never down onto it
+	vec2 velocity = { robot_velocity.x * -1.f / 3.f, robot_velocity.y * -1.f / 2.f };
+	if (velocity.y < 0.f)
+		velocity.y = SMOKE_VELOCITY_Y;
+
+	RandomStream& rng = random_stream(RandomStreamId::smoke);
+	float x_interval = SMOKE_WIDTH / (SMOKE_COUNT - 1);
+	for (size_t i = 0; i < SMOKE_COUNT; i++)
+	{
+		float scale = rng.uniform(SMOKE_MIN_SCALE, SMOKE_MAX_SCALE);
+		ParticleSpawn spawn;
+		spawn.position = { robot_position.x - SMOKE_WIDTH / 2.f + x_interval * i, robot_position.y + 25.f };
+		spawn.velocity = velocity;
+		spawn.scale = { scale, scale };
+		spawn.radians = rng.uniform(0.f, 2 * PI);
+		spawn.alpha = 1.f;
+		spawn.life_ms = SMOKE_LIFE_MS;
+		spawn.size_mod = SMOKE_SIZE_MOD;
+		spawn.colour = { 1.f, 1.f, 1.f };
+		spawn.texture = rng.next() % 2 == 0 ? ParticleTexture::smoke_large : ParticleTexture::smoke_small;
+		particles.emit(spawn);
+	}
+}
+
+void EmberEmitter::update(float ms, const std::vector<Torch*>& torches, ParticleSystem& particles)
+{
+	m_next_spawn -= ms;
+	if (m_next_spawn >= 0.f)
+		return;
+	m_next_spawn = EMBER_SPAWN_DELAY_MS;
+
+	RandomStream& rng = random_stream(RandomStreamId::embers);
+	for (const Torch* torch : torches)
+	{
+		float scale = rng.uniform(0.1f, 0.25f);
+		ParticleSpawn spawn;
+		spawn.position = add(torch->get_position(), { rng.uniform(-EMBER_SPREAD, EMBER_SPREAD), -EMBER_SPREAD });
+		spawn.velocity = { rng.uniform(-EMBER_SPREAD, EMBER_SPREAD), -rng.uniform(EMBER_RISE / 2.f, EMBER_RISE) };
+		spawn.scale = { scale, scale };
+		spawn.radians = rng.uniform(0.f, 2 * PI);
+		spawn.alpha = 1.f;
+		spawn.life_ms = rng.uniform(EMBER_LIFE_MS / 2.f, EMBER_LIFE_MS);
+		spawn.size_mod = 0.f;
+		spawn.colour = EMBER_COLOUR;
+		spawn.texture = ParticleTexture::smoke_small;
+		particles.emit(spawn);
+	}
+}
+
+void EmberEmitter::clear()
+{
+	m_next_spawn = 0.f;
+}
+
+void GhostTrailEmitter::update(float ms, const std::vector<Ghost*>& ghosts, ParticleSystem& particles)
+{
+	m_next_spawn -= ms;
+	if (m_next_spawn >= 0.f)
+		return;
+	m_next_spawn = TRAIL_SPAWN_DELAY_MS;
+
+	for (Ghost* ghost : ghosts)
+	{
+		if (!ghost->is_chasing() || !ghost->is_moving())
+			continue;
+
+		ParticleSpawn spawn;
+		spawn.position = ghost->get_position();
+		spawn.velocity = { 0.f, 0.f };
+		spawn.scale = ghost->get_scale();
+		spawn.radians = 0.f;
+		spawn.alpha = TRAIL_ALPHA;
+		spawn.life_ms = TRAIL_LIFE_MS;
+		spawn.size_mod = 0.f;
+		spawn.colour = ghost->get_colour();
+		spawn.texture = ParticleTexture::ghost;
+		particles.emit(spawn);
+	}
+}
+
+void GhostTrailEmitter::clear()
+{
+	m_next_spawn = 0.f;
+}
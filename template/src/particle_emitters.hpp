@@ -0,0 +1,48 @@
+#pragma once
+
+#include "common.hpp"
+#include "particle_system.hpp"
+#include <vector>
+
+class Ghost;
+class Torch;
+
+// Puffs of smoke from the robot's rocket while it flies
+class RocketSmokeEmitter
+{
+public:
+	void start();
+
+	void stop();
+
+	// Puffs out a row of smoke below the robot every so often while started
+	void update(float ms, vec2 robot_position, vec2 robot_velocity, ParticleSystem& particles);
+
+private:
+	bool m_started = false;
+	float m_next_spawn = 0.f;
+};
+
+// Embers drifting up from the level's torches
+class EmberEmitter
+{
+public:
+	void update(float ms, const std::vector<Torch*>& torches, ParticleSystem& particles);
+
+	void clear();
+
+private:
+	float m_next_spawn = 0.f;
+};
+
+// Fading copies of the ghosts left behind as they chase the robot
+class GhostTrailEmitter
+{
+public:
+	void update(float ms, const std::vector<Ghost*>& ghosts, ParticleSystem& particles);
+
+	void clear();
+
+private:
+	float m_next_spawn = 0.f;
+};
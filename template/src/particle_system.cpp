@@ -0,0 +1,523 @@
+#include "particle_system.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stddef.h>
+
+namespace
+{
+	const float SIZE_MOD_MS = 200.f; // one pulse of a particle's size
+	const float PI = 3.14159265f;
+
+	const char* TEXTURE_PATHS[] = {
+		textures_path("smoke_large.png"),
+		textures_path("smoke_small.png"),
+		textures_path("ghost.png"),
+	};
+}
+
+void ParticleSystem::reserve(size_t capacity)
+{
+	m_count = 0;
+	m_position_x.resize(capacity);
+	m_position_y.resize(capacity);
+	m_velocity_x.resize(capacity);
+	m_velocity_y.resize(capacity);
+	m_age.resize(capacity);
+	m_life.resize(capacity);
+	m_alpha.resize(capacity);
+	m_scale_x.resize(capacity);
+	m_scale_y.resize(capacity);
+	m_size_mod.resize(capacity);
+	m_radians.resize(capacity);
+	m_colour.resize(capacity);
+	m_texture.resize(capacity);
+	m_batch.spawns.reserve(capacity);
+	m_batch.emitted_ms.reserve(capacity);
+}
+
+void ParticleSystem::set_gpu_simulated(bool gpu_simulated)
+{
+	m_gpu_simulated = gpu_simulated;
+	clear();
+}
+
+bool ParticleSystem::is_gpu_simulated() const
+{
+	return m_gpu_simulated;
+}
+
+bool ParticleSystem::emit(const ParticleSpawn& spawn)
+{
+	if (m_gpu_simulated)
+	{
+		if (m_batch.spawns.size() == capacity())
+		{
+			return false;
+		}
+		m_batch.spawns.push_back(spawn);
+		m_batch.emitted_ms.push_back(m_batch.elapsed_ms);
+		return true;
+	}
+
+	if (m_count == capacity())
+	{
+		return false;
+	}
+
+	size_t i = m_count++;
+	m_position_x[i] = spawn.position.x;
+	m_position_y[i] = spawn.position.y;
+	m_velocity_x[i] = spawn.velocity.x;
+	m_velocity_y[i] = spawn.velocity.y;
+	m_age[i] = 0.f;
+	m_life[i] = spawn.life_ms;
+	m_alpha[i] = spawn.alpha;
+	m_scale_x[i] = spawn.scale.x;
+	m_scale_y[i] = spawn.scale.y;
+	m_size_mod[i] = spawn.size_mod;
+	m_radians[i] = spawn.radians;
+	m_colour[i] = spawn.colour;
+	m_texture[i] = (uint8_t)spawn.texture;
+	return true;
+}
+
+void ParticleSystem::update(float elapsed_ms)
+{
+	if (m_gpu_simulated)
+	{
+		m_batch.elapsed_ms += elapsed_ms;
+		return;
+	}
+
+	float seconds = elapsed_ms / 1000.f;
+	for (size_t i = 0; i < m_count; i++)
+	{
+		m_position_x[i] += m_velocity_x[i] * seconds;
+		m_position_y[i] += m_velocity_y[i] * seconds;
+		m_age[i] += elapsed_ms;
+	}
+
+	// Walking down, the particle swapped into a dead one's place was already checked
+	for (size_t i = m_count; i-- > 0;)
+	{
+		if (m_age[i] >= m_life[i])
+		{
+			remove(i);
+		}
+	}
+}
+
+void ParticleSystem::capture(std::vector<ParticleInstance>& instances) const
+{
+	instances.resize(m_count);
+	for (size_t i = 0; i < m_count; i++)
+	{
+		// the scale swells and shrinks back every SIZE_MOD_MS
+		float pulse = std::sin(std::fmod(m_age[i], SIZE_MOD_MS) / SIZE_MOD_MS * PI) * m_size_mod[i];
+
+		ParticleInstance& instance = instances[i];
+		instance.position = { m_position_x[i], m_position_y[i] };
+		instance.scale = { m_scale_x[i] + pulse, m_scale_y[i] + pulse };
+		instance.radians = m_radians[i];
+		instance.alpha = m_alpha[i] * (1.f - m_age[i] / m_life[i]);
+		instance.texture = (float)m_texture[i];
+		instance.colour = m_colour[i];
+	}
+}
+
+void ParticleSystem::take_batch(ParticleBatch& batch)
+{
+	std::swap(m_batch, batch);
+	batch.frame = ++m_batches_taken;
+	m_batch.spawns.clear();
+	m_batch.emitted_ms.clear();
+	m_batch.elapsed_ms = 0.f;
+	m_batch.cleared = false;
+}
+
+void ParticleSystem::clear()
+{
+	m_count = 0;
+	m_batch.spawns.clear();
+	m_batch.emitted_ms.clear();
+	m_batch.elapsed_ms = 0.f;
+	m_batch.cleared = m_gpu_simulated;
+}
+
+size_t ParticleSystem::size() const
+{
+	return m_count;
+}
+
+size_t ParticleSystem::capacity() const
+{
+	return m_position_x.size();
+}
+
+void ParticleSystem::remove(size_t index)
+{
+	size_t last = --m_count;
+	m_position_x[index] = m_position_x[last];
+	m_position_y[index] = m_position_y[last];
+	m_velocity_x[index] = m_velocity_x[last];
+	m_velocity_y[index] = m_velocity_y[last];
+	m_age[index] = m_age[last];
+	m_life[index] = m_life[last];
+	m_alpha[index] = m_alpha[last];
+	m_scale_x[index] = m_scale_x[last];
+	m_scale_y[index] = m_scale_y[last];
+	m_size_mod[index] = m_size_mod[last];
+	m_radians[index] = m_radians[last];
+	m_colour[index] = m_colour[last];
+	m_texture[index] = m_texture[last];
+}
+
+Texture ParticleRenderer::s_textures[(int)ParticleTexture::count];
+SharedInit ParticleRenderer::s_shared_init;
+
+bool ParticleRenderer::load_textures()
+{
+	for (int i = 0; i < (int)ParticleTexture::count; i++)
+	{
+		if (!s_textures[i].load_from_file(TEXTURE_PATHS[i]))
+		{
+			fprintf(stderr, "Failed to load particle texture %s!", TEXTURE_PATHS[i]);
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ParticleRenderer::init()
+{
+	if (!s_shared_init.run(load_textures))
+	{
+		return false;
+	}
+
+	if (!has_renderer())
+	{
+		return true;
+	}
+
+	// A unit quad, scaled to the particle's texture in the vertex shader
+	TexturedVertex vertices[4];
+	vertices[0].position = { -0.5f, +0.5f, -0.01f };
+	vertices[0].texcoord = { 0.f, 1.f };
+	vertices[1].position = { +0.5f, +0.5f, -0.01f };
+	vertices[1].texcoord = { 1.f, 1.f, };
+	vertices[2].position = { +0.5f, -0.5f, -0.01f };
+	vertices[2].texcoord = { 1.f, 0.f };
+	vertices[3].position = { -0.5f, -0.5f, -0.01f };
+	vertices[3].texcoord = { 0.f, 0.f };
+	uint16_t indices[] = { 0, 3, 1, 1, 3, 2 };
+
+	// Clearing errors
+	gl_flush_errors();
+
+	glGenBuffers(1, &m_quad_vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, m_quad_vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &m_quad_ibo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_quad_ibo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &m_instance_vbo);
+	m_instance_capacity = 0;
+
+	glGenVertexArrays(1, &m_vao);
+	glBindVertexArray(m_vao);
+	bind_quad();
+	bind_instances(m_instance_vbo, sizeof(ParticleInstance));
+	glBindVertexArray(0);
+
+	if (gl_has_errors())
+		return false;
+
+	if (!m_effect.load_from_file(shader_path("particle.vs.glsl"), shader_path("particle.fs.glsl")))
+	{
+		// it released itself
+		m_effect = Effect();
+		return false;
+	}
+	return true;
+}
+
+bool ParticleRenderer::init_gpu(size_t capacity)
+{
+	if (!has_renderer())
+	{
+		return false;
+	}
+
+	// Written in the order of GpuParticle's fields
+	std::vector<const char*> varyings = { "out_placement", "out_look", "out_colour", "out_motion", "out_shape" };
+	if (!m_update_effect.load_from_file(shader_path("particle_update.vs.glsl"), shader_path("particle_update.fs.glsl"), varyings))
+	{
+		m_update_effect = Effect();
+		return false;
+	}
+
+	gl_flush_errors();
+	m_gpu_simulated = true;
+
+	glGenBuffers(2, m_particle_vbos);
+	glGenVertexArrays(2, m_update_vaos);
+	glGenVertexArrays(2, m_draw_vaos);
+	for (int i = 0; i < 2; i++)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, m_particle_vbos[i]);
+		glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(GpuParticle), nullptr, GL_DYNAMIC_COPY);
+
+		// The pass reads every field of a particle, one vertex each
+		glBindVertexArray(m_update_vaos[i]);
+		GLsizei stride = sizeof(GpuParticle);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(GpuParticle, drawn.position));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(GpuParticle, drawn.radians));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(GpuParticle, drawn.colour));
+		glEnableVertexAttribArray(3);
+		glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(GpuParticle, velocity));
+		glEnableVertexAttribArray(4);
+		glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(GpuParticle, scale));
+
+		glBindVertexArray(m_draw_vaos[i]);
+		bind_quad();
+		bind_instances(m_particle_vbos[i], sizeof(GpuParticle));
+	}
+	glBindVertexArray(0);
+
+	m_source = 0;
+	m_slots = capacity;
+	m_next_slot = 0;
+	m_used_slots = 0;
+	m_spawns.reserve(capacity);
+
+	if (gl_has_errors())
+	{
+		destroy_gpu();
+		return false;
+	}
+	return true;
+}
+
+bool ParticleRenderer::is_gpu_simulated() const
+{
+	return m_gpu_simulated;
+}
+
+void ParticleRenderer::draw(const mat3& projection, const vec2& camera_shift, const std::vector<ParticleInstance>& particles,
+	const ParticleBatch& batch)
+{
+	if (m_gpu_simulated)
+	{
+		if (batch.frame != m_simulated_frame)
+		{
+			m_simulated_frame = batch.frame;
+			write_spawns(batch);
+			if (batch.elapsed_ms > 0.f && m_used_slots > 0)
+			{
+				simulate(batch.elapsed_ms);
+			}
+		}
+		if (m_used_slots > 0)
+		{
+			draw_instances(projection, camera_shift, m_draw_vaos[m_source], m_used_slots);
+		}
+		return;
+	}
+
+	if (particles.empty())
+	{
+		return;
+	}
+
+	// Respecifying the storage every frame lets the driver hand over a fresh buffer
+	// instead of waiting for the last frame's draw to finish reading this one
+	glBindBuffer(GL_ARRAY_BUFFER, m_instance_vbo);
+	m_instance_capacity = std::max(m_instance_capacity, particles.size());
+	glBufferData(GL_ARRAY_BUFFER, m_instance_capacity * sizeof(ParticleInstance), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, particles.size() * sizeof(ParticleInstance), particles.data());
+
+	draw_instances(projection, camera_shift, m_vao, particles.size());
+}
+
+void ParticleRenderer::destroy()
+{
+	if (!has_renderer())
+		return;
+
+	if (m_gpu_simulated)
+	{
+		destroy_gpu();
+	}
+
+	// Names are zeroed so a level whose init fails doesn't delete them twice
+	glDeleteBuffers(1, &m_instance_vbo);
+	glDeleteBuffers(1, &m_quad_ibo);
+	glDeleteBuffers(1, &m_quad_vbo);
+	glDeleteVertexArrays(1, &m_vao);
+	m_effect.release();
+	m_effect = Effect();
+	m_instance_vbo = m_quad_ibo = m_quad_vbo = m_vao = 0;
+	m_instance_capacity = 0;
+}
+
+void ParticleRenderer::bind_quad()
+{
+	glBindBuffer(GL_ARRAY_BUFFER, m_quad_vbo);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void*)0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void*)sizeof(vec3));
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_quad_ibo);
+}
+
+void ParticleRenderer::bind_instances(GLuint buffer, size_t stride)
+{
+	// The instance attributes move on once per particle instead of once per corner
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, (GLsizei)stride, (void*)offsetof(ParticleInstance, position));
+	glVertexAttribDivisor(2, 1);
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, (GLsizei)stride, (void*)offsetof(ParticleInstance, radians));
+	glVertexAttribDivisor(3, 1);
+	glEnableVertexAttribArray(4);
+	glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, (GLsizei)stride, (void*)offsetof(ParticleInstance, colour));
+	glVertexAttribDivisor(4, 1);
+}
+
+void ParticleRenderer::write_spawns(const ParticleBatch& batch)
+{
+	if (batch.cleared)
+	{
+		m_next_slot = 0;
+		m_used_slots = 0;
+	}
+
+	// More spawns than slots would write over each other, only the newest are kept
+	size_t count = std::min(batch.spawns.size(), m_slots);
+	if (count == 0)
+	{
+		return;
+	}
+	size_t first = batch.spawns.size() - count;
+
+	m_spawns.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		const ParticleSpawn& spawn = batch.spawns[first + i];
+		GpuParticle& particle = m_spawns[i];
+
+		// The pass moves every particle on by the whole batch's time, one emitted
+		// partway through starts that far back so it ends up where the CPU has it
+		float before_ms = batch.emitted_ms[first + i];
+		particle.drawn.position = sub(spawn.position, mul(spawn.velocity, before_ms / 1000.f));
+		particle.drawn.scale = spawn.scale;
+		particle.drawn.radians = spawn.radians;
+		particle.drawn.alpha = spawn.alpha;
+		particle.drawn.texture = (float)spawn.texture;
+		particle.drawn.colour = spawn.colour;
+		particle.velocity = spawn.velocity;
+		particle.age = -before_ms;
+		particle.life = spawn.life_ms;
+		particle.scale = spawn.scale;
+		particle.size_mod = spawn.size_mod;
+		particle.start_alpha = spawn.alpha;
+	}
+
+	// Up to the end of the ring, then on from its start
+	size_t before_end = std::min(count, m_slots - m_next_slot);
+	glBindBuffer(GL_ARRAY_BUFFER, m_particle_vbos[m_source]);
+	glBufferSubData(GL_ARRAY_BUFFER, m_next_slot * sizeof(GpuParticle), before_end * sizeof(GpuParticle), m_spawns.data());
+	if (before_end < count)
+	{
+		glBufferSubData(GL_ARRAY_BUFFER, 0, (count - before_end) * sizeof(GpuParticle), m_spawns.data() + before_end);
+	}
+
+	m_next_slot = (m_next_slot + count) % m_slots;
+	m_used_slots = std::min(m_used_slots + count, m_slots);
+}
+
+void ParticleRenderer::simulate(float elapsed_ms)
+{
+	int target = 1 - m_source;
+
+	glUseProgram(m_update_effect.program);
+	glUniform1f(glGetUniformLocation(m_update_effect.program, "elapsed_ms"), elapsed_ms);
+
+	// Only the captured outputs are wanted, nothing is drawn
+	glEnable(GL_RASTERIZER_DISCARD);
+	glBindVertexArray(m_update_vaos[m_source]);
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, m_particle_vbos[target]);
+	glBeginTransformFeedback(GL_POINTS);
+	glDrawArrays(GL_POINTS, 0, (GLsizei)m_used_slots);
+	glEndTransformFeedback();
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+	glBindVertexArray(0);
+	glDisable(GL_RASTERIZER_DISCARD);
+
+	m_source = target;
+}
+
+void ParticleRenderer::draw_instances(const mat3& projection, const vec2& camera_shift, GLuint vao, size_t count)
+{
+	glUseProgram(m_effect.program);
+
+	// Enabling alpha channel for textures
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDisable(GL_DEPTH_TEST);
+
+	float sizes[2 * (int)ParticleTexture::count];
+	for (int i = 0; i < (int)ParticleTexture::count; i++)
+	{
+		sizes[2 * i] = (float)s_textures[i].width;
+		sizes[2 * i + 1] = (float)s_textures[i].height;
+	}
+
+	glUniformMatrix3fv(glGetUniformLocation(m_effect.program, "projection"), 1, GL_FALSE, (float*)&projection);
+	glUniform2f(glGetUniformLocation(m_effect.program, "camera_shift"), camera_shift.x, camera_shift.y);
+	glUniform2fv(glGetUniformLocation(m_effect.program, "texture_sizes"), (int)ParticleTexture::count, sizes);
+
+	// One texture unit per particle texture
+	const char* samplers[] = { "smoke_large", "smoke_small", "ghost" };
+	for (int i = 0; i < (int)ParticleTexture::count; i++)
+	{
+		glActiveTexture(GL_TEXTURE0 + i);
+		glBindTexture(GL_TEXTURE_2D, s_textures[i].id);
+		glUniform1i(glGetUniformLocation(m_effect.program, samplers[i]), i);
+	}
+
+	// Drawing!
+	glBindVertexArray(vao);
+	glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, nullptr, (GLsizei)count);
+
+	glBindVertexArray(0);
+	glActiveTexture(GL_TEXTURE0);
+
+	if (gl_has_errors())
+	{
+		gl_flush_errors();
+	}
+}
+
+void ParticleRenderer::destroy_gpu()
+{
+	glDeleteVertexArrays(2, m_draw_vaos);
+	glDeleteVertexArrays(2, m_update_vaos);
+	glDeleteBuffers(2, m_particle_vbos);
+	m_update_effect.release();
+	m_update_effect = Effect();
+	for (int i = 0; i < 2; i++)
+	{
+		m_draw_vaos[i] = m_update_vaos[i] = m_particle_vbos[i] = 0;
+	}
+	m_gpu_simulated = false;
+	m_slots = m_next_slot = m_used_slots = 0;
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include "common.hpp"
+#include <vector>
+
+// Textures a particle can be drawn with
+enum class ParticleTexture { smoke_large, smoke_small, ghost, count };
+
+// How a new particle starts out
+struct ParticleSpawn
+{
+	vec2 position;
+	vec2 velocity; // pixels per second, particles don't accelerate
+	vec2 scale; // of the texture's size
+	float radians;
+	float alpha; // fades from this to nothing over its life
+	float life_ms;
+	float size_mod; // how much the scale pulses, 0 for not at all
+	vec3 colour;
+	ParticleTexture texture;
+};
+
+// One particle as drawing reads it, also the layout of an instance in the buffer the
+// particles are drawn from
+struct ParticleInstance
+{
+	vec2 position;
+	vec2 scale;
+	float radians;
+	float alpha;
+	float texture;
+	vec3 colour;
+};
+
+// One particle in the buffers the GPU simulates particles in. The transform feedback
+// pass moves and ages it and works out how it is drawn, so drawing reads the first
+// part like a ParticleInstance
+struct GpuParticle
+{
+	ParticleInstance drawn;
+	vec2 velocity;
+	float age;
+	float life;
+	vec2 scale; // without the pulse
+	float size_mod;
+	float start_alpha;
+};
+
+// Particles emitted and time passed since the last frame was captured, for the GPU to
+// simulate when it draws that frame
+struct ParticleBatch
+{
+	std::vector<ParticleSpawn> spawns;
+	std::vector<float> emitted_ms; // of elapsed_ms when each spawn was emitted
+	float elapsed_ms = 0.f;
+	bool cleared = false; // the particles from before the spawns are gone
+	uint64_t frame = 0; // counts batches taken, a frame drawn twice isn't simulated twice
+};
+
+// Pool of short lived particles kept as a structure of arrays. The live particles are
+// always the first size() of every array: one that fades out is swapped with the last
+// live one, so an update only walks live particles and nothing is shifted. Nothing is
+// allocated once the pool is reserved, emitting into a full pool drops the particle.
+// Particles are only looked at, they aren't in the state hash or the rewind history.
+// When the GPU simulates them the pool stays empty: spawns and time are only batched
+// up for the next frame drawn, and the CPU does no work per particle.
+class ParticleSystem
+{
+public:
+	// Makes room for capacity particles and empties the pool
+	void reserve(size_t capacity);
+
+	// Whether the particles are simulated by the GPU, empties the pool
+	void set_gpu_simulated(bool gpu_simulated);
+	bool is_gpu_simulated() const;
+
+	// Adds a particle, returns false if the pool is full
+	bool emit(const ParticleSpawn& spawn);
+
+	// Moves and ages every particle, the ones that faded out are let go
+	void update(float elapsed_ms);
+
+	// Copies what drawing reads of every live particle into instances
+	void capture(std::vector<ParticleInstance>& instances) const;
+
+	// Hands what was batched up for the GPU since the last call over to batch, and
+	// starts a new batch in batch's old storage
+	void take_batch(ParticleBatch& batch);
+
+	void clear();
+
+	size_t size() const;
+	size_t capacity() const;
+
+private:
+	// Moves the last live particle into index
+	void remove(size_t index);
+
+	bool m_gpu_simulated = false;
+	ParticleBatch m_batch;
+	uint64_t m_batches_taken = 0;
+
+	size_t m_count = 0;
+	std::vector<float> m_position_x;
+	std::vector<float> m_position_y;
+	std::vector<float> m_velocity_x;
+	std::vector<float> m_velocity_y;
+	std::vector<float> m_age;
+	std::vector<float> m_life;
+	std::vector<float> m_alpha;
+	std::vector<float> m_scale_x;
+	std::vector<float> m_scale_y;
+	std::vector<float> m_size_mod;
+	std::vector<float> m_radians;
+	std::vector<vec3> m_colour;
+	std::vector<uint8_t> m_texture;
+};
+
+// Draws every particle of a frame with one instanced draw call. Each instance is a
+// ParticleInstance stretching a quad shared by all of them.
+// With GPU particles the instances are GpuParticles in two buffers: a transform
+// feedback pass reads one, simulates the frame's elapsed time and writes the other,
+// which is then drawn directly. New particles are written over the oldest in a ring
+// of slots, so the buffers never move and the CPU only touches the spawns.
+class ParticleRenderer
+{
+	static Texture s_textures[(int)ParticleTexture::count];
+	static SharedInit s_shared_init;
+
+	// Loads the textures every renderer shares, once for all worlds
+	static bool load_textures();
+
+public:
+	// Loads the textures and shaders, and makes the quad and the instance buffer
+	bool init();
+
+	// Also makes the buffers and the feedback pass for simulating capacity particles
+	// on the GPU, returns false if the driver can't and particles stay on the CPU
+	bool init_gpu(size_t capacity);
+
+	bool is_gpu_simulated() const;
+
+	// Draws particles, or with GPU particles simulates batch and draws the result
+	void draw(const mat3& projection, const vec2& camera_shift, const std::vector<ParticleInstance>& particles,
+		const ParticleBatch& batch);
+
+	// Releases all graphics resources
+	void destroy();
+
+private:
+	// Sets the corner attributes of the bound vertex array to read the quad
+	void bind_quad();
+
+	// Sets the instance attributes of the bound vertex array to read buffer, a
+	// ParticleInstance every stride bytes
+	void bind_instances(GLuint buffer, size_t stride);
+
+	// Writes batch's spawns into the slots of the buffer the next pass reads
+	void write_spawns(const ParticleBatch& batch);
+
+	// Moves every particle in the slots on by elapsed_ms, into the other buffer
+	void simulate(float elapsed_ms);
+
+	void draw_instances(const mat3& projection, const vec2& camera_shift, GLuint vao, size_t count);
+
+	// Releases what init_gpu() made, particles are drawn from the CPU again
+	void destroy_gpu();
+
+	Effect m_effect = Effect();
+	GLuint m_vao = 0;
+	GLuint m_quad_vbo = 0;
+	GLuint m_quad_ibo = 0;
+	GLuint m_instance_vbo = 0;
+	size_t m_instance_capacity = 0; // instances the buffer has room for
+
+	// GPU particles, the pass reads m_particle_vbos[m_source] into the other one
+	bool m_gpu_simulated = false;
+	Effect m_update_effect = Effect();
+	GLuint m_particle_vbos[2] = { 0, 0 };
+	GLuint m_update_vaos[2] = { 0, 0 };
+	GLuint m_draw_vaos[2] = { 0, 0 };
+	int m_source = 0;
+	uint64_t m_simulated_frame = 0;
+	size_t m_slots = 0; // particles the buffers have room for
+	size_t m_next_slot = 0; // oldest particle, the next spawn goes here
+	size_t m_used_slots = 0; // slots written since the buffers were cleared
+	std::vector<GpuParticle> m_spawns;
+};
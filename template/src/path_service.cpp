@@ -0,0 +1,147 @@
+#include "path_service.hpp"
+
+namespace
+{
+	// A request per ghost of the largest level, plenty for a colour change
+	const size_t QUEUE_CAPACITY = 1024;
+}
+
+const uint32_t PathService::ANSWER_TICKS;
+
+PathService::PathService() :
+	m_running(false),
+	m_requests(QUEUE_CAPACITY),
+	m_results(QUEUE_CAPACITY)
+{
+}
+
+PathService::~PathService()
+{
+	stop();
+}
+
+void PathService::start(const LevelGraph* graph)
+{
+	stop();
+
+	m_graph = graph;
+	m_running = true;
+	m_worker = std::thread(&PathService::work, this);
+}
+
+void PathService::stop()
+{
+	if (!m_worker.joinable())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_running = false;
+	}
+	m_wake.notify_one();
+	m_worker.join();
+	m_due.clear();
+
+	// Both ends are ours again
+	Request request;
+	while (m_requests.pop(request)) {}
+	Result result;
+	while (m_results.pop(result)) {}
+}
+
+bool PathService::submit(const Request& request)
+{
+	// Counted before the worker can see it, so the answer always finds it
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_due.push_back(request.due);
+	if (!m_requests.push(request))
+	{
+		m_due.pop_back();
+		return false;
+	}
+	return true;
+}
+
+void PathService::flush()
+{
+	// Taking the lock makes sure the worker is either asleep or hasn't checked the
+	// queue yet, so the notify can't get lost
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+	}
+	m_wake.notify_one();
+}
+
+void PathService::wait()
+{
+	if (!m_worker.joinable())
+	{
+		return;
+	}
+
+	// In case nothing flushed the last requests, the worker would sleep on them
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_wake.notify_one();
+	m_answered.wait(lock, [this] { return m_due.empty(); });
+}
+
+void PathService::wait(uint32_t tick)
+{
+	if (!m_worker.joinable())
+	{
+		return;
+	}
+
+	// Requests are answered in the order they are due, the oldest one left decides
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_wake.notify_one();
+	m_answered.wait(lock, [this, tick] { return m_due.empty() || m_due.front() > tick; });
+}
+
+bool PathService::collect(Result& result)
+{
+	return m_results.pop(result);
+}
+
+void PathService::work()
+{
+	Request request;
+	while (true)
+	{
+		if (!m_requests.pop(request))
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [this] { return !m_running || !m_requests.empty(); });
+			if (!m_running)
+			{
+				return;
+			}
+			continue;
+		}
+
+		Result result = { request.client, request.serial, request.due, request.channel, LevelGraph::UNREACHABLE };
+		if (request.field)
+		{
+			result.target = FlowField::enter(*m_graph, *request.field, request.goal, request.start, request.channel);
+		}
+
+		// There are never more answers than requests, which fit the queue, so a full
+		// queue only lasts until the game collects
+		while (!m_results.push(result))
+		{
+			if (!m_running)
+			{
+				return;
+			}
+			std::this_thread::yield();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_due.pop_front();
+		}
+		m_answered.notify_one();
+	}
+}
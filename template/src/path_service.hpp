@@ -0,0 +1,89 @@
+#pragma once
+
+#include "common.hpp"
+#include "flow_field.hpp"
+#include "spsc_queue.hpp"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Finds ways onto the flow field for ghosts on a worker thread. The game thread
+// submits requests during an update, each naming the update its answer is due on,
+// ANSWER_TICKS later; until then the ghost keeps going the way it was. That update
+// waits for the answers due and holds back any that came early, so an answer always
+// arrives on the same update no matter how the threads were scheduled, and runs stay
+// deterministic. The worker only holds an update up when it is that far behind.
+// Requests carry the field they are answered against, so the game is free to rebuild
+// fields meanwhile.
+class PathService
+{
+public:
+	struct Request
+	{
+		int client; // who the answer goes back to
+		uint32_t serial; // lets the client drop answers it no longer wants
+		uint32_t due; // update the answer is taken on
+		vec2 start;
+		vec2 goal;
+		uint8_t channel;
+		std::shared_ptr<const FlowField::Field> field;
+	};
+
+	struct Result
+	{
+		int client;
+		uint32_t serial;
+		uint32_t due;
+		uint8_t channel;
+		int target; // as returned by FlowField::enter
+	};
+
+	// Updates between the one a request is made on and the one its answer is taken on
+	static const uint32_t ANSWER_TICKS = 3;
+
+	PathService();
+	~PathService();
+
+	// Starts the worker on a level's graph, which must not change until stop()
+	void start(const LevelGraph* graph);
+
+	// Stops the worker, anything not collected yet is thrown away
+	void stop();
+
+	// Queues a request, returns false if the queue is full. Nothing is looked at
+	// until flush(). Requests must be submitted in order of their due updates
+	bool submit(const Request& request);
+
+	// Wakes the worker for everything submitted so far
+	void flush();
+
+	// Blocks until every request submitted so far has been answered
+	void wait();
+
+	// Blocks until every request due on or before update tick has been answered
+	void wait(uint32_t tick);
+
+	// Takes the next answer, false if there is none yet
+	bool collect(Result& result);
+
+private:
+	void work();
+
+	const LevelGraph* m_graph = nullptr;
+	std::thread m_worker;
+	std::atomic<bool> m_running;
+
+	SpscQueue<Request> m_requests;
+	SpscQueue<Result> m_results;
+
+	// Due updates of the requests submitted but not answered yet, oldest first,
+	// guarded by m_mutex
+	std::deque<uint32_t> m_due;
+
+	// Used to sleep on while there are no requests, and while waiting for answers
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_answered;
+};
@@ -0,0 +1,60 @@
+#include "random.hpp"
+#include "world_context.hpp"
+
+namespace
+{
+	// splitmix64, spreads a master seed into well mixed per stream seeds
+	uint64_t mix_seed(uint64_t x)
+	{
+		x += 0x9E3779B97F4A7C15ull;
+		x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+		x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+		return x ^ (x >> 31);
+	}
+}
+
+RandomStream::RandomStream()
+{
+	seed(0);
+}
+
+void RandomStream::seed(uint64_t seed)
+{
+	m_state = mix_seed(seed);
+	// xorshift gets stuck on a zero state
+	if (m_state == 0)
+		m_state = 0x9E3779B97F4A7C15ull;
+}
+
+uint32_t RandomStream::next()
+{
+	m_state ^= m_state >> 12;
+	m_state ^= m_state << 25;
+	m_state ^= m_state >> 27;
+	return (uint32_t)((m_state * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+float RandomStream::uniform()
+{
+	// 24 bits is all a float can hold exactly
+	return (float)(next() >> 8) * (1.f / 16777216.f);
+}
+
+float RandomStream::uniform(float low, float high)
+{
+	return low + uniform() * (high - low);
+}
+
+RandomStream& random_stream(RandomStreamId id)
+{
+	return get_world_context().random_streams[(int)id];
+}
+
+void seed_random_streams(uint64_t seed)
+{
+	RandomStream* streams = get_world_context().random_streams;
+	for (int i = 0; i < (int)RandomStreamId::count; i++)
+	{
+		streams[i].seed(seed ^ mix_seed((uint64_t)i + 1));
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+
+// Seedable pseudo random number stream (xorshift64*).
+// Every subsystem that needs randomness draws from its own stream, so adding a
+// random call in one place can't shift the numbers another subsystem sees, and a
+// run started from the same seed with the same input plays out exactly the same.
+class RandomStream
+{
+public:
+	RandomStream();
+
+	// Restarts the stream from seed
+	void seed(uint64_t seed);
+
+	// Next 32 random bits
+	uint32_t next();
+
+	// Uniform float in [0, 1)
+	float uniform();
+
+	// Uniform float in [low, high)
+	float uniform(float low, float high);
+
+private:
+	uint64_t m_state;
+};
+
+// please add to this enum whenever a new subsystem needs its own stream
+enum class RandomStreamId { smoke, embers, count };
+
+// Gets the stream owned by a subsystem in the calling thread's world context
+RandomStream& random_stream(RandomStreamId id);
+
+// Seeds every stream of the calling thread's world context from one master seed
+void seed_random_streams(uint64_t seed);
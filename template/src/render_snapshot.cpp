@@ -0,0 +1,16 @@
+#include "render_snapshot.hpp"
+
+RenderSnapshot& RenderBuffers::back()
+{
+	return m_snapshots[1 - m_front];
+}
+
+const RenderSnapshot& RenderBuffers::front() const
+{
+	return m_snapshots[m_front];
+}
+
+void RenderBuffers::publish()
+{
+	m_front = 1 - m_front;
+}
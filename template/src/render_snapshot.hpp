@@ -0,0 +1,38 @@
+#pragma once
+
+#include "common.hpp"
+#include "systems.hpp"
+#include "light.hpp"
+#include "particle_system.hpp"
+#include <vector>
+
+// Everything drawing a frame of the level reads that the simulation changes
+struct RenderSnapshot
+{
+	std::vector<SpriteState> sprites;
+	std::vector<ParticleInstance> particles;
+	ParticleBatch particle_batch; // instead of particles when the GPU simulates them
+	LightState light;
+	vec2 camera_pos;
+};
+
+// Two render snapshots, the simulation captures into the back one while the front
+// one is drawn. publish() swaps them and must only be called while neither side is
+// using them, between frames; the vectors keep their storage so capturing stops
+// allocating once both have seen the level.
+class RenderBuffers
+{
+public:
+	// Snapshot the simulation captures into
+	RenderSnapshot& back();
+
+	// Snapshot being drawn
+	const RenderSnapshot& front() const;
+
+	// Makes the last captured snapshot the one drawn
+	void publish();
+
+private:
+	RenderSnapshot m_snapshots[2];
+	int m_front = 0;
+};
@@ -1,19 +1,16 @@
 #include "sign.hpp"
+#include "world_context.hpp"
 
 Texture Sign::s_sign_texture;
+SharedInit Sign::s_shared_init;
 
 bool Sign::init(int id, std::string sign_text, vec2 position)
 {
+	WorldContext& world = get_world_context();
 	m_id = id;
 
-	if (!s_sign_texture.is_valid())
-	{
-		if (!s_sign_texture.load_from_file(textures_path("sign.png")))
-		{
-			fprintf(stderr, "Failed to load sign texture!");
-			return false;
-		}
-	}
+	if (!s_shared_init.run(load_textures))
+		return false;
 
 	rc.texture = &s_sign_texture;
 
@@ -23,14 +20,24 @@ bool Sign::init(int id, std::string sign_text, vec2 position)
 	mc.position = position;
 	mc.physics.scale = { brick_size / rc.texture->width, brick_size / rc.texture->height };
 
-	s_render_components[id] = &rc;
-	s_motion_components[id] = &mc;
+	world.render_components.insert(id, &rc);
+	world.motion_components.insert(id, &mc);
 
 	hide_text();
 
 	calculate_hitbox();
 
-	return m_text.init(id + 1, sign_text, position);
+	return m_text.init(world.entities.create(), sign_text, position);
+}
+
+bool Sign::load_textures()
+{
+	if (!s_sign_texture.load_from_file(textures_path("sign.png")))
+	{
+		fprintf(stderr, "Failed to load sign texture!");
+		return false;
+	}
+	return true;
 }
 
 Hitbox Sign::get_hitbox() const
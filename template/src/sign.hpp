@@ -7,6 +7,10 @@
 class Sign : public Entity
 {
 	static Texture s_sign_texture;
+	static SharedInit s_shared_init;
+
+	// Loads the textures every sign shares, once for all worlds
+	static bool load_textures();
 
 	RenderComponent rc;
 	MotionComponent mc;
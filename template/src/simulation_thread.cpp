@@ -0,0 +1,53 @@
+#include "simulation_thread.hpp"
+
+SimulationThread::SimulationThread()
+{
+	m_thread = std::thread(&SimulationThread::work, this);
+}
+
+SimulationThread::~SimulationThread()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_wake.notify_one();
+	m_thread.join();
+}
+
+void SimulationThread::start(std::function<void()> frame)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_frame = std::move(frame);
+		m_busy = true;
+	}
+	m_wake.notify_one();
+}
+
+void SimulationThread::wait()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done.wait(lock, [this] { return !m_busy; });
+}
+
+void SimulationThread::work()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		m_wake.wait(lock, [this] { return m_stopping || m_busy; });
+		if (m_stopping)
+		{
+			return;
+		}
+
+		std::function<void()> frame = std::move(m_frame);
+		lock.unlock();
+		frame();
+		lock.lock();
+
+		m_busy = false;
+		m_done.notify_one();
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Thread the simulation ticks of a frame run on, so the main thread, which owns the
+// window and the GL context, draws the last frame meanwhile. Between start() and
+// wait() only the simulation thread may touch game state; input, loading and frame
+// scheduler tasks all happen outside that window.
+class SimulationThread
+{
+public:
+	SimulationThread();
+	~SimulationThread();
+
+	// Runs frame on the simulation thread, the last frame must have been waited for
+	void start(std::function<void()> frame);
+
+	// Returns once the frame passed to start() is done
+	void wait();
+
+private:
+	void work();
+
+	std::thread m_thread;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+	std::function<void()> m_frame;
+	bool m_busy = false;
+	bool m_stopping = false;
+};
@@ -0,0 +1,71 @@
+#include "snapshot.hpp"
+
+// Snapshots are hashed as raw bytes, so they must not contain any padding
+static_assert(sizeof(RobotState) == 11 * 4, "RobotState has padding");
+static_assert(sizeof(FlowFieldState) == 16 * 4, "FlowFieldState has padding");
+static_assert(sizeof(LevelSnapshot) == 6 * 4 + sizeof(RobotState) + sizeof(FlowFieldState), "LevelSnapshot has padding");
+static_assert(sizeof(GhostState) == 17 * 4, "GhostState has padding");
+
+uint64_t hash_snapshot(const LevelSnapshot& snapshot, const GhostState* ghosts)
+{
+	uint64_t hash = hash_bytes(&snapshot, sizeof(snapshot));
+	return hash_bytes(ghosts, snapshot.ghost_count * sizeof(GhostState), hash);
+}
+
+void SnapshotRing::reset(size_t capacity, size_t ghost_count)
+{
+	m_ghost_count = ghost_count;
+	m_headers.assign(capacity, LevelSnapshot());
+	m_ghosts.assign(capacity * ghost_count, GhostState());
+	clear();
+}
+
+void SnapshotRing::clear()
+{
+	m_head = 0;
+	m_size = 0;
+}
+
+bool SnapshotRing::push(size_t& slot)
+{
+	if (m_headers.empty())
+		return false;
+
+	slot = m_head;
+	m_head = (m_head + 1) % m_headers.size();
+	if (m_size < m_headers.size())
+		m_size++;
+	return true;
+}
+
+bool SnapshotRing::pop()
+{
+	if (m_size == 0)
+		return false;
+
+	m_head = (m_head + m_headers.size() - 1) % m_headers.size();
+	m_size--;
+	return true;
+}
+
+size_t SnapshotRing::size() const
+{
+	return m_size;
+}
+
+size_t SnapshotRing::newest() const
+{
+	return (m_head + m_headers.size() - 1) % m_headers.size();
+}
+
+LevelSnapshot& SnapshotRing::header(size_t slot)
+{
+	return m_headers[slot];
+}
+
+GhostState* SnapshotRing::ghosts(size_t slot)
+{
+	if (m_ghost_count == 0)
+		return nullptr;
+	return &m_ghosts[slot * m_ghost_count];
+}
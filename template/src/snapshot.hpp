@@ -0,0 +1,104 @@
+#pragma once
+
+#include "common.hpp"
+#include <vector>
+#include <stdint.h>
+
+// Plain copies of the parts of a level that change while it is being played.
+// Everything in here is trivially copyable, so taking or restoring a snapshot is a
+// handful of small copies and never allocates once the ring is sized for the level.
+// Input driven state (held keys, whether the rocket is firing, the mouse aimed
+// headlight) is deliberately left out, it always follows the player.
+
+struct RobotState
+{
+	vec2 position;
+	vec2 velocity;
+	float radians;
+	vec2 head_position;
+	vec2 head_velocity;
+	float available_flight_time;
+	uint32_t grounded;
+};
+
+struct GhostState
+{
+	vec2 position;
+	float facing; // sign of the x scale, ghosts flip to face where they are going
+	vec2 step_velocity; // of the step the last update took, ghosts that update less often are still taking it
+	vec2 crowd_position; // where the level's crowd last had it, the next update reads who is in range off it
+
+	// Where the ghost is heading on the flow field, see Ghost
+	vec2 goal;
+	vec2 anchor;
+	int32_t target;
+	int32_t lost_at;
+	vec2 request_start; // of the request still waiting for an answer, it is sent again on load
+	uint32_t request_due; // update that answer is taken on
+	uint8_t nav_channel;
+	uint8_t via_anchor;
+	uint8_t waiting;
+	uint8_t reenter;
+};
+
+// The fields themselves aren't kept, a field only depends on the channel and its
+// anchor so it is built again when the one in use has another anchor
+struct FlowFieldState
+{
+	vec2 goal;
+	int32_t goal_cell_x;
+	int32_t goal_cell_y;
+	vec2 anchors[4]; // of the field of each channel
+	uint8_t built[4]; // the channel has a field that is up to date
+	uint8_t moved[4]; // the robot has changed cell since the channel checked its drift
+	int32_t rebuild_count;
+	int32_t rebuilds_avoided;
+};
+
+struct LevelSnapshot
+{
+	uint32_t tick;
+	vec3 headlight_channel;
+	uint32_t nav_channel;
+	RobotState robot;
+	FlowFieldState flow_field;
+	uint32_t ghost_count;
+};
+
+// Hashes a snapshot, two runs that end in the same state produce the same hash
+uint64_t hash_snapshot(const LevelSnapshot& snapshot, const GhostState* ghosts);
+
+// Fixed size ring of the most recent level snapshots, used for rewinding.
+// Ghost states live in one flat array next to the headers, ghost_count per slot.
+class SnapshotRing
+{
+public:
+	// Throws away everything and sizes the ring for a level with ghost_count ghosts
+	void reset(size_t capacity, size_t ghost_count);
+
+	// Forget the stored snapshots but keep the storage
+	void clear();
+
+	// Sets slot to the slot for a new snapshot, overwriting the oldest one if full.
+	// Returns false if the ring was never sized and there is no slot to take
+	bool push(size_t& slot);
+
+	// Drops the newest snapshot, returns false if the ring is empty
+	bool pop();
+
+	// Number of snapshots currently stored
+	size_t size() const;
+
+	// Slot of the newest snapshot, only valid if size() > 0
+	size_t newest() const;
+
+	LevelSnapshot& header(size_t slot);
+	GhostState* ghosts(size_t slot);
+
+private:
+	std::vector<LevelSnapshot> m_headers;
+	std::vector<GhostState> m_ghosts;
+	size_t m_ghost_count = 0;
+	size_t m_head = 0;
+	size_t m_size = 0;
+};
@@ -1,13 +1,14 @@
 #pragma once
 
 #include "common.hpp"
+#include "audio.hpp"
 #include <SDL.h>
 #include <SDL_mixer.h>
 
 #include "vector"
 
 // a singleton implementation of the SoundSystem
-class SoundSystem {
+class SoundSystem : public Audio {
 
 	public:
 	typedef std::map<Sound_Effects, int> EffectChannelMap;
@@ -18,15 +19,15 @@ class SoundSystem {
 	void free_sounds();
 
 	// changes the current background music
-	void play_bgm(Music bgm);
+	void play_bgm(Music bgm) override;
 
 	// plays a sound effect
 	// if an effect's loop is -1, adds the channel on which the effect is played to m_effect_channels
-	void play_sound_effect(Sound_Effects sound_effect, int loops = 0, int fade_in_ms = 0, int channel = -1);
+	void play_sound_effect(Sound_Effects sound_effect, int loops = 0, int fade_in_ms = 0, int channel = -1) override;
 
 	// stops the sound effect from playing on all channels
 	// removes the sound effect from m_effect_channels, if the sound effect is in the map
-	void stop_sound_effect(Sound_Effects sound_effect, int fade_out_ms);
+	void stop_sound_effect(Sound_Effects sound_effect, int fade_out_ms) override;
 
 	// pause all sound effects, used when opening the menu during a sound effect
 	void pause_all_sound_effects();
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+// Fixed capacity queue between exactly one producer thread and one consumer thread.
+// Neither side ever takes a lock: each owns one end of a ring and publishes it with
+// a release store that the other side reads with an acquire load.
+template <typename T>
+class SpscQueue
+{
+public:
+	explicit SpscQueue(size_t capacity) :
+		m_slots(capacity + 1),
+		m_head(0),
+		m_tail(0)
+	{
+	}
+
+	// Producer only. Returns false if the queue is full
+	bool push(const T& item)
+	{
+		size_t tail = m_tail.load(std::memory_order_relaxed);
+		size_t next = advance(tail);
+		if (next == m_head.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+
+		m_slots[tail] = item;
+		m_tail.store(next, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer only. Returns false if the queue is empty
+	bool pop(T& item)
+	{
+		size_t head = m_head.load(std::memory_order_relaxed);
+		if (head == m_tail.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+
+		// The slot is reset so it doesn't hold on to anything until it is reused
+		item = std::move(m_slots[head]);
+		m_slots[head] = T();
+		m_head.store(advance(head), std::memory_order_release);
+		return true;
+	}
+
+	// Either side, only a hint while the other side is busy
+	bool empty() const
+	{
+		return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+	}
+
+private:
+	size_t advance(size_t index) const
+	{
+		return index + 1 == m_slots.size() ? 0 : index + 1;
+	}
+
+	// One slot always stays empty so a full ring can be told from an empty one
+	std::vector<T> m_slots;
+	std::atomic<size_t> m_head;
+	std::atomic<size_t> m_tail;
+};
@@ -1,13 +1,26 @@
 #include "systems.hpp"
+#include "world_context.hpp"
 
 void RenderingSystem::render(const mat3& projection, const vec2& camera_shift, vec3 headlight_channel)
 {
-	for (auto& entity : level_entities)
+	capture(live_sprites);
+	render(projection, camera_shift, live_sprites, headlight_channel);
+}
+
+void RenderingSystem::render(const mat3& projection, const vec2& camera_shift, const std::vector<SpriteState>& sprites,
+	vec3 headlight_channel)
+{
+	WorldContext& world = get_world_context();
+	for (auto& sprite : sprites)
 	{
-		RenderComponent* rc = s_render_components[entity];
-		MotionComponent* mc = s_motion_components[entity];
+		if (!world.entities.is_alive(sprite.entity))
+		{
+			continue;
+		}
+
+		RenderComponent* rc = world.render_components.get(sprite.entity.id);
 
-		if (!rc->render || len(sub(mul(sub(camera_shift, { 600.f, 400.f }), -1.f), mc->position)) > 30.f * brick_size)
+		if (!sprite.render || len(sub(mul(sub(camera_shift, { 600.f, 400.f }), -1.f), sprite.position)) > 30.f * brick_size)
 		{
 			continue;
 		}
@@ -16,12 +29,12 @@ void RenderingSystem::render(const mat3& projection, const vec2& camera_shift, v
 		// Incrementally updates transformation matrix, thus ORDER IS IMPORTANT
 		rc->transform.begin();
 		rc->transform.translate(camera_shift);
-		rc->transform.translate(mc->position);
-		rc->transform.rotate(mc->radians);
-		rc->transform.scale(mc->physics.scale);
+		rc->transform.translate(sprite.position);
+		rc->transform.rotate(sprite.radians);
+		rc->transform.scale(sprite.scale);
 		rc->transform.end();
 
-		rc->draw_sprite_alpha(projection, rc->alpha, headlight_channel);
+		rc->draw_sprite_alpha(projection, sprite.alpha, headlight_channel);
 	}
 
 	if (gl_has_errors())
@@ -30,12 +43,35 @@ void RenderingSystem::render(const mat3& projection, const vec2& camera_shift, v
 	}
 }
 
+void RenderingSystem::capture(std::vector<SpriteState>& sprites) const
+{
+	WorldContext& world = get_world_context();
+	sprites.clear();
+	for (auto& entity : level_entities)
+	{
+		if (!world.entities.is_alive(entity))
+		{
+			continue;
+		}
+
+		const RenderComponent* rc = world.render_components.get(entity.id);
+		const MotionComponent* mc = world.motion_components.get(entity.id);
+		sprites.push_back({ entity, mc->position, mc->radians, mc->physics.scale, rc->alpha, rc->render });
+	}
+}
+
 void RenderingSystem::render_ui(const mat3& projection, const vec2& camera_shift)
 {
+    WorldContext& world = get_world_context();
     for (auto& entity : menu_entities)
     {
-        RenderComponent* rc = s_ui_render_components[entity];
-        MotionComponent* mc = s_ui_motion_components[entity];
+        if (!world.entities.is_alive(entity))
+        {
+            continue;
+        }
+
+        RenderComponent* rc = world.ui_render_components.get(entity.id);
+        MotionComponent* mc = world.ui_motion_components.get(entity.id);
 
         if (!rc->render)
         {
@@ -54,47 +90,41 @@ void RenderingSystem::render_ui(const mat3& projection, const vec2& camera_shift
     }
 }
 
-void RenderingSystem::process(int min, int max)
+void RenderingSystem::process(const std::vector<int>& ids)
 {
-	for (int i = min; i < max; i++)
+	for (int id : ids)
 	{
-		if (s_render_components.find(i) != s_render_components.end() &&
-			s_motion_components.find(i) != s_motion_components.end())
-		{
-			level_entities.push_back(i);
-		}
-
-		if (s_ui_render_components.find(i) != s_ui_render_components.end() &&
-			s_ui_motion_components.find(i) != s_ui_motion_components.end())
-		{
-			menu_entities.push_back(i);
-		}
+		add(id);
 	}
 }
 
 void RenderingSystem::add(int id)
 {
-	if (s_render_components.find(id) != s_render_components.end() &&
-		s_motion_components.find(id) != s_motion_components.end())
+	WorldContext& world = get_world_context();
+	if (world.render_components.contains(id) &&
+		world.motion_components.contains(id))
 	{
-		level_entities.push_back(id);
+		level_entities.push_back(world.entities.get_handle(id));
 	}
 
-	if (s_ui_render_components.find(id) != s_ui_render_components.end() &&
-		s_ui_motion_components.find(id) != s_ui_motion_components.end())
+	if (world.ui_render_components.contains(id) &&
+		world.ui_motion_components.contains(id))
 	{
-		menu_entities.push_back(id);
+		menu_entities.push_back(world.entities.get_handle(id));
 	}
 }
 
 void RenderingSystem::remove(int id, bool clean)
 {
-	auto it = std::find(level_entities.begin(), level_entities.end(), id);
+	WorldContext& world = get_world_context();
+	auto has_id = [id](const EntityHandle& entity) { return entity.id == id; };
+
+	auto it = std::find_if(level_entities.begin(), level_entities.end(), has_id);
 	if (it != level_entities.end())
 	{
-		if (clean)
+		if (clean && has_renderer())
 		{
-			RenderComponent* rc = s_render_components[id];
+			RenderComponent* rc = world.render_components.get(id);
 
 			glDeleteBuffers(1, &rc->mesh.vbo);
 			glDeleteBuffers(1, &rc->mesh.ibo);
@@ -107,12 +137,12 @@ void RenderingSystem::remove(int id, bool clean)
 
 		level_entities.erase(it);
 	}
-	it = std::find(menu_entities.begin(), menu_entities.end(), id);
+	it = std::find_if(menu_entities.begin(), menu_entities.end(), has_id);
 	if (it != menu_entities.end())
 	{
-		if (clean)
+		if (clean && has_renderer())
 		{
-			RenderComponent* rc = s_ui_render_components[id];
+			RenderComponent* rc = world.ui_render_components.get(id);
 
 			glDeleteBuffers(1, &rc->mesh.vbo);
 			glDeleteBuffers(1, &rc->mesh.ibo);
@@ -129,9 +159,20 @@ void RenderingSystem::remove(int id, bool clean)
 
 void RenderingSystem::destroy()
 {
+	if (!has_renderer())
+	{
+		return;
+	}
+
+	WorldContext& world = get_world_context();
 	for (auto& entity : level_entities)
 	{
-		RenderComponent* rc = s_render_components[entity];
+		if (!world.entities.is_alive(entity))
+		{
+			continue;
+		}
+
+		RenderComponent* rc = world.render_components.get(entity.id);
 
 		glDeleteBuffers(1, &rc->mesh.vbo);
 		glDeleteBuffers(1, &rc->mesh.ibo);
@@ -144,7 +185,12 @@ void RenderingSystem::destroy()
 
 	for (auto& entity : menu_entities)
 	{
-		RenderComponent* rc = s_ui_render_components[entity];
+		if (!world.entities.is_alive(entity))
+		{
+			continue;
+		}
+
+		RenderComponent* rc = world.ui_render_components.get(entity.id);
 
 		glDeleteBuffers(1, &rc->mesh.vbo);
 		glDeleteBuffers(1, &rc->mesh.ibo);
@@ -4,16 +4,40 @@
 #include <algorithm>
 #include "components.hpp"
 
+// Copy of what drawing an entity reads that the simulation changes, so a frame can be
+// drawn while the next one is simulated. Texture, colour and the hidden flags only
+// change on input, between frames, and are read from the entity as before
+struct SpriteState
+{
+	EntityHandle entity;
+	vec2 position;
+	float radians;
+	vec2 scale;
+	float alpha;
+	bool render;
+};
+
 class RenderingSystem
 {
 private:
-	std::vector<int> level_entities;
-	std::vector<int> menu_entities;
+	// Handles rather than ids, an entity released elsewhere is skipped instead of
+	// drawing whatever entity its recycled id was handed to next
+	std::vector<EntityHandle> level_entities;
+	std::vector<EntityHandle> menu_entities;
+
+	// Scratch for drawing straight from the components
+	std::vector<SpriteState> live_sprites;
 
 public:
     void render_ui(const mat3& projection, const vec2& camera_shift);
     void render(const mat3& projection, const vec2& camera_shift, vec3 headlight_channel);
-	void process(int min, int max);
+	// Draws the level entities as they were when sprites was captured
+	void render(const mat3& projection, const vec2& camera_shift, const std::vector<SpriteState>& sprites,
+		vec3 headlight_channel);
+	// Copies the state of the live level entities into sprites
+	void capture(std::vector<SpriteState>& sprites) const;
+	// Adds the drawable entities among ids, in the given order
+	void process(const std::vector<int>& ids);
 	void add(int id);
 	void remove(int id, bool clean);
 	void destroy();
@@ -1,8 +1,10 @@
 #include "text.hpp"
+#include "world_context.hpp"
 
 // TODO: render actual text
 bool Text::init(int id, std::string sign_text, vec2 position)
 {
+	WorldContext& world = get_world_context();
 	m_id = id;
 
 	if (!m_text_texture.is_valid())
@@ -51,8 +53,8 @@ bool Text::init(int id, std::string sign_text, vec2 position)
 	mc.position.y -= 130.f;
 	mc.physics.scale = { 1.5f, 1.5f };
 
-	s_render_components[id] = &rc;
-	s_motion_components[id] = &mc;
+	world.render_components.insert(id, &rc);
+	world.motion_components.insert(id, &mc);
 
 	return true;
 }
@@ -1,25 +1,17 @@
 #include "torch.hpp"
+#include "world_context.hpp"
 
 Texture Torch::torch_texture;
 RenderComponent Torch::rc;
+SharedInit Torch::shared_init;
 
 bool Torch::init(int id)
 {
+    WorldContext& world = get_world_context();
     m_id = id;
 
-    if (!torch_texture.is_valid())
-    {
-        if (!torch_texture.load_from_file(textures_path("light.png")))
-        {
-            fprintf(stderr, "Failed to load torch texture!");
-            return false;
-        }
-
-        rc.texture = &torch_texture;
-
-        if (!rc.init_sprite())
-            return false;
-    }
+    if (!shared_init.run(init_sprite))
+        return false;
 
     mc.position = { 0.f, 0.f };
     mc.velocity = { 0.f, 0.f };
@@ -27,12 +19,25 @@ bool Torch::init(int id)
     mc.radians = 0.f;
     mc.physics.scale = { 1.5f, 1.5f };
 
-    s_render_components[id] = &rc;
-    s_motion_components[id] = &mc;
+    world.render_components.insert(id, &rc);
+    world.motion_components.insert(id, &mc);
 
     return true;
 }
 
+bool Torch::init_sprite()
+{
+    if (!torch_texture.load_from_file(textures_path("light.png")))
+    {
+        fprintf(stderr, "Failed to load torch texture!");
+        return false;
+    }
+
+    rc.texture = &torch_texture;
+
+    return rc.init_sprite();
+}
+
 void Torch::update(float ms)
 {
     // probably don't really need much here...
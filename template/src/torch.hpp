@@ -7,6 +7,10 @@ class Torch : public Entity
 {
     static Texture torch_texture;
     static RenderComponent rc;
+    static SharedInit shared_init;
+
+    // Loads the texture and sets up the sprite every torch draws with
+    static bool init_sprite();
     MotionComponent mc;
 
 public:
@@ -4,6 +4,7 @@
 
 // stlib
 #include <cassert>
+#include <chrono>
 #include <sstream>
 #include <iostream>
 #include <fstream>
@@ -17,13 +18,10 @@ namespace
 {
 	const size_t CAMERA_PAN_OFFSET = 200;
 	const size_t UPDATE_FREEZE_DURATION = 2000;
+	using Clock = std::chrono::high_resolution_clock;
 }
 
-World::World()
-{
-	// Seeding rng with random device
-	m_rng = std::default_random_engine(std::random_device()());
-}
+World::World() = default;
 
 World::~World()
 {
@@ -43,14 +41,13 @@ bool World::init(GLFWwindow* window, vec2 screen)
 
 	// For some high DPI displays (ex. Retina Display on Macbooks)
 	// https://stackoverflow.com/questions/36672935/why-retina-screen-coordinate-value-is-twice-the-value-of-pixel-value
-	int fb_width, fb_height;
-	glfwGetFramebufferSize(m_window, &fb_width, &fb_height);
-	m_screen_scale = static_cast<float>(fb_width) / screen.x;
+	glfwGetFramebufferSize(m_window, &m_fb_width, &m_fb_height);
+	m_screen_scale = static_cast<float>(m_fb_width) / screen.x;
 
 	m_robot_ls_pos = { -1000.f, -1000.f };
 
 	// Initialize the screen texture
-	m_screen_tex.create_from_screen(m_window);
+	m_screen_tex.create_from_screen(m_fb_width, m_fb_height);
 
 	poll_keys(window);
 
@@ -70,14 +67,13 @@ void World::destroy()
 	glDeleteFramebuffers(1, &m_frame_buffer);
 
 	m_level.destroy();
+	Light::keep_brickmaps({});
 }
 
 // Update our game world
 void World::update(float elapsed_ms)
 {
-	int w, h;
-	glfwGetFramebufferSize(m_window, &w, &h);
-	vec2 screen = { (float)w / m_screen_scale, (float)h / m_screen_scale };
+	int w = m_fb_width, h = m_fb_height;
 
 	//-------------------------------------------------------------------------
 	vec2 player_pos = m_level.get_player_position();
@@ -90,7 +86,10 @@ void World::update(float elapsed_ms)
 	if (!is_level_load_pan) {
 		follow_speed = 0.1f;
 		follow_point = add(player_pos, { 0.f, camera_offset });
+		// timed out here, the level's simulation never reads the clock
+		Clock::time_point update_start = Clock::now();
 		m_level.update(elapsed_ms);
+		m_level.add_update_time(std::chrono::duration<double>(Clock::now() - update_start).count());
 	} else if (on_load_delay > 0) {
 		follow_speed = 0.f;
 		on_load_delay -= elapsed_ms;
@@ -148,9 +147,10 @@ void World::draw()
 	mat3 projection_2D{ { sx, 0.f, 0.f },{ 0.f, sy, 0.f },{ tx, ty, 1.f } };
 
 	// TODO: to fix lulus screen
-	vec2 camera_shift = { right / 2.f - camera_pos.x, bottom / 2.f - camera_pos.y };
+	const RenderSnapshot& snapshot = m_render_buffers.front();
+	vec2 camera_shift = { right / 2.f - snapshot.camera_pos.x, bottom / 2.f - snapshot.camera_pos.y };
 
-	m_level.draw_entities(projection_2D, camera_shift);
+	m_level.draw_entities(projection_2D, camera_shift, snapshot);
 
 	/////////////////////
 	// Truely render to the screen
@@ -167,12 +167,24 @@ void World::draw()
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_2D, m_screen_tex.id);
 
-	m_level.draw_light(projection_2D, camera_shift);
+	m_level.draw_light(projection_2D, camera_shift, snapshot);
 	//////////////////
 	// Presenting
 	glfwSwapBuffers(m_window);
 }
 
+void World::capture_render_state()
+{
+	RenderSnapshot& snapshot = m_render_buffers.back();
+	m_level.capture_render_state(snapshot);
+	snapshot.camera_pos = camera_pos;
+}
+
+void World::publish_render_state()
+{
+	m_render_buffers.publish();
+}
+
 // Should the game be over ?
 bool World::is_over() const
 {
@@ -305,6 +317,10 @@ void World::load_level(std::string level)
 
 	is_level_load_pan = valid;
 	camera_offset = 0.f;
+
+	// the snapshot being drawn is of the level that was just unloaded
+	capture_render_state();
+	publish_render_state();
 }
 
 void World::load()
@@ -340,3 +356,8 @@ Music World::get_background_music()
 {
 	return m_level.get_level_music();
 }
+
+uint64_t World::get_state_hash()
+{
+	return m_level.get_state_hash();
+}
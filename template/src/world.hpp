@@ -6,7 +6,6 @@
 
 // stlib
 #include <vector>
-#include <random>
 #include <unordered_map>
 
 #define SDL_MAIN_HANDLED
@@ -32,9 +31,16 @@ public:
 	// Steps the game ahead by ms milliseconds
 	void update(float ms);
 
-	// Renders our scene
+	// Renders our scene from the published render snapshot
 	void draw();
 
+	// Copies what the next draw needs into the back render snapshot, at the end of
+	// a frame's updates
+	void capture_render_state();
+
+	// Makes the last capture the one drawn, only between frames
+	void publish_render_state();
+
 	// Should the game be over ?
 	bool is_over() const;
 
@@ -62,6 +68,9 @@ public:
 	// Gets the proper music to play
 	Music get_background_music();
 
+	// Hash of the level simulation state, see Level::get_state_hash
+	uint64_t get_state_hash();
+
 private:
 	// Draw loading screen, parse level, set camera pos
 	void load_level(std::string level);
@@ -81,6 +90,7 @@ private:
 	GLFWwindow* m_window;
 	vec2 m_screen;
 	float m_screen_scale; // Screen to pixel coordinates scale factor
+	int m_fb_width, m_fb_height; // the window can't be resized, and glfw may only be asked on the main thread
 
 	// Screen texture
 	// The draw loop first renders to this texture, then it is used for the light shader
@@ -94,12 +104,9 @@ private:
 	float on_load_delay = 0.f; // keeps the player looking at level goal for delay ms
 
 	Level m_level;
+	RenderBuffers m_render_buffers;
 	vec2 m_robot_ls_pos;
 
-	// C++ rng
-	std::default_random_engine m_rng;
-	std::uniform_real_distribution<float> m_dist; // default 0..1
-
 	// Saved level data
 	std::vector<std::string> m_unlocked;
 
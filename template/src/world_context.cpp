@@ -0,0 +1,28 @@
+#include "world_context.hpp"
+#include "job_system.hpp"
+
+#include <cassert>
+
+namespace
+{
+	thread_local WorldContext* t_world = nullptr;
+}
+
+WorldContextScope::WorldContextScope(WorldContext* world) : m_previous(t_world)
+{
+	t_world = world;
+}
+
+WorldContextScope::~WorldContextScope()
+{
+	t_world = m_previous;
+}
+
+WorldContext& get_world_context()
+{
+	// A job may run on any thread, whatever context that thread has bound isn't its own
+	assert(!is_running_job() && "jobs must be handed what they read from the world context");
+
+	static WorldContext game;
+	return t_world != nullptr ? *t_world : game;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "audio.hpp"
+#include "components.hpp"
+#include "motion_system.hpp"
+#include "particle_system.hpp"
+#include "random.hpp"
+
+#include <map>
+#include <string>
+
+// State shared by the entities of a level that lives outside of them: entity ids,
+// component stores, the motion system, the particles, the random streams and the
+// shadow maps. Code reaches the context bound to its thread through
+// get_world_context(), so levels that each have their own context can simulate side
+// by side on different threads. Threads that bind nothing share the game's context,
+// and jobs never reach it at all.
+// The textures and sprites every entity of a kind shares aren't in here, they are
+// loaded once for all worlds (see SharedInit) and only ever drawn on one thread.
+struct WorldContext
+{
+	EntityPool entities;
+	ComponentStore<MotionComponent> motion_components;
+	ComponentStore<MotionComponent> ui_motion_components;
+	ComponentStore<RenderComponent> render_components;
+	ComponentStore<RenderComponent> ui_render_components;
+	MotionSystem motion_system;
+	ParticleSystem particles;
+	RandomStream random_streams[(int)RandomStreamId::count];
+
+	// Shadow maps by level name, kept by Light::keep_brickmaps
+	std::map<std::string, Texture> brickmaps;
+	// Frame scheduler tasks of the shadow maps still loading, Light::keep_brickmaps({})
+	// cancels them before the context goes away
+	std::map<std::string, int> brickmap_preloads;
+
+	// Where the level's sounds and music go, the game points it at its SoundSystem
+	NullAudio null_audio;
+	Audio* audio = &null_audio;
+};
+
+// Binds a context to the calling thread until it goes out of scope
+class WorldContextScope
+{
+public:
+	explicit WorldContextScope(WorldContext* world);
+	~WorldContextScope();
+
+	WorldContextScope(const WorldContextScope&) = delete;
+	WorldContextScope& operator=(const WorldContextScope&) = delete;
+
+private:
+	WorldContext* m_previous;
+};
+
+// Context bound to the calling thread, or the game's if there is none
+WorldContext& get_world_context();